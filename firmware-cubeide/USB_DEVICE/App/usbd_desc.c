@@ -71,7 +71,10 @@
 #define USBD_INTERFACE_STRING_FS     "CDC Interface"
 
 /* USER CODE BEGIN PRIVATE_DEFINES */
-
+/* iSerialNumber carries the full 96-bit UID as 24 hex chars, the same
+ * string HELLO reports as device_id, so hosts can identify a card from
+ * the descriptor without opening the port. */
+#define USB_SIZ_STRING_SERIAL_UID    (2 + 2 * 24)
 /* USER CODE END PRIVATE_DEFINES */
 
 /**
@@ -79,7 +82,41 @@
   */
 
 /* USER CODE BEGIN 0 */
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+  #pragma data_alignment=4
+#endif
+__ALIGN_BEGIN static uint8_t USBD_StringSerialUid[USB_SIZ_STRING_SERIAL_UID] __ALIGN_END = {
+  USB_SIZ_STRING_SERIAL_UID,
+  USB_DESC_TYPE_STRING,
+};
+
+/**
+  * @brief  Fill the UID serial string descriptor
+  * @note   Word order and byte order match platform_get_device_uid()
+  *         (HAL_GetUIDw0..2, big-endian), so the string equals device_id.
+  * @retval None
+  */
+static void Get_SerialNumUid(void)
+{
+  uint32_t words[3];
+  uint8_t *pbuf = &USBD_StringSerialUid[2];
+
+  words[0] = HAL_GetUIDw0();
+  words[1] = HAL_GetUIDw1();
+  words[2] = HAL_GetUIDw2();
 
+  for (uint8_t w = 0; w < 3; w++)
+  {
+    uint32_t value = words[w];
+    for (uint8_t idx = 0; idx < 8; idx++)
+    {
+      uint8_t nibble = (uint8_t)(value >> 28);
+      *pbuf++ = (nibble < 0xA) ? (nibble + '0') : (nibble + 'A' - 10);
+      *pbuf++ = 0;
+      value = value << 4;
+    }
+  }
+}
 /* USER CODE END 0 */
 
 /** @defgroup USBD_DESC_Private_Macros USBD_DESC_Private_Macros
@@ -286,7 +323,9 @@ uint8_t * USBD_FS_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
    * ID */
   Get_SerialNum();
   /* USER CODE BEGIN USBD_FS_SerialStrDescriptor */
-
+  Get_SerialNumUid();
+  *length = USB_SIZ_STRING_SERIAL_UID;
+  return (uint8_t *) USBD_StringSerialUid;
   /* USER CODE END USBD_FS_SerialStrDescriptor */
   return (uint8_t *) USBD_StringSerial;
 }
@@ -0,0 +1,86 @@
+#pragma once
+// =====================================================
+// Host Microbenchmark Harness
+// =====================================================
+// Each benchmark runs a fixed number of iterations per
+// sample, repeated for a fixed number of samples, and
+// reports ns/op statistics over the samples as JSON.
+//
+// Run with: pio run -e bench -t exec
+// =====================================================
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// Keep results observable so the optimizer cannot drop the kernel
+static volatile uint32_t g_benchSink;
+
+inline void benchKeep(uint32_t v) {
+    g_benchSink = g_benchSink + v;
+}
+
+struct BenchResult {
+    const char* name;
+    uint32_t iterations;
+    uint32_t samples;
+    double minNs;
+    double medianNs;
+    double meanNs;
+    double stddevNs;
+};
+
+template <typename Fn>
+BenchResult runBench(const char* name, uint32_t iterations, uint32_t samples, Fn fn) {
+    using Clock = std::chrono::steady_clock;
+
+    // Warm caches and branch predictors
+    for (uint32_t i = 0; i < iterations / 10 + 1; i++) {
+        fn();
+    }
+
+    std::vector<double> perOp(samples);
+    for (uint32_t s = 0; s < samples; s++) {
+        auto start = Clock::now();
+        for (uint32_t i = 0; i < iterations; i++) {
+            fn();
+        }
+        auto ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        perOp[s] = ns / iterations;
+    }
+
+    std::sort(perOp.begin(), perOp.end());
+    double sum = 0;
+    for (double v : perOp) sum += v;
+    double mean = sum / samples;
+    double var = 0;
+    for (double v : perOp) var += (v - mean) * (v - mean);
+
+    BenchResult r;
+    r.name = name;
+    r.iterations = iterations;
+    r.samples = samples;
+    r.minNs = perOp.front();
+    r.medianNs = (samples % 2) ? perOp[samples / 2]
+                               : (perOp[samples / 2 - 1] + perOp[samples / 2]) / 2;
+    r.meanNs = mean;
+    r.stddevNs = samples > 1 ? sqrt(var / (samples - 1)) : 0;
+    return r;
+}
+
+inline void printBenchJson(FILE* out, const std::vector<BenchResult>& results) {
+    fprintf(out, "{\"suite\":\"firmware-kernels\",\"unit\":\"ns/op\",\"results\":[");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(out,
+                "%s\n  {\"name\":\"%s\",\"iterations\":%u,\"samples\":%u,"
+                "\"min\":%.2f,\"median\":%.2f,\"mean\":%.2f,\"stddev\":%.2f}",
+                i ? "," : "", r.name, (unsigned)r.iterations, (unsigned)r.samples,
+                r.minNs, r.medianNs, r.meanNs, r.stddevNs);
+    }
+    fprintf(out, "\n]}\n");
+}
@@ -0,0 +1,194 @@
+// =====================================================
+// Firmware Kernel Benchmarks (host)
+// =====================================================
+// Usage: program [--samples N] [--filter substring] [--out file.json]
+// Output: JSON (see bench.h), suitable for utils/bench_compare.py
+// =====================================================
+
+#include <stdlib.h>
+#include "bench.h"
+#include "virtual_clock.h"
+
+#include "hex_util.h"
+#include "crc32.h"
+#include "link_table.h"
+#include "sync_format.h"
+#include "uid_codec.h"
+#include "status_display.h"
+#include "response_schema.h"
+
+// StatusDisplay drives GPIO; count writes instead
+static uint32_t g_gpioWrites;
+void platform_gpio_pin_mode(uint32_t, platform_gpio_mode_t) {}
+bool platform_gpio_read(uint32_t) { return true; }
+void platform_gpio_write(uint32_t, platform_gpio_state_t) { g_gpioWrites++; }
+
+// Deterministic pseudo-random fill
+static void fillBytes(uint8_t* out, size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        out[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t samples = 15;
+    const char* filter = nullptr;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+    }
+    if (samples == 0) samples = 1;
+
+    std::vector<BenchResult> results;
+    auto bench = [&](const char* name, uint32_t iterations, auto fn) {
+        if (filter && !strstr(name, filter)) return;
+        results.push_back(runBench(name, iterations, samples, fn));
+    };
+
+    // ---- Fixtures ----
+    PersistPayloadV1 payload;
+    fillBytes(reinterpret_cast<uint8_t*>(&payload), sizeof(payload), 1);
+    payload.linkCount = PersistPayloadV1::MAX_LINKS;
+
+    uint8_t key[32];
+    fillBytes(key, sizeof(key), 2);
+    char keyHex[65];
+    hex_encode(key, sizeof(key), keyHex);
+
+    uint8_t nonce[SIGN_NONCE_MAX_LEN];
+    fillBytes(nonce, sizeof(nonce), 3);
+
+    uint8_t lastPeer[DEVICE_UID_LEN];
+    memcpy(lastPeer, payload.links[PersistPayloadV1::MAX_LINKS - 1].peerId, DEVICE_UID_LEN);
+    uint8_t missPeer[DEVICE_UID_LEN];
+    fillBytes(missPeer, sizeof(missPeer), 4);
+
+    // ---- Hex ----
+    bench("hex_encode_32", 200000, [&] {
+        char out[65];
+        hex_encode(key, sizeof(key), out);
+        benchKeep((uint8_t)out[17]);
+    });
+    bench("hex_decode_32", 200000, [&] {
+        uint8_t out[32];
+        benchKeep(hex_decode(keyHex, out, sizeof(out)) + out[5]);
+    });
+
+    // ---- CRC ----
+    bench("crc32_sw_payload", 5000, [&] {
+        benchKeep(crc32_stm32_sw(reinterpret_cast<const uint8_t*>(&payload), sizeof(payload)));
+    });
+
+    // ---- Link table ----
+    bench("link_find_hit_last", 100000, [&] {
+        benchKeep((uint32_t)link_table_find(payload.links, payload.linkCount, lastPeer));
+    });
+    bench("link_find_miss_full", 100000, [&] {
+        benchKeep((uint32_t)link_table_find(payload.links, payload.linkCount, missPeer));
+    });
+
+    // ---- SIGN_STATE message assembly ----
+    bench("sign_message_build_64", 100000, [&] {
+        uint8_t msg[SIGN_MSG_MAX_LEN];
+        size_t len = sign_message_build(msg, payload.selfId, nonce, sizeof(nonce),
+                                        payload.totalTapCount, payload.links, payload.linkCount);
+        benchKeep((uint32_t)len + msg[len - 1]);
+    });
+
+    // ---- DUMP formatting ----
+    bench("dump_format_64_items", 20000, [&] {
+        char item[DUMP_ITEM_MAX_LEN];
+        uint32_t total = 0;
+        for (uint16_t i = 0; i < payload.linkCount; i++) {
+            total += (uint32_t)dump_format_item(item, payload.links[i].peerId);
+        }
+        benchKeep(total);
+    });
+
+    bench("link_export_64", 20000, [&] {
+        uint8_t out[LINK_EXPORT_MAX_LEN];
+        benchKeep((uint32_t)link_export_encode(payload.links, payload.linkCount, out, sizeof(out)));
+    });
+
+    // ---- Schema replies ----
+    bench("response_signed_state_json", 100000, [&] {
+        SignedStateResponse r = {};
+        memcpy(r.device_id, payload.selfId, DEVICE_UID_LEN);
+        r.nonce = "00112233445566778899AABBCCDDEEFF";
+        r.totalTapCount = payload.totalTapCount;
+        r.linkCount = payload.linkCount;
+        r.keyVersion = 1;
+        memcpy(r.hmac, key, sizeof(r.hmac));
+        uint8_t out[RESPONSE_MAX_LEN];
+        benchKeep((uint32_t)response_encode(SCHEMA_SIGNED_STATE, r, RESPONSE_JSON, out, sizeof(out)));
+    });
+
+    bench("response_state_binary", 500000, [&] {
+        StateResponse r = { payload.totalTapCount, payload.linkCount };
+        uint8_t out[16];
+        benchKeep((uint32_t)response_encode(SCHEMA_STATE, r, RESPONSE_BINARY, out, sizeof(out)));
+    });
+
+    bench("response_state_json", 500000, [&] {
+        StateResponse r = { payload.totalTapCount, payload.linkCount };
+        uint8_t out[80];
+        benchKeep((uint32_t)response_encode(SCHEMA_STATE, r, RESPONSE_JSON, out, sizeof(out)));
+    });
+
+    {
+        StateResponse r = { payload.totalTapCount, payload.linkCount };
+        ResponseTemplate<StateResponse, 64> stateReply;
+        if (!stateReply.build(SCHEMA_STATE, r, 0x3, RESPONSE_JSON)) {
+            fprintf(stderr, "state template does not fit\n");
+            return 1;
+        }
+        bench("response_state_json_template", 500000, [&] {
+            uint8_t out[80];
+            benchKeep((uint32_t)stateReply.render(r, out, sizeof(out)));
+        });
+    }
+
+    // ---- Compact UID frames ----
+    bench("uid_compact_roundtrip", 200000, [&] {
+        uint8_t frame[UID_COMPACT_MAX_LEN];
+        uint8_t uid[DEVICE_UID_LEN];
+        size_t len = uid_compact_encode(lastPeer, payload.selfId, frame);
+        benchKeep(uid_compact_decode(frame, len, payload.selfId, uid) + uid[11]);
+    });
+
+    // ---- Pattern stepping ----
+    {
+        VirtualClock clock;
+        clock.install();
+        static const uint32_t pins[] = {13, 12};
+        StatusDisplay display;
+        display.begin(pins, 2);
+        display.setReadyPattern(StatusDisplay::ReadyPattern::Error);
+        display.setRolePattern(StatusDisplay::RolePattern::Slave);
+        bench("status_display_step_1ms", 500000, [&] {
+            clock.advanceMs(1);
+            display.loop();
+        });
+        benchKeep(g_gpioWrites);
+        clock.uninstall();
+    }
+
+    FILE* out = stdout;
+    if (outPath) {
+        out = fopen(outPath, "w");
+        if (!out) {
+            fprintf(stderr, "cannot open %s\n", outPath);
+            return 1;
+        }
+    }
+    printBenchJson(out, results);
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -44,11 +44,18 @@ private:
     // =====================================================
     
     void updateStatusDisplay();
+    void calibrateClock(uint32_t nowMs);
+    void updatePowerMode();
+    void idleLowPower();
+    void runSelfTest();
     
 #ifdef EVAL_BOARD_TEST
     void handleMasterCommands(uint32_t nowMs);
     void handleSlaveCommands();
     void onNegotiationComplete(uint32_t nowMs);
+    void onIdExchanged(const uint8_t peerId[DEVICE_UID_LEN]);
+    void applyBridgeIdentity();
+    void commitTapTransaction();
 #else
     void handleBatteryMode(uint32_t nowMs);
 #endif
@@ -71,9 +78,18 @@ private:
     
     uint32_t _connectionDetectedTime;
     uint32_t _lastCommandTime;
+    bool _tapTxnOpen;              // Storage transaction spanning one tap
+    uint32_t _lastClockCalTime;
+    bool _clockCalibrated;         // At least one calibration succeeded
+    bool _clockCalRunning;         // Calibration run spread over loop iterations
+    bool _lowPower;                // No active USB host and tap link idle
 
     // Configuration
     static constexpr uint32_t COMMAND_INTERVAL_MS = 500;
     static constexpr uint32_t SUCCESS_DISPLAY_MS = 2000;
+    static constexpr uint32_t CLOCK_CAL_RETRY_MS = 5000;      // Until a reference is found
+    static constexpr uint32_t CLOCK_CAL_INTERVAL_MS = 60000;  // Track temperature drift
+    static constexpr uint32_t STOP_MIN_US = 3000;             // Less is not worth the clock restart
+    static constexpr uint32_t STOP_MAX_US = 500000;           // Beacon mode: loop (and USB attach) checks
 };
 
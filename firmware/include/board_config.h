@@ -64,4 +64,21 @@
 #else
 #define BUZZER_PIN 9          // Generic: GPIO 9
 #endif
-#endif
\ No newline at end of file
+#endif
+// =====================================================
+// Tap Beacon Pin (optional)
+// =====================================================
+// LPTIM1 output wired to the tap line (or the tap pin itself,
+// if the board puts the line there). With it, presence pulses
+// go out from the timer while the core is in STOP
+// (platform_lowpower.h). PA9 has no LPTIM1 output, so the
+// Nucleo has none; leave undefined. LPTIM1_OUT is PB2 (AF2):
+//   build_flags = -DTAP_BEACON_LPTIM_PIN=PB2 -DTAP_BEACON_LPTIM_AF=2
+
+// =====================================================
+// USB VBUS Sense Pin (optional)
+// =====================================================
+// Input from a VBUS divider, HIGH while USB power is present.
+// Lets the firmware tell battery from USB supply
+// (platform_usb.h). The Nucleo has none; leave undefined.
+//   build_flags = -DUSB_VBUS_SENSE_PIN=PA1
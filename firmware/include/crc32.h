@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// =====================================================
+// Software CRC32 (STM32 CRC peripheral compatible)
+// =====================================================
+// Same result as the CRC unit in its reset configuration
+// (polynomial 0x04C11DB7, init 0xFFFFFFFF, no reflection,
+// no final XOR, 32-bit little-endian words fed MSB first),
+// i.e. what Storage::calcCrc32 gets from the hardware.
+// Used for IMAGE_* chunk checks (same on host and card)
+// and on the host for tests, benchmarks and tooling.
+// =====================================================
+
+// len must be a multiple of 4 (returns 0 otherwise)
+uint32_t crc32_stm32_sw(const uint8_t* data, size_t len);
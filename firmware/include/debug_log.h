@@ -0,0 +1,62 @@
+#pragma once
+// =====================================================
+// Debug Log
+// =====================================================
+// Deferred-format developer log on its own UART
+// (platform_log.h), separate from the USB CDC host link.
+//
+// A DEBUG_LOG() call only copies the format pointer, a
+// timestamp and up to 4 args into a lock-free ring, so it
+// is cheap enough for TapLink's timed paths. Formatting and
+// the DMA hand-off happen in debug_log_flush(), called from
+// the main loop; neither ever blocks.
+//
+// Compiled out entirely unless ENABLE_DEBUG_LOG is defined.
+//
+// Usage:
+//   DEBUG_LOG("tap: cmd %u failed (%u)", cmd, failures);
+//
+// Rules:
+//   - fmt must be a string literal (only the pointer is kept)
+//   - args are stored as 32-bit values: use %u %d %x %c, and
+//     %s only with string literals
+//   - single producer: log from the main loop only
+//   - when the ring is full, records are dropped and counted
+// =====================================================
+
+#include <stdint.h>
+
+#ifdef ENABLE_DEBUG_LOG
+
+#ifndef DEBUG_LOG_BAUD
+#define DEBUG_LOG_BAUD 921600
+#endif
+
+constexpr uint8_t DEBUG_LOG_MAX_ARGS = 4;
+
+// Initialize the log UART (call once at startup)
+void debug_log_begin();
+
+// Format queued records and start the next DMA transfer (call from loop)
+void debug_log_flush();
+
+// Queue one record (use DEBUG_LOG instead)
+void debug_log_record(const char* fmt, uint8_t nargs, const uint32_t* args);
+
+template <typename... Args>
+inline void debug_log(const char* fmt, Args... args) {
+    static_assert(sizeof...(Args) <= DEBUG_LOG_MAX_ARGS, "DEBUG_LOG takes at most 4 args");
+    const uint32_t packed[] = { (uint32_t)(uintptr_t)args..., 0 };
+    debug_log_record(fmt, sizeof...(Args), packed);
+}
+
+#define DEBUG_LOG(...) debug_log(__VA_ARGS__)
+
+#else
+
+#define DEBUG_LOG(...) ((void)0)
+
+inline void debug_log_begin() {}
+inline void debug_log_flush() {}
+
+#endif
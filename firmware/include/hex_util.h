@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// =====================================================
+// Hex Encoding Helpers
+// =====================================================
+// Portable (no platform dependencies) so they can be
+// unit tested and benchmarked on the host.
+// =====================================================
+
+// Decode exactly outLen bytes from a hex string of length 2*outLen.
+// Accepts upper or lower case. Returns false on length mismatch or
+// a non-hex character.
+bool hex_decode(const char* hex, uint8_t* out, size_t outLen);
+
+// Encode len bytes as upper-case hex; out must hold 2*len + 1 chars.
+void hex_encode(const uint8_t* in, size_t len, char* out);
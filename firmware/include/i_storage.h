@@ -63,6 +63,11 @@ public:
     
     // Check if a peer ID already exists
     virtual bool hasLink(const uint8_t peerId[DEVICE_UID_LEN]) const = 0;
+
+    // Bumped whenever existing link slots change (clear, overwrite or
+    // restore). Appends leave it unchanged, so links[0..n) stay valid for
+    // a snapshot or an incremental SYNC. Random at boot.
+    virtual uint32_t getLinkGeneration() const = 0;
     
     // Increment tap count
     virtual void incrementTapCount() = 0;
@@ -70,5 +75,31 @@ public:
     // Optimized partial saves
     virtual void saveTapCountOnly() = 0;
     virtual void saveLinkOnly() = 0;
+
+    // =====================================================
+    // Transactions
+    // =====================================================
+    // Partial saves made between begin and commit are deferred and
+    // written together with a single CRC update. Transactions nest;
+    // only the outermost commit touches NVM.
+
+    virtual void beginTransaction() = 0;
+    virtual bool commitTransaction() = 0;
+
+    // =====================================================
+    // Image Transfer (backup / card replacement)
+    // =====================================================
+
+    // Size of the persisted image (header + payload) in bytes
+    virtual size_t imageSize() const = 0;
+
+    // Copy part of the persisted image (pending changes are saved first)
+    virtual bool readImage(size_t offset, uint8_t* out, size_t len) = 0;
+
+    // Replace the stored data with an image read from another card.
+    // The header and CRC must be valid. selfId is re-bound to this card
+    // and this card's key is kept. Only changed words are written.
+    // image is read where it lies; it is never copied as a whole.
+    virtual bool restoreImage(const uint8_t* image, size_t len) = 0;
 };
 
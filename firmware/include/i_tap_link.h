@@ -22,7 +22,8 @@ enum class TapCommand : uint8_t {
     NONE = 0x00,
     CHECK_READY = 0x01,
     REQUEST_ID = 0x02,
-    SEND_ID = 0x03,
+    SEND_ID = 0x03,     // Master's UID follows; ACK may carry the slave's as a uid_codec frame
+    // 0x04 is reserved: pre-release firmware sent it, and it is answered NAK
 };
 
 enum class TapResponse : uint8_t {
@@ -86,15 +87,21 @@ public:
 
     // Command protocol (master)
     virtual TapResponse masterSendCommand(TapCommand cmd) = 0;
+    // Exchange UIDs (SEND_ID, then REQUEST_ID for a V1 slave)
     virtual bool masterRequestId(uint8_t peerIdOut[DEVICE_UID_LEN]) = 0;
-    virtual bool masterSendId() = 0;
 
     // Command protocol (slave)
     virtual bool slaveHasCommand() = 0;
     virtual TapCommand slaveReceiveCommand() = 0;
     virtual void slaveSendResponse(TapResponse response) = 0;
-    virtual void slaveHandleRequestId() = 0;
-    virtual bool slaveHandleSendId(uint8_t peerIdOut[DEVICE_UID_LEN]) = 0;
+    virtual void slaveHandleRequestId(TapCommand cmd) = 0;  // REQUEST_ID
+
+    // Receive a command and answer it (SEND_ID included). Returns the
+    // command (NONE for a presence pulse).
+    virtual TapCommand slaveServeCommand() = 0;
+
+    // Master's UID from SEND_ID (slave only)
+    virtual bool getPeerId(uint8_t peerIdOut[DEVICE_UID_LEN]) const = 0;
 
     // Peer state
     virtual bool isPeerReady() const = 0;
@@ -0,0 +1,81 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "storage.h"
+
+// =====================================================
+// Storage Image Transfer (IMAGE_* commands)
+// =====================================================
+// Moves a card's whole persisted image (PersistImageV1) to
+// the host and back, e.g. onto a replacement card.
+//
+//   IMAGE_BEGIN   card issues a random challenge nonce
+//   IMAGE_AUTH    host proves it holds this card's key:
+//                 HMAC-SHA256(key, message below)
+//   IMAGE_READ    raw chunks out, each with its CRC
+//   IMAGE_WRITE   raw chunks in, staged in RAM, CRC-checked
+//   IMAGE_COMMIT  Storage::restoreImage() validates the
+//                 staged image and writes changed words
+//
+// Chunks are multiples of 4 bytes (CRC is crc32_stm32_sw).
+// A write may start anywhere up to next(), so after a lost
+// connection the host re-authenticates and resumes there.
+// Staged data survives IMAGE_BEGIN; it is dropped on commit.
+// =====================================================
+
+constexpr size_t IMAGE_SIZE = sizeof(PersistImageV1);
+constexpr size_t IMAGE_CHUNK_MAX = 256;
+constexpr size_t IMAGE_NONCE_LEN = 16;
+
+// auth message = "IMG1" + selfId(12) + nonce(16)
+constexpr size_t IMAGE_AUTH_MSG_LEN = 4 + DEVICE_UID_LEN + IMAGE_NONCE_LEN;
+
+static_assert(IMAGE_SIZE % 4 == 0, "image must be whole CRC words");
+
+size_t image_auth_message_build(uint8_t out[IMAGE_AUTH_MSG_LEN],
+                                const uint8_t selfId[DEVICE_UID_LEN],
+                                const uint8_t nonce[IMAGE_NONCE_LEN]);
+
+class ImageTransfer {
+public:
+    // New challenge; authorization is dropped, staged data kept
+    void begin(const uint8_t nonce[IMAGE_NONCE_LEN]);
+    const uint8_t* nonce() const { return _nonce; }
+    bool hasNonce() const { return _hasNonce; }
+
+    // The nonce answers one IMAGE_AUTH attempt only
+    void endChallenge() { _hasNonce = false; }
+
+    void authorize() { _authorized = true; }
+    bool isAuthorized() const { return _authorized; }
+
+    // Chunk bounds shared by READ and WRITE
+    static bool isValidChunk(size_t offset, size_t len);
+
+    // WRITE: offset must not skip past next()
+    bool canWrite(size_t offset, size_t len) const;
+
+    // Where the raw bytes of a WRITE chunk go
+    uint8_t* chunkTarget(size_t offset) { return _stage + offset; }
+
+    // Check a received chunk. On success next() advances past it; on a
+    // CRC mismatch next() falls back to offset so the host resends.
+    bool finishChunk(size_t offset, size_t len, uint32_t crc);
+
+    // A chunk from offset was cut short: resume from its start
+    void dropChunk(size_t offset);
+
+    size_t next() const { return _next; }
+    bool isComplete() const { return _next == IMAGE_SIZE; }
+    const uint8_t* stage() const { return _stage; }
+
+    // Drop staged data, nonce and authorization
+    void reset();
+
+private:
+    uint8_t _stage[IMAGE_SIZE] = {};
+    uint8_t _nonce[IMAGE_NONCE_LEN] = {};
+    size_t _next = 0;
+    bool _hasNonce = false;
+    bool _authorized = false;
+};
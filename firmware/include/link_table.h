@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+#include "storage.h"
+
+// =====================================================
+// Link Table Lookup
+// =====================================================
+// Portable search over the persisted link records, shared
+// by Storage and the host benchmarks.
+// =====================================================
+
+// Index of peerId in links[0..count), or -1 if absent
+int link_table_find(const LinkRecordV1* links, uint16_t count,
+                    const uint8_t peerId[DEVICE_UID_LEN]);
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdbool.h>
+#include "platform_usb.h"
+
+// =====================================================
+// STOP Policy
+// =====================================================
+// STOP halts HSI48 and the USB peripheral, so a host only
+// gets answers while the core runs. The idle loop may stop
+// only when no host can be on the bus:
+//   - the USB peripheral is not clocked (no USB stack), or
+//   - VBUS is sensed absent (battery).
+//
+// PLATFORM_USB_NO_HOST alone is not enough: it also covers
+// a cable that is attached but not yet addressed (DADDR 0),
+// which is exactly when the host's bus reset and first
+// GET_DESCRIPTOR must be answered. Without a VBUS sense pin
+// the supply is unknown, so a card with USB clocked never
+// stops. With one, a rising VBUS edge also ends a STOP that
+// is already running (platform_lowpower_stop()).
+//
+// Pure logic, so host tests can drive it.
+// =====================================================
+
+inline bool lowpower_stop_allowed(bool usbClocked, platform_usb_state_t usb, platform_supply_t supply) {
+    if (usb != PLATFORM_USB_NO_HOST) {
+        return false;
+    }
+    return !usbClocked || supply == PLATFORM_SUPPLY_BATTERY;
+}
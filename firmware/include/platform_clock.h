@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// =====================================================
+// Platform Clock Calibration Abstraction
+// =====================================================
+// Measures the system clock against an accurate reference
+// and trims the internal oscillator (HSI16 on STM32L0) so
+// two cards agree on tap link bit timing.
+//
+// References, in order of preference:
+//   - LSE 32.768 kHz crystal (if fitted and running)
+//   - USB start-of-frame, 1 kHz from the host (if attached)
+//
+// A calibration run measures, then steps the trim while
+// the error improves. It is spread over many calls so the
+// loop keeps running: each call blocks for at most one LSE
+// measurement (~4 ms) or one USB frame edge (~1 ms), and a
+// SOF window keeps counting frames between calls. The trim
+// only changes inside a call, when a window ends.
+//
+// Usage:
+//   - Call platform_clock_begin() once at startup
+//   - Start a run with platform_clock_calibrate() while
+//     the tap link is idle, then keep calling it from the
+//     loop (while idle) until it stops returning BUSY
+// =====================================================
+
+typedef enum {
+    PLATFORM_CLOCK_REF_NONE = 0,   // No reference available
+    PLATFORM_CLOCK_REF_LSE,
+    PLATFORM_CLOCK_REF_USB_SOF
+} platform_clock_ref_t;
+
+typedef enum {
+    PLATFORM_CLOCK_CAL_NO_REF = 0, // No reference available; run ended
+    PLATFORM_CLOCK_CAL_BUSY,       // Run in progress; call again
+    PLATFORM_CLOCK_CAL_DONE        // Run ended; result filled in
+} platform_clock_cal_status_t;
+
+typedef struct {
+    platform_clock_ref_t ref;  // Reference used
+    int32_t errorPpm;          // System clock error before trimming (+ = fast)
+    int32_t residualPpm;       // Error after trimming
+    uint8_t trim;              // Oscillator trim value now in effect
+    bool trimmed;              // False if the system clock is not trimmable (e.g. HSE)
+} platform_clock_cal_t;
+
+// Start the reference oscillator (non-blocking; LSE takes up to ~2 s)
+void platform_clock_begin();
+
+// Start or advance a calibration run. result is written
+// when the run ends (DONE or NO_REF).
+platform_clock_cal_status_t platform_clock_calibrate(platform_clock_cal_t* result);
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// =====================================================
+// Platform CRC Abstraction
+// =====================================================
+// CRC-32 on the hardware CRC unit: poly 0x04C11DB7, init
+// 0xFFFFFFFF, 32-bit words in memory order, no reflection,
+// no final XOR. Matches crc32_stm32_sw() (crc32.h).
+//
+// The unit is configured once; each call only resets the
+// accumulator, and the clock is held just for the call
+// (platform_power.h).
+// =====================================================
+
+// CRC of len bytes (multiple of 4; any alignment)
+// Returns: 0 if len is not a multiple of 4
+uint32_t platform_crc32(const uint8_t* data, size_t len);
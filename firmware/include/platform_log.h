@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// =====================================================
+// Platform Debug Log UART Abstraction
+// =====================================================
+// TX-only developer log channel on USART1, separate from
+// the USB CDC host protocol. Transfers are started and
+// polled without blocking (DMA on STM32).
+//
+// Usage:
+//   - Call platform_log_begin() once at startup
+//   - platform_log_start() hands a buffer to the UART
+//   - Poll platform_log_busy() before reusing the buffer
+//
+// Normally used through debug_log.h, not directly.
+// =====================================================
+
+// Initialize the log UART (TX only)
+// baud: UART baud rate
+void platform_log_begin(uint32_t baud);
+
+// Start transmitting a buffer in the background
+// data must stay valid until platform_log_busy() returns false
+// Returns: false if a transfer is still running or len is 0
+bool platform_log_start(const uint8_t* data, size_t len);
+
+// Check if a transfer is still running
+bool platform_log_busy();
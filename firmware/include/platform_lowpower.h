@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// =====================================================
+// Platform Low-Power Wait (STOP mode)
+// =====================================================
+// Stops the core between presence pulses while nothing else
+// needs it. The low-power timer (LPTIM1, on LSE or LSI) keeps
+// counting in STOP and bounds the wait; a falling edge on the
+// tap line (EXTI) ends it early, so a peer's pulse wakes us.
+//
+// With a beacon pin (TAP_BEACON_LPTIM_PIN in board_config.h)
+// the timer also drives the presence pulses itself, open-drain
+// on the tap line, and the core only wakes for a peer or when
+// maxUs has passed. Without one, the caller sends each pulse
+// and the wait ends when the next is due.
+//
+// The millisecond tick is advanced by the time spent stopped,
+// so platform_millis() and micros() carry on as if awake.
+//
+// Main loop only. Returns PLATFORM_WAKE_SKIPPED without
+// stopping while EEPROM programming or log DMA is running,
+// or while a USB host could be on the bus (lowpower_policy.h).
+// A rising edge on the VBUS sense pin ends the wait.
+//
+// Usage:
+//   platform_lowpower_begin(TAP_LINK_PIN);
+//   platform_lowpower_stop(untilNextPulseUs, 0, 0);
+// =====================================================
+
+typedef enum {
+    PLATFORM_WAKE_TIMER = 0,    // maxUs passed
+    PLATFORM_WAKE_LINE,         // falling edge from somebody else on the line
+    PLATFORM_WAKE_OTHER,        // an interrupt (USB, UART, ...) or VBUS rising
+    PLATFORM_WAKE_SKIPPED       // did not stop
+} platform_wake_t;
+
+// Configure the line wake-up and STOP entry; the line pin must
+// already be an input with its pull-up. Returns false if the
+// pin cannot be used.
+bool platform_lowpower_begin(uint32_t linePin);
+
+// The board routes an LPTIM1 output onto the tap line
+bool platform_lowpower_has_beacon(void);
+
+// Stop the core for up to maxUs. With beaconIntervalUs != 0
+// the timer pulses the line low for beaconPulseUs every
+// beaconIntervalUs meanwhile (first pulse at once); requires
+// platform_lowpower_has_beacon(). *pulsesOut (optional) gets
+// the number of pulses sent.
+platform_wake_t platform_lowpower_stop(uint32_t maxUs, uint32_t beaconIntervalUs,
+                                       uint32_t beaconPulseUs, uint32_t* pulsesOut);
@@ -0,0 +1,74 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// =====================================================
+// Platform Power Abstraction
+// =====================================================
+// Reference-counted peripheral clocks. A component acquires
+// a peripheral before touching its registers and releases it
+// when done; the clock is gated when the last user releases.
+// Register contents survive gating, so one-time setup (e.g.
+// the CRC unit) does not have to be repeated per use.
+//
+// Active clocks are also recorded per application state, so
+// POWER can show which peripherals each state keeps clocked.
+//
+// Main loop only: not safe to call from interrupts.
+//
+// Usage:
+//   platform_power_begin();                 // once, first thing
+//   platform_power_acquire(PLATFORM_PERIPH_CRC);
+//   ...use the CRC unit...
+//   platform_power_release(PLATFORM_PERIPH_CRC);
+// =====================================================
+
+typedef enum {
+    PLATFORM_PERIPH_CRC = 0,
+    PLATFORM_PERIPH_RNG,        // plus its HSI48 kernel clock
+    PLATFORM_PERIPH_TIM21,
+    PLATFORM_PERIPH_TIM22,
+    PLATFORM_PERIPH_USART1,
+    PLATFORM_PERIPH_DMA1,
+    PLATFORM_PERIPH_I2C1,
+    PLATFORM_PERIPH_LPTIM1,
+    PLATFORM_PERIPH_USB,        // owned by the USB stack: reported, never gated
+    PLATFORM_PERIPH_COUNT
+} platform_periph_t;
+
+// Application states tracked by platform_power_set_state()
+#define PLATFORM_POWER_STATE_MAX 8
+
+// Gate every managed clock that nothing has acquired yet (the
+// core and bootloader may leave some running)
+void platform_power_begin(void);
+
+void platform_power_acquire(platform_periph_t periph);
+void platform_power_release(platform_periph_t periph);
+
+// Bit n set = peripheral n is clocked right now (read back from RCC,
+// so clocks enabled behind the manager's back show up too)
+uint32_t platform_power_active_mask(void);
+
+// Short lower-case name ("crc", "usart1", ...); "?" if out of range
+const char* platform_power_periph_name(uint8_t periph);
+
+// Record usage against state (0..PLATFORM_POWER_STATE_MAX-1) from now on
+void platform_power_set_state(uint8_t state);
+
+// Every peripheral seen clocked while in state since the last reset
+uint32_t platform_power_state_mask(uint8_t state);
+void platform_power_reset_states(void);
+
+// Sleep the core (WFI) until ms have passed. Interrupts (SysTick,
+// USB, line EXTI) are served as usual; clocks keep running. Use in
+// place of platform_delay_ms() when nothing is due sooner.
+void platform_power_idle_ms(uint32_t ms);
+
+// Switch unused pins to analog mode (no input buffer leakage).
+// Only floating inputs are touched: pins in output, alternate or
+// analog mode, or with a pull resistor, are owned by someone.
+// keepPins are board pins (board_config.h) left alone regardless.
+// Returns: number of pins switched
+uint32_t platform_power_idle_pins(const uint32_t* keepPins, size_t keepCount);
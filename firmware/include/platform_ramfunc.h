@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// =====================================================
+// Platform RAM Function Placement
+// =====================================================
+// On the STM32L053 the program flash and data EEPROM share
+// one NVM bank: while an EEPROM word is programming (~3.2ms)
+// every instruction fetch or constant read from flash stalls
+// the core. Code that must keep time through a write runs
+// from RAM instead.
+//
+// PLATFORM_RAMFUNC puts a function in the .RamFunc section,
+// which the linker script already places in .data (copied
+// to RAM by the startup code). A RAM function must not call
+// into flash on its timed path; the M0+ has no hardware
+// divider, so avoid / and % there too (__aeabi_uidiv).
+//
+// Usage:
+//   - Call platform_ramfunc_begin() first thing at startup
+//   - Mark definitions: PLATFORM_RAMFUNC void Foo::bar() {...}
+// =====================================================
+
+#if defined(__arm__) && !defined(UNIT_TEST)
+#define PLATFORM_RAMFUNC __attribute__((section(".RamFunc"), noinline))
+#else
+#define PLATFORM_RAMFUNC
+#endif
+
+// Move the vector table to RAM and serve SysTick from a RAM
+// handler, so the millisecond tick survives EEPROM writes
+void platform_ramfunc_begin();
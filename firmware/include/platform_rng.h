@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// =====================================================
+// Platform Random Number Abstraction
+// =====================================================
+// True random words from the hardware RNG, for challenge
+// nonces (IMAGE_BEGIN) and the manufacturing self-test.
+//
+// Usage:
+//   uint32_t words[4];
+//   if (!platform_rng_read(words, 4)) { /* RNG fault */ }
+// =====================================================
+
+// Read n words from the hardware RNG
+// Returns: false on a seed/clock error or timeout
+bool platform_rng_read(uint32_t* out, size_t n);
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// =====================================================
+// Platform Self-Test Probes
+// =====================================================
+// Hardware blocks the manufacturing self-test (self_test.h)
+// exercises directly. Everything else it checks goes
+// through the existing platform_gpio/storage/buzzer APIs.
+// =====================================================
+
+// Program the EEPROM word at address twice (value, then back
+// to the original), timing the longest gap a polling loop sees
+// while it programs: once running from flash, once from RAM.
+// Returns: false if the word could not be programmed
+bool platform_selftest_nvm_stall(size_t address, uint32_t* flashUs, uint32_t* ramUs);
@@ -34,6 +34,9 @@ void platform_serial_print(int num);
 void platform_serial_print(uint32_t num);
 void platform_serial_print_hex(uint8_t byte);
 
+// Write raw bytes (binary payloads, e.g. IMAGE_READ chunks)
+void platform_serial_write(const uint8_t* data, size_t len);
+
 // Print a string with newline (\r\n)
 void platform_serial_println(const char* str);
 
@@ -30,6 +30,41 @@ uint8_t platform_storage_read(size_t address);
 // value: byte value to write (0-255)
 void platform_storage_write(size_t address, uint8_t value);
 
+// Write a block, programming whole aligned 32-bit words where
+// possible and skipping words that already match. A word costs
+// the same program time as a byte, so this is up to 4x faster.
+void platform_storage_write_block(size_t address, const uint8_t* data, size_t len);
+
 // Commit buffered writes to persistent storage
 // Returns: true if successful, false on error
 bool platform_storage_commit();
+
+// =====================================================
+// Queued Writes
+// =====================================================
+// Words are queued and programmed one at a time from the
+// NVM end-of-operation interrupt, so a write costs the
+// caller only the compare and the enqueue instead of the
+// program time. The synchronous functions above wait for
+// the queue to drain first, so reads and writes stay in
+// order.
+// =====================================================
+
+// Called from interrupt context once the queue drains.
+// ok is false if any word since the last drain failed.
+typedef void (*platform_storage_done_fn)(void* ctx, bool ok);
+
+// Queue [address, address + len). Words that already match are
+// skipped and a word still waiting in the queue is updated in
+// place. Blocks only while the queue is full.
+void platform_storage_queue_block(size_t address, const uint8_t* data, size_t len);
+
+// Call done(ctx, ok) once every word queued so far is programmed
+// (right away if the queue is empty)
+void platform_storage_queue_fence(platform_storage_done_fn done, void* ctx);
+
+// True while queued words remain
+bool platform_storage_busy();
+
+// Wait for the queue to drain
+void platform_storage_flush();
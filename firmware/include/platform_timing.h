@@ -11,8 +11,24 @@
 //   - Include this header instead of Arduino.h for timing
 //   - Call platform_timing_init() once at startup
 //   - Use platform_millis(), platform_micros(), etc.
+//
+// The calls dispatch through a backend. The hardware
+// backend is active by default; native tests install a
+// virtual clock (test/virtual_clock.h) so delays and
+// timeouts complete instantly in simulated time.
 // =====================================================
 
+// Timing backend. ctx is passed back to every hook.
+// deadline_hint may be null.
+typedef struct {
+    uint32_t (*millis)(void* ctx);
+    uint32_t (*micros)(void* ctx);
+    void (*delay_ms)(void* ctx, uint32_t ms);
+    void (*delay_us)(void* ctx, uint32_t us);
+    void (*deadline_hint)(void* ctx, uint32_t inUs);
+    void* ctx;
+} platform_timing_backend_t;
+
 // Initialize timing system (call once at startup)
 void platform_timing_init();
 
@@ -27,3 +43,16 @@ void platform_delay_ms(uint32_t ms);
 
 // Blocking delay in microseconds (may have limited precision)
 void platform_delay_us(uint32_t us);
+
+// Tell the backend that the caller has work due in inMs/inUs
+// from now. Timer-driven components call this from loop() so a
+// virtual clock can jump straight to the next deadline.
+// No-op on hardware.
+void platform_timing_hint_deadline_ms(uint32_t inMs);
+void platform_timing_hint_deadline_us(uint32_t inUs);
+
+// Replace the active backend (nullptr restores the default)
+void platform_timing_set_backend(const platform_timing_backend_t* backend);
+
+// Hardware backend (defined by the platform implementation)
+extern const platform_timing_backend_t platform_timing_hw_backend;
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// =====================================================
+// Platform USB Power State
+// =====================================================
+// Whether a host is talking to the card, and what powers it.
+// The application drops to low-power tap detection whenever
+// no host is active (suspended laptop, charger-only port,
+// battery) and returns to full operation on host resume.
+//
+// Supply detection uses the board's VBUS sense pin when it
+// has one (USB_VBUS_SENSE_PIN in board_config.h). Without
+// it, a host that enumerated the card implies USB power and
+// anything else is reported as unknown.
+//
+// Usage:
+//   if (platform_usb_state() != PLATFORM_USB_ACTIVE) { ...low power... }
+// =====================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PLATFORM_USB_NO_HOST = 0,   // Never enumerated, or VBUS gone
+    PLATFORM_USB_ACTIVE,        // Enumerated and not suspended
+    PLATFORM_USB_SUSPENDED      // Host stopped sending frames (sleep, unplugged data)
+} platform_usb_state_t;
+
+typedef enum {
+    PLATFORM_SUPPLY_UNKNOWN = 0,
+    PLATFORM_SUPPLY_USB,
+    PLATFORM_SUPPLY_BATTERY
+} platform_supply_t;
+
+// Configure the VBUS sense pin, if the board has one
+void platform_usb_begin(void);
+
+platform_usb_state_t platform_usb_state(void);
+platform_supply_t platform_usb_supply(void);
+
+// The USB peripheral is clocked (the core started a USB stack)
+bool platform_usb_clocked(void);
+
+// "no_host" / "active" / "suspended" and "unknown" / "usb" / "battery"
+const char* platform_usb_state_name(platform_usb_state_t state);
+const char* platform_usb_supply_name(platform_supply_t supply);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,297 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// =====================================================
+// Response Schemas (USB serial replies)
+// =====================================================
+// Each fixed-shape reply is a plain struct plus a constexpr
+// field table. response_encode() turns the same table into
+// either a compact JSON line or a binary frame, so adding a
+// field is one struct member and one RESPONSE_FIELD line.
+//
+// Field types come from the member type:
+//   uint8_t/uint16_t/uint32_t  number
+//   bool                       true/false
+//   const char*                string (NUL-terminated)
+//   uint8_t[N]                 upper-case hex / N raw bytes
+//
+// Binary frame (all numbers little-endian):
+//   0xB5 | schema id (1) | payload length (2) | fields...
+//   strings are a length byte then the characters; numbers
+//   and hex fields use their full width.
+//
+// Portable (no platform dependencies) so it can be unit
+// tested and benchmarked on the host.
+// =====================================================
+
+enum ResponseFormat : uint8_t {
+    RESPONSE_JSON = 0,
+    RESPONSE_BINARY
+};
+
+enum ResponseFieldType : uint8_t {
+    RF_U8 = 0,
+    RF_U16,
+    RF_U32,
+    RF_BOOL,
+    RF_STR,
+    RF_HEX
+};
+
+constexpr uint8_t RESPONSE_FRAME_SYNC = 0xB5;
+constexpr size_t RESPONSE_FRAME_HEADER = 4;
+
+// Largest encoded reply (SIGNED_STATE with a 64-hex nonce is ~300 in JSON)
+constexpr size_t RESPONSE_MAX_LEN = 320;
+
+struct ResponseField {
+    const char* name;
+    uint8_t type;
+    uint8_t width;       // bytes in the struct (hex: byte count)
+    uint16_t offset;     // offsetof(struct, member)
+    bool omitIfZero;     // JSON only: leave out when 0 / all-zero
+};
+
+struct ResponseSchema {
+    uint8_t id;          // binary frame id, stable across releases
+    const char* event;   // JSON "event" value
+    const ResponseField* fields;
+    uint8_t fieldCount;
+};
+
+// Member type -> field type. Unsupported member types do not compile.
+template <typename T> struct ResponseTypeOf;
+template <> struct ResponseTypeOf<uint8_t>     { static constexpr uint8_t value = RF_U8; };
+template <> struct ResponseTypeOf<uint16_t>    { static constexpr uint8_t value = RF_U16; };
+template <> struct ResponseTypeOf<uint32_t>    { static constexpr uint8_t value = RF_U32; };
+template <> struct ResponseTypeOf<bool>        { static constexpr uint8_t value = RF_BOOL; };
+template <> struct ResponseTypeOf<const char*> { static constexpr uint8_t value = RF_STR; };
+template <size_t N> struct ResponseTypeOf<uint8_t[N]> {
+    static_assert(N <= 255, "hex field too wide");
+    static constexpr uint8_t value = RF_HEX;
+};
+
+// The member name is the JSON key
+#define RESPONSE_FIELD_(S, m, opt)                                   \
+    ResponseField{ #m, ResponseTypeOf<decltype(S::m)>::value,        \
+                   (uint8_t)sizeof(S::m), (uint16_t)offsetof(S, m), opt }
+#define RESPONSE_FIELD(S, m)          RESPONSE_FIELD_(S, m, false)
+#define RESPONSE_FIELD_OPTIONAL(S, m) RESPONSE_FIELD_(S, m, true)
+
+// A schema bound to its reply struct, so a reply cannot be sent with
+// another struct's table
+template <typename T>
+struct ResponseSchemaOf {
+    ResponseSchema schema;
+};
+
+template <typename T, size_t N>
+constexpr ResponseSchemaOf<T> response_schema(uint8_t id, const char* event,
+                                              const ResponseField (&fields)[N]) {
+    static_assert(N <= 255, "too many fields");
+    return ResponseSchemaOf<T>{ { id, event, fields, (uint8_t)N } };
+}
+
+// Encode values (the schema's struct) into out. JSON output ends in
+// "\r\n" like platform_serial_println(); it is not NUL-terminated.
+// Returns the length, or 0 if it does not fit in cap.
+size_t response_encode(const ResponseSchema& schema, const void* values,
+                       ResponseFormat format, uint8_t* out, size_t cap);
+
+template <typename T>
+size_t response_encode(const ResponseSchemaOf<T>& schema, const T& values,
+                       ResponseFormat format, uint8_t* out, size_t cap) {
+    return response_encode(schema.schema, &values, format, out, cap);
+}
+
+// =====================================================
+// Templates (cached replies)
+// =====================================================
+// A reply encoded once with only some number fields left as
+// holes. Rendering copies the cached bytes and writes just the
+// hole values, so hot replies (HELLO, GET_STATE) skip the
+// per-field work. A template with no holes is a cached reply.
+//
+// Holes must be plain numbers (not optional): in JSON a hole is
+// the spot the digits go, in binary the fixed-width slot that
+// gets overwritten. Every other field keeps the value given at
+// build time.
+
+constexpr uint8_t RESPONSE_TEMPLATE_MAX_HOLES = 4;
+
+struct ResponseTemplateHole {
+    uint16_t at;         // offset in the cached bytes
+    uint8_t field;       // index in the schema's field table
+};
+
+struct ResponseTemplateInfo {
+    const ResponseSchema* schema;
+    uint16_t len;        // cached bytes; 0 = not built
+    uint8_t format;
+    uint8_t holeCount;
+    ResponseTemplateHole holes[RESPONSE_TEMPLATE_MAX_HOLES];
+};
+
+// Encode values into text with the fields in variableMask (bit n =
+// field n) as holes. Returns false if it does not fit, a masked field
+// is not a plain number, or there are too many holes.
+bool response_template_build(ResponseTemplateInfo& info, uint8_t* text, size_t cap,
+                             const ResponseSchema& schema, const void* values,
+                             uint32_t variableMask, ResponseFormat format);
+
+// Cached bytes with the hole fields taken from values (the schema's
+// struct). Returns the length, or 0 if not built or it does not fit.
+size_t response_template_render(const ResponseTemplateInfo& info, const uint8_t* text,
+                                const void* values, uint8_t* out, size_t cap);
+
+// Template storage bound to its reply struct; N = cached bytes
+template <typename T, size_t N>
+struct ResponseTemplate {
+    ResponseTemplateInfo info = {};
+    uint8_t text[N];
+
+    bool build(const ResponseSchemaOf<T>& schema, const T& values,
+               uint32_t variableMask, ResponseFormat format) {
+        return response_template_build(info, text, N, schema.schema, &values,
+                                       variableMask, format);
+    }
+    bool builtFor(ResponseFormat format) const {
+        return info.len != 0 && info.format == format;
+    }
+    size_t render(const T& values, uint8_t* out, size_t cap) const {
+        return response_template_render(info, text, &values, out, cap);
+    }
+};
+
+// One SCHEMA line describing a schema's binary layout:
+// {"event":"schema","id":1,"name":"hello","fields":[["device_id","hex",12],...]}
+size_t response_describe(const ResponseSchema& schema, uint8_t* out, size_t cap);
+
+// Decimal digits of v into out (no NUL); returns the digit count (1-10)
+size_t response_format_u32(uint32_t v, char* out);
+
+// =====================================================
+// Reply Definitions
+// =====================================================
+
+struct ErrorResponse {
+    const char* msg;
+};
+
+struct AckResponse {
+    const char* cmd;
+    uint8_t keyVersion;  // PROVISION_KEY only
+};
+
+struct HelloResponse {
+    uint8_t device_id[12];
+    const char* fw;
+    const char* build;
+    const char* hash;
+};
+
+struct StateResponse {
+    uint32_t totalTapCount;
+    uint16_t linkCount;
+};
+
+struct SnapshotResponse {
+    uint32_t snap;
+    uint32_t totalTapCount;
+    uint16_t linkCount;
+};
+
+struct SignedStateResponse {
+    uint8_t device_id[12];
+    const char* nonce;
+    uint32_t totalTapCount;
+    uint16_t linkCount;
+    uint32_t snap;       // 0 = live state
+    uint8_t keyVersion;
+    uint8_t hmac[32];
+};
+
+struct KeyResponse {
+    uint8_t keyVersion;
+    uint8_t key[32];
+};
+
+struct BridgeResponse {
+    bool on;
+    uint8_t station[12]; // all zero = hardware UID
+    uint32_t seq;
+};
+
+struct TapEventResponse {
+    uint32_t seq;
+    const char* role;
+    uint8_t self[12];
+    uint8_t peer[12];
+};
+
+struct FormatResponse {
+    const char* format;
+};
+
+struct ImageErrorResponse {
+    const char* msg;
+    uint32_t next;
+};
+
+struct ImageBeginResponse {
+    uint8_t nonce[16];
+    uint32_t size;
+    uint32_t chunk;
+    uint32_t next;
+};
+
+struct ImageAuthResponse {
+    bool ok;
+    uint32_t next;
+};
+
+struct ImageDataResponse {
+    uint32_t off;
+    uint32_t len;
+    uint8_t crc[4];      // big-endian, so JSON reads as the hex value
+};
+
+struct ImageAckResponse {
+    uint32_t next;
+};
+
+struct ImageCommitResponse {
+    bool ok;
+    uint32_t totalTapCount;
+    uint16_t linkCount;
+};
+
+struct LinksExportResponse {
+    uint32_t snap;       // 0 = live state
+    uint32_t totalTapCount;
+    uint16_t linkCount;
+    uint16_t len;        // bytes of link export that follow (sync_format.h)
+};
+
+extern const ResponseSchemaOf<ErrorResponse> SCHEMA_ERROR;
+extern const ResponseSchemaOf<AckResponse> SCHEMA_ACK;
+extern const ResponseSchemaOf<HelloResponse> SCHEMA_HELLO;
+extern const ResponseSchemaOf<StateResponse> SCHEMA_STATE;
+extern const ResponseSchemaOf<SnapshotResponse> SCHEMA_SNAPSHOT;
+extern const ResponseSchemaOf<SignedStateResponse> SCHEMA_SIGNED_STATE;
+extern const ResponseSchemaOf<KeyResponse> SCHEMA_KEY;
+extern const ResponseSchemaOf<BridgeResponse> SCHEMA_BRIDGE;
+extern const ResponseSchemaOf<TapEventResponse> SCHEMA_TAP;
+extern const ResponseSchemaOf<FormatResponse> SCHEMA_FORMAT;
+extern const ResponseSchemaOf<ImageErrorResponse> SCHEMA_IMAGE_ERROR;
+extern const ResponseSchemaOf<ImageBeginResponse> SCHEMA_IMAGE_BEGIN;
+extern const ResponseSchemaOf<ImageAuthResponse> SCHEMA_IMAGE_AUTH;
+extern const ResponseSchemaOf<ImageDataResponse> SCHEMA_IMAGE_DATA;
+extern const ResponseSchemaOf<ImageAckResponse> SCHEMA_IMAGE_ACK;
+extern const ResponseSchemaOf<ImageCommitResponse> SCHEMA_IMAGE_COMMIT;
+extern const ResponseSchemaOf<LinksExportResponse> SCHEMA_LINKS_Z;
+
+// Every schema above, for the SCHEMA command
+extern const ResponseSchema* const RESPONSE_SCHEMAS[];
+extern const size_t RESPONSE_SCHEMA_COUNT;
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "tap_link_hal.h"
+
+// =====================================================
+// Manufacturing Self-Test
+// =====================================================
+// Run by the SELFTEST USB command on an idle card. Every
+// check is electrical or functional, so no second board or
+// operator is needed; the whole run takes ~100 ms.
+//
+//   line    tap line reads HIGH released, LOW driven
+//   led     each status LED pin follows the level written
+//   buzzer  buzzer pin follows the level, then a short chirp
+//   eeprom  scratch word holds 0x00/0xFF/0x55/0xAA patterns
+//   rng     hardware RNG returns distinct, non-stuck words
+//   crc     hardware CRC matches crc32_stm32_sw()
+//
+// The EEPROM check also times how long an EEPROM program
+// stalls code running from flash vs RAM (platform_ramfunc.h).
+// =====================================================
+
+enum SelfTestItem : uint8_t {
+    SELFTEST_LINE = 0,
+    SELFTEST_LED,
+    SELFTEST_BUZZER,
+    SELFTEST_EEPROM,
+    SELFTEST_RNG,
+    SELFTEST_CRC,
+    SELFTEST_ITEM_COUNT
+};
+
+struct SelfTestConfig {
+    IOneWireHal* line;
+    const uint32_t* ledPins;
+    uint8_t ledCount;
+    uint32_t buzzerPin;
+    size_t scratchAddress;    // EEPROM word the test may overwrite (restored)
+};
+
+struct SelfTestReport {
+    uint8_t failMask;         // Bit per SelfTestItem
+    uint32_t durationMs;
+    uint32_t nvmStallFlashUs; // Longest stall seen from flash during an EEPROM program
+    uint32_t nvmStallRamUs;   // Same loop running from RAM
+};
+
+// Run all checks. Leaves the LED and buzzer pins as outputs
+// and the tap line released. Returns true if all passed.
+bool self_test_run(const SelfTestConfig& config, SelfTestReport& report);
+
+// Short lowercase name for reports ("line", "led", ...)
+const char* self_test_item_name(uint8_t item);
@@ -58,6 +58,10 @@
  
      // Run pattern timers; call from main loop
      void loop();
+
+     // Hold every LED off (low-power mode). Patterns set meanwhile are
+     // remembered and start over when the display is lit again.
+     void setDark(bool dark);
  
     // Pattern building blocks (exposed so platform-agnostic
     // pattern tables in the .cpp can reference them)
@@ -94,4 +98,5 @@
      size_t _ledCount;
      LedState _states[MAX_LEDS];
      bool _initialized;
+     bool _dark;
  };
@@ -68,6 +68,11 @@ struct PersistImageV1 {
     PersistPayloadV1 payload;
 };
 
+// Last EEPROM word, outside the image: scratch for the self-test
+constexpr size_t STORAGE_SCRATCH_ADDR = STORAGE_EEPROM_SIZE - 4;
+static_assert(STORAGE_EEPROM_BASE + sizeof(PersistImageV1) <= STORAGE_SCRATCH_ADDR,
+              "image overlaps the self-test scratch word");
+
 
 // =====================================================
 // Storage Class
@@ -99,13 +104,27 @@ public:
     void clearAll() override;
     bool addLink(const uint8_t peerId[DEVICE_UID_LEN]) override;
     bool hasLink(const uint8_t peerId[DEVICE_UID_LEN]) const override;
+    uint32_t getLinkGeneration() const override { return _linkGeneration; }
     void incrementTapCount() override;
     void saveTapCountOnly() override;
     void saveLinkOnly() override;
 
+    // Transactions
+    void beginTransaction() override;
+    bool commitTransaction() override;
+
+    // Image transfer
+    size_t imageSize() const override { return sizeof(PersistImageV1); }
+    bool readImage(size_t offset, uint8_t* out, size_t len) override;
+    bool restoreImage(const uint8_t* image, size_t len) override;
+
 private:
     bool loadFromNvm();
+    bool isValidImage(const PersistHeader& header, const uint8_t* payload);
     bool writeToNvm();
+    bool flushPending();
+    void writeRangeToNvm(size_t offset, const uint8_t* data, size_t len);
+    static void onNvmWritten(void* ctx, bool ok);
     uint32_t calcCrc32(const uint8_t* data, size_t len);
 
 private:
@@ -114,4 +133,13 @@ private:
     uint32_t _lastSaveMs = 0;
     uint16_t _lastLinkIndex = 0;       // Track last modified link for optimized save
     bool _linkCountChanged = false;    // Track if linkCount was incremented
+    uint32_t _linkGeneration = 0;      // RAM only, seeded at boot; see getLinkGeneration()
+    volatile bool _nvmFailed = false;  // Set from the NVM interrupt
+
+    // Deferred partial writes (flushed immediately outside a transaction)
+    uint8_t _txnDepth = 0;
+    bool _pendingTapCount = false;
+    bool _pendingLinkCount = false;
+    uint64_t _pendingLinks = 0;        // Bitmap of link slots to write
+    static_assert(PersistPayloadV1::MAX_LINKS <= 64, "_pendingLinks has one bit per link slot");
 };
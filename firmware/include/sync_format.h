@@ -0,0 +1,95 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "storage.h"
+
+// =====================================================
+// Sync Message Formatting
+// =====================================================
+// Builds the byte/text forms used by SIGN_STATE, SYNC, DUMP and DUMPZ.
+// Portable so the same code runs in host tests/benchmarks.
+// =====================================================
+
+constexpr size_t SIGN_NONCE_MAX_LEN = 32;
+
+// msg = selfId(12) + nonce(N) + totalTapCount(4 LE) + linkCount(2 LE) + each peerId(12)
+constexpr size_t SIGN_MSG_MAX_LEN =
+    DEVICE_UID_LEN
+    + SIGN_NONCE_MAX_LEN
+    + 4
+    + 2
+    + (PersistPayloadV1::MAX_LINKS * DEVICE_UID_LEN);
+
+// Assemble the SIGN_STATE message into out (SIGN_MSG_MAX_LEN bytes).
+// Returns the message length.
+size_t sign_message_build(uint8_t* out,
+                          const uint8_t selfId[DEVICE_UID_LEN],
+                          const uint8_t* nonce, size_t nonceLen,
+                          uint32_t tapCount,
+                          const LinkRecordV1* links, uint16_t linkCount);
+
+// =====================================================
+// SYNC Message
+// =====================================================
+// SYNC signs the state it streams without assembling it:
+// the header goes into the HMAC first, then each peerId of
+// links[since..linkCount) as it is printed.
+//
+//   "SYNC" + selfId(12) + nonce(N) + totalTapCount(4 LE)
+//     + linkCount(2 LE) + since(2 LE) + linkGeneration(4 LE)
+//     + [peerId x (linkCount - since)]
+//
+// The tag keeps a SYNC signature from standing in for a
+// SIGN_STATE one over the same counters. The generation
+// ties a since > 0 reply to the slots the host already
+// holds (see IStorage::getLinkGeneration()).
+// =====================================================
+
+constexpr size_t SYNC_HEADER_MAX_LEN = 4 + DEVICE_UID_LEN + SIGN_NONCE_MAX_LEN + 4 + 2 + 2 + 4;
+
+// Assemble the SYNC header into out (SYNC_HEADER_MAX_LEN bytes).
+// Returns the header length.
+size_t sync_header_build(uint8_t* out,
+                         const uint8_t selfId[DEVICE_UID_LEN],
+                         const uint8_t* nonce, size_t nonceLen,
+                         uint32_t tapCount, uint16_t linkCount, uint16_t since,
+                         uint32_t linkGeneration);
+
+// One DUMP item: {"peer":"<24 hex>"}
+constexpr size_t DUMP_ITEM_MAX_LEN = 9 + DEVICE_UID_HEX_LEN + 2 + 1;
+
+// Format one DUMP item into out (DUMP_ITEM_MAX_LEN chars, NUL-terminated).
+// Returns the string length.
+size_t dump_format_item(char* out, const uint8_t peerId[DEVICE_UID_LEN]);
+
+// =====================================================
+// Compressed Link Export (DUMPZ)
+// =====================================================
+// Links sorted by UID, each stored as the bytes that differ
+// from the previous UID. Cards from one production lot share
+// their first 8-10 bytes, so most entries cost 3-5 bytes
+// instead of 12 (24 hex chars plus JSON in DUMP).
+//
+//   version (1 byte) = LINK_EXPORT_VERSION
+//   count            varint
+//   count entries, ascending by UID:
+//     suffix length  varint (0..12; the first UID is
+//                    compared against all zeros)
+//     suffix         the UID's last <suffix length> bytes;
+//                    the rest is the previous UID's prefix
+//   count varints    arrival index of each sorted entry, so a
+//                    host can rebuild DUMP order (SIGN_STATE
+//                    signs links in that order)
+//
+// Varints are unsigned LEB128. Reference decoder:
+// utils/link_export.py.
+// =====================================================
+
+constexpr uint8_t LINK_EXPORT_VERSION = 1;
+
+// version + count varint + worst-case entries + one-byte indexes
+constexpr size_t LINK_EXPORT_MAX_LEN =
+    1 + 2 + PersistPayloadV1::MAX_LINKS * (1 + DEVICE_UID_LEN) + PersistPayloadV1::MAX_LINKS;
+
+// Encode links into out. Returns the length, or 0 if it does not fit in cap.
+size_t link_export_encode(const LinkRecordV1* links, uint16_t count, uint8_t* out, size_t cap);
@@ -14,7 +14,7 @@
 //
 // Protocol:
 // 1. Detection: Presence pulses to detect peer
-// 2. Negotiation: Exchange UID bits to determine master/slave
+// 2. Negotiation: Compare UID bits to determine master/slave
 // 3. Connected: Master (higher UID) and Slave (lower UID) roles assigned
 // 4. Command Phase: Master sends commands, Slave responds
 //
@@ -92,10 +92,40 @@ public:
     
     // ID exchange
     bool masterRequestId(uint8_t peerIdOut[DEVICE_UID_LEN]) override;
-    bool masterSendId() override;
-    void slaveHandleRequestId() override;
-    bool slaveHandleSendId(uint8_t peerIdOut[DEVICE_UID_LEN]) override;
+    void slaveHandleRequestId(TapCommand cmd) override;
+    TapCommand slaveServeCommand() override;
+    bool getPeerId(uint8_t peerIdOut[DEVICE_UID_LEN]) const override;
     bool isIdExchangeComplete() const override { return _idExchangeComplete; }
+
+    // Present a different UID from the next negotiation on (bridge mode
+    // station identity); nullptr restores the hardware UID
+    void setIdentity(const uint8_t id[DEVICE_UID_LEN]);
+
+    // Peer clock skew measured from its sync pulse (+ = peer slower), ppm
+    int32_t getPeerSkewPpm() const { return _peerSkewPpm; }
+
+    // Low-power detection: presence pulses every PULSE_INTERVAL_LOW_POWER_US.
+    // The line is still sampled every poll(), so a peer's pulse is seen at once.
+    void setLowPower(bool lowPower) { _lowPower = lowPower; }
+
+    // Stopping the core between presence pulses (platform_lowpower):
+    // how long it may stop before the next pulse is due; 0 unless idle
+    // with the line released and no pulse in progress
+    uint32_t idleBudgetUs();
+
+    // Presence pulse timing, for a timer that beacons in our place
+    uint32_t presenceIntervalUs() const {
+        return _lowPower ? PULSE_INTERVAL_LOW_POWER_US : PULSE_INTERVAL_US;
+    }
+    static constexpr uint32_t presencePulseUs() { return PRESENCE_PULSE_US; }
+
+    // A presence pulse was sent without poll() (timer beacon): the next
+    // one is due a full interval from now
+    void notePresencePulse() { _lastPulseTime = halMicros(); }
+
+    // A falling edge woke the core from STOP; the pulse behind it may be
+    // over before poll() samples the line, so treat it as seen
+    void notePeerEdge();
 #else
     // Check if connection was just established
     bool isConnectionEstablished() override;
@@ -119,6 +149,7 @@ private:
     static constexpr uint32_t DEBOUNCE_TIME_US = 5000;   // 5ms debounce
     static constexpr uint32_t PRESENCE_PULSE_US = 2000;  // 2ms presence pulse
     static constexpr uint32_t PULSE_INTERVAL_US = 50000; // 50ms between pulses
+    static constexpr uint32_t PULSE_INTERVAL_LOW_POWER_US = 500000;  // 500ms while no USB host
 
     // Negotiation timing constants (microseconds)
     static constexpr uint32_t BIT_DRIVE_US = 5000;
@@ -126,17 +157,23 @@ private:
     static constexpr uint32_t BIT_RECOVERY_US = 2000;    // 2ms recovery between bits
     static constexpr uint32_t SYNC_PULSE_US = 10000;     // 10ms sync pulse
     static constexpr uint32_t SYNC_WAIT_US = 5000;       // 5ms wait after sync
-    static constexpr uint32_t NEGOTIATION_BITS = 32;     // First 32 bits of UID for negotiation
+    static constexpr uint32_t SYNC_EXTEND_US = 2000;     // Initiator's second sync runs longer
+    static constexpr uint32_t LATE_SYNC_MARGIN_US = 3000;  // Wait for an older initiator's second sync
+    static constexpr int32_t MAX_PEER_SKEW_PPM = 30000;  // Ignore sync measurements beyond 3%
+    static constexpr uint32_t NEGOTIATION_BITS = 32;     // First 32 bits of UID for negotiation (V1)
 
     // Command protocol timing constants (microseconds)
     static constexpr uint32_t CMD_START_PULSE_US = 5000;   // 5ms START pulse (longer than presence)
     static constexpr uint32_t CMD_TURNAROUND_US = 2000;    // 2ms turnaround between send/receive
+    static constexpr uint32_t CMD_REPLY_TURNAROUND_US = 1000;  // Slave: command byte to reply (master keeps 2ms)
     static constexpr uint32_t CMD_TIMEOUT_US = 100000;     // 100ms command timeout
     static constexpr uint32_t CMD_BIT_DRIVE_US = 5000;     // 5ms bit drive (same as negotiation)
     static constexpr uint32_t CMD_BIT_SAMPLE_US = 2500;    // Sample at 2.5ms
     static constexpr uint32_t CMD_BIT_RECOVERY_US = 2000;  // 2ms recovery between bits
     static constexpr uint8_t MAX_COMMAND_FAILURES = 3;     // Disconnect after 3 failed commands
     static constexpr uint32_t SLAVE_IDLE_TIMEOUT_US = 2000000;  // 2 seconds - slave disconnects if no command
+    static constexpr uint32_t SEND_ID_SETTLE_US = 100000;  // V1 slave stores the link after SEND_ID
+    static constexpr uint8_t LINE_IDLE_BYTE = 0xFF;        // Nothing sent (never a valid ID frame header)
 #else
     // Detection timing constants (microseconds)
     static constexpr uint32_t VALIDATION_TIME_US = 10000;  // 10ms validation after wake-up
@@ -146,8 +183,9 @@ private:
     // Helper functions
     uint32_t elapsedMicros(uint32_t startTime);
 #ifdef EVAL_BOARD_TEST
-    void startNegotiation();
+    void startNegotiation(bool peerSyncSeen);
     void pollNegotiation();
+    void finishNegotiation();
     bool sendBit(bool bit);
     bool readBit();
     
@@ -157,12 +195,32 @@ private:
     void sendBytes(const uint8_t* data, size_t len);
     bool receiveBytes(uint8_t* data, size_t len);
     void sendStartPulse();
+    void commandFailed();  // Count a failed master command, disconnect after MAX_COMMAND_FAILURES
     bool waitForLineHigh(uint32_t timeoutUs);
+    uint32_t peerUs(uint32_t us) const;
+
+    // Slave replies. Only REQUEST_ID's (ACK + raw UID, for a V1
+    // master) carries a body; it is built once our UID is known so
+    // the reply can start the moment the command byte has been read
+    struct SlaveReply {
+        uint8_t len;
+        uint8_t bytes[1 + DEVICE_UID_LEN];   // response code + raw UID
+    };
+    void prepareSlaveReplies();
+    const SlaveReply& slaveReplyFor(TapCommand cmd) const;
+    void sendSlaveReply(TapCommand cmd);
+    void slaveReceiveId();
 #else
     bool validateConnection();  // Check if tap connection is stable
 #endif
 
     IOneWireHal* _hal;
+    OneWireHalOps _ops;            // _hal's primitives, called without its vtable
+
+    bool halReadLine() { return _ops.readLine(_hal); }
+    void halDriveLow(bool enableLow) { _ops.driveLow(_hal, enableLow); }
+    uint32_t halMicros() { return _ops.micros(_hal); }
+    void halDelayMicros(uint32_t us) { _ops.delayMicros(_hal, us); }
 
     DetectionState _state;
     uint32_t _stateStartTime;
@@ -180,19 +238,27 @@ private:
     uint32_t _lastPulseTime;       // When we last sent a presence pulse
     bool _isPulsing;               // Are we currently sending a pulse?
     uint32_t _pulseStartTime;      // When current pulse started
+    bool _lowPower;                // Slow presence pulses (setLowPower)
 
     // Negotiation state
     uint8_t _negotiationBitIndex;
     uint32_t _bitSlotStartTime;
     bool _waitingForSync;
     bool _syncSent;
+    uint8_t _peerId[DEVICE_UID_LEN];  // Master's UID from SEND_ID (slave only)
+    uint8_t _nextSelfId[DEVICE_UID_LEN];  // Identity for the next negotiation
+    bool _peerIdKnown;
     uint32_t _randomSeed;          // For tie-breaker
+    int32_t _peerSkewPpm;          // Peer clock skew from its sync pulse width
+    uint32_t _peerScaleQ16;        // peerUs() factor, 16.16 (no divide on the bit path)
     
     // Command protocol state
     bool _peerReady;               // True when peer responded ACK to CHECK_READY
     uint32_t _lastCommandTime;     // For master: command rate limiting; for slave: last command received
     uint8_t _commandFailures;      // Count of consecutive command failures (master only)
-    bool _idExchangeComplete;      // True when both REQUEST_ID and SEND_ID have succeeded
+    bool _idExchangeComplete;      // True when both UIDs have crossed
+    bool _idSent;                  // Master: SEND_ID acknowledged; slave: our UID sent
+    SlaveReply _replyId;           // ACK + raw UID
 #else
     uint32_t _lastWakeTime;
     bool _connectionJustEstablished;
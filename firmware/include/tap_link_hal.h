@@ -2,6 +2,18 @@
 #pragma once
 #include <stdint.h>
 
+struct IOneWireHal;
+
+// The line and time primitives as plain function pointers. TapLink
+// copies them into its own state (RAM), so its bit engine reaches the
+// HAL without loading a vtable from flash (see platform_ramfunc.h).
+struct OneWireHalOps {
+    bool (*readLine)(IOneWireHal* hal);
+    void (*driveLow)(IOneWireHal* hal, bool enableLow);
+    uint32_t (*micros)(IOneWireHal* hal);
+    void (*delayMicros)(IOneWireHal* hal, uint32_t us);
+};
+
 struct IOneWireHal {
     virtual ~IOneWireHal() = default;
 
@@ -15,6 +27,13 @@ struct IOneWireHal {
     // Time utilities
     virtual uint32_t micros() = 0;
     virtual void delayMicros(uint32_t us) = 0;
+
+    // Next timeout is due in inUs (lets a simulated clock skip ahead)
+    virtual void deadlineHint(uint32_t inUs) { (void)inUs; }
+
+    // Direct entry points for the four primitives above, if the
+    // implementation has them. Returns false to use the virtual calls.
+    virtual bool getOps(OneWireHalOps* ops) { (void)ops; return false; }
 };
 
 // Factory function to create HAL instance (platform-specific)
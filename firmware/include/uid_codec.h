@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "device_id.h"
+
+// =====================================================
+// Compact UID Encoding (tap link ID frames)
+// =====================================================
+// STM32L0 UID bytes (in getDeviceUidRaw order):
+//   [0]     wafer number
+//   [1..7]  lot number (ASCII)
+//   [8..9]  X coordinate on wafer (big-endian)
+//   [10..11] Y coordinate on wafer (big-endian)
+//
+// Cards from one production batch share the lot (and often
+// the wafer), so a UID is sent relative to a dictionary both
+// sides already hold: the master's UID, which the slave has
+// just received with SEND_ID.
+//
+// Frame: header byte + body, body length in header[3:0]
+//   header bit 7 RAW      body = 12 raw UID bytes
+//   header bit 6 LOT_SAME lot omitted (else 7 bytes in body)
+//   header bit 5 WAF_SAME wafer omitted (else 1 byte in body)
+//   then X and Y as unsigned LEB128 varints (1-3 bytes each)
+// The encoder falls back to RAW whenever that is not longer.
+// =====================================================
+
+constexpr uint8_t UID_COMPACT_RAW      = 0x80;
+constexpr uint8_t UID_COMPACT_LOT_SAME = 0x40;
+constexpr uint8_t UID_COMPACT_WAF_SAME = 0x20;
+constexpr uint8_t UID_COMPACT_LEN_MASK = 0x0F;
+
+constexpr size_t UID_COMPACT_MAX_LEN = 1 + DEVICE_UID_LEN;
+
+// Encode uid against dict into out. Returns the frame length.
+size_t uid_compact_encode(const uint8_t uid[DEVICE_UID_LEN],
+                          const uint8_t dict[DEVICE_UID_LEN],
+                          uint8_t out[UID_COMPACT_MAX_LEN]);
+
+// Body length announced by a frame header
+inline size_t uid_compact_body_len(uint8_t header) {
+    return header & UID_COMPACT_LEN_MASK;
+}
+
+// Decode a full frame (header + body). Returns false if malformed.
+bool uid_compact_decode(const uint8_t* frame, size_t len,
+                        const uint8_t dict[DEVICE_UID_LEN],
+                        uint8_t uidOut[DEVICE_UID_LEN]);
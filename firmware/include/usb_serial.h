@@ -4,6 +4,9 @@
 #include <string.h>
 #include "i_storage.h"
 #include "device_id.h"
+#include "self_test.h"
+#include "image_transfer.h"
+#include "response_schema.h"
 
 // Forward declaration (full definition in storage.h)
 struct PersistPayloadV1;
@@ -28,6 +31,33 @@ public:
     // Call periodically to process input and output responses
     void poll(IStorage& storage);
 
+    // Bridge mode (BRIDGE ON/OFF): a station card streams each completed
+    // exchange to the host as a "tap" event instead of storing it
+    bool isBridgeMode() const { return _bridgeOn; }
+
+    // Station identity injected with BRIDGE ON <id>; false = hardware UID
+    bool getBridgeIdentity(uint8_t idOut[DEVICE_UID_LEN]) const;
+
+    // True once after BRIDGE changes the mode or identity
+    bool takeBridgeChange();
+
+    // Report a completed exchange to the host
+    void publishTap(const uint8_t selfId[DEVICE_UID_LEN],
+                    const uint8_t peerId[DEVICE_UID_LEN], bool isMaster);
+
+    // True once after SELFTEST; the application runs the checks (it
+    // owns the pins and the tap line) and reports back
+    bool takeSelfTestRequest();
+
+    // Report a finished self-test, or that the card was busy (mid-tap)
+    void publishSelfTest(const SelfTestReport& report);
+    void publishSelfTestBusy();
+
+    // True once after POWER; the application names its states and
+    // publishPower() reports the clocks seen in each (platform_power.h)
+    bool takePowerRequest();
+    void publishPower(const char* const* stateNames, uint8_t stateCount);
+
 private:
     static constexpr size_t CMD_BUF_SIZE = 128;
     char _buf[CMD_BUF_SIZE];
@@ -39,15 +69,83 @@ private:
     void cmdHello(IStorage& storage);
     void cmdGetState(IStorage& storage);
     void cmdClear(IStorage& storage);
-    void cmdDump(IStorage& storage, int offset, int count);
+    void cmdSnapshot(IStorage& storage);
+    void cmdDump(IStorage& storage, int offset, int count, const char* snapTok);
+    void cmdDumpCompressed(IStorage& storage, const char* snapTok);
     void cmdProvisionKey(IStorage& storage, int version, const char* keyHex);
-    void cmdSignState(IStorage& storage, const char* nonceHex);
+    void cmdSignState(IStorage& storage, const char* nonceHex, const char* snapTok);
+    void cmdSync(IStorage& storage, const char* nonceHex, const char* sinceTok, const char* genTok);
+    // Decode a 2-64 char hex nonce into nonce (SIGN_NONCE_MAX_LEN bytes);
+    // prints an error and returns false if it is malformed
+    bool parseNonce(const char* nonceHex, uint8_t* nonce, size_t& nonceLen);
+    void cmdBridge(const char* modeTok, const char* idHex);
+    void cmdImageBegin(IStorage& storage);
+    void cmdImageAuth(IStorage& storage, const char* hmacHex);
+    void cmdImageRead(IStorage& storage, const char* offTok, const char* lenTok);
+    void cmdImageWrite(const char* offTok, const char* lenTok, const char* crcTok);
+    void cmdImageCommit(IStorage& storage);
+    void pollImageWrite();
+    void finishImageWrite();
+    void printImageError(const char* msg);
+    void cmdFormat(const char* modeTok);
+    void cmdSchema();
 #ifdef ENABLE_TEST_COMMANDS
     void cmdGetKey(IStorage& storage);
 #endif
 
-    // Utility functions
-    void printHex(const uint8_t* data, size_t len);
-    bool hexToBytes(const char* hex, uint8_t* out, size_t outLen);
-    void bytesToHex(const uint8_t* in, size_t len, char* out);
+    // Replies go out as JSON lines or binary frames (FORMAT JSON|BIN);
+    // fixed-shape replies are declared in response_schema.h
+    ResponseFormat _format = RESPONSE_JSON;
+
+    template <typename T>
+    void send(const ResponseSchemaOf<T>& schema, const T& values, bool flush = true) {
+        sendEncoded(schema.schema, &values, flush);
+    }
+    void sendEncoded(const ResponseSchema& schema, const void* values, bool flush);
+    void sendError(const char* msg);
+
+    // Hot replies kept encoded for the current format (rebuilt after
+    // FORMAT). HELLO is cached whole; GET_STATE keeps the text around
+    // its two counters. Sizes hold the longest build strings plus margin.
+    static constexpr size_t HELLO_REPLY_MAX_LEN = 128;
+    static constexpr size_t STATE_REPLY_MAX_LEN = 64;
+    ResponseTemplate<HelloResponse, HELLO_REPLY_MAX_LEN> _helloReply;
+    ResponseTemplate<StateResponse, STATE_REPLY_MAX_LEN> _stateReply;
+    bool buildHelloReply();
+
+    // Snapshot of tap count and link count for multi-command sync.
+    // Links are append-only until cleared or overwritten, so the link
+    // generation is enough to tell whether links[0..linkCount) still hold.
+    struct Snapshot {
+        uint32_t id;              // 0 = no snapshot taken
+        uint32_t linkGeneration;
+        uint32_t totalTapCount;
+        uint16_t linkCount;
+    };
+    Snapshot _snap = {};
+    uint32_t _nextSnapId = 1;
+
+    bool _bridgeOn = false;
+    bool _bridgeIdSet = false;
+    bool _bridgeChanged = false;
+    uint8_t _bridgeId[DEVICE_UID_LEN] = {};
+    uint32_t _bridgeSeq = 0;
+
+    bool _selfTestRequested = false;
+    bool _powerRequested = false;
+
+    // IMAGE_WRITE: the raw bytes following the command line
+    static constexpr uint32_t IMAGE_RX_TIMEOUT_MS = 1000;
+    ImageTransfer _image;
+    size_t _imageRxOffset = 0;
+    size_t _imageRxLen = 0;
+    size_t _imageRxPos = 0;
+    uint32_t _imageRxCrc = 0;
+    uint32_t _imageRxLastMs = 0;
+
+    // Resolve the tap/link counts a command should report: live state when
+    // snapTok is null, else the snapshot. Prints an error and returns false
+    // if the snapshot is unknown or stale.
+    bool resolveView(IStorage& storage, const char* snapTok,
+                     uint32_t& tapCount, uint16_t& linkCount);
 };
@@ -2,10 +2,31 @@
 #include "board_config.h"
 #include "tap_link_hal.h"
 #include "platform_timing.h"
+#include "platform_clock.h"
+#include "platform_ramfunc.h"
+#include "platform_power.h"
+#include "platform_lowpower.h"
+#include "lowpower_policy.h"
+#include "platform_usb.h"
+#include "debug_log.h"
+#include "self_test.h"
 
 // LED pin configuration
 static const uint32_t STATUS_LED_PINS[] = { STATUS_LED0_PIN, STATUS_LED1_PIN };
 
+// Power states are the tap link states, in enum order (POWER reply)
+#ifdef EVAL_BOARD_TEST
+static const char* const POWER_STATE_NAMES[] = {
+    "no_connection", "detecting", "negotiating", "connected"
+};
+#else
+static const char* const POWER_STATE_NAMES[] = {
+    "sleeping", "waking", "negotiating", "connected", "disconnected"
+};
+#endif
+static constexpr uint8_t POWER_STATE_COUNT = sizeof(POWER_STATE_NAMES) / sizeof(POWER_STATE_NAMES[0]);
+static_assert(POWER_STATE_COUNT <= PLATFORM_POWER_STATE_MAX, "too many power states");
+
 // Buzzer timing constants
 static constexpr uint32_t SUCCESS_TONE_DELAY_MS = 150;  // Delay before success tone
 
@@ -13,6 +34,11 @@ Application::Application()
     : _tapLink(nullptr)
     , _connectionDetectedTime(0)
     , _lastCommandTime(0)
+    , _tapTxnOpen(false)
+    , _lastClockCalTime(0)
+    , _clockCalibrated(false)
+    , _clockCalRunning(false)
+    , _lowPower(false)
 {
 }
 
@@ -24,8 +50,12 @@ Application::~Application() {
 }
 
 void Application::init() {
-    // Initialize platform abstractions
+    // Initialize platform abstractions (power first: the rest acquire clocks)
+    platform_power_begin();
+    platform_ramfunc_begin();
     platform_timing_init();
+    platform_clock_begin();
+    debug_log_begin();
 
     // Initialize status display
     _statusDisplay.begin(STATUS_LED_PINS, 2);
@@ -39,11 +69,28 @@ void Application::init() {
     _storage.begin();
 
     // Initialize USB command handler
+    platform_usb_begin();
     _usb.begin(115200);
 
     // Initialize tap link with hardware abstraction
     IOneWireHal* hal = createOneWireHal();
     _tapLink = new TapLink(hal);
+#ifdef EVAL_BOARD_TEST
+    if (!platform_lowpower_begin(TAP_LINK_PIN)) {
+        DEBUG_LOG("power: no STOP wake-up on the tap pin");
+    }
+#endif
+
+    // Everything is configured now: whatever is still a floating input is unused
+    static const uint32_t KEEP_PINS[] = {
+        STATUS_LED0_PIN, STATUS_LED1_PIN, BUZZER_PIN, TAP_LINK_PIN,
+#ifdef USB_VBUS_SENSE_PIN
+        USB_VBUS_SENSE_PIN,
+#endif
+    };
+    uint32_t idled = platform_power_idle_pins(KEEP_PINS, sizeof(KEEP_PINS) / sizeof(KEEP_PINS[0]));
+    DEBUG_LOG("power: %u pins idle, clocks=0x%02x", idled, platform_power_active_mask());
+    (void)idled;  // DEBUG_LOG compiles out without ENABLE_DEBUG_LOG
 }
 
 void Application::loop() {
@@ -54,10 +101,27 @@ void Application::loop() {
 
     // Process USB commands
     _usb.poll(_storage);
+#ifdef EVAL_BOARD_TEST
+    if (_usb.takeBridgeChange() && _tapLink) {
+        applyBridgeIdentity();
+    }
+#endif
+    if (_usb.takeSelfTestRequest() && _tapLink) {
+        runSelfTest();
+    }
+    if (_usb.takePowerRequest()) {
+        _usb.publishPower(POWER_STATE_NAMES, POWER_STATE_COUNT);
+    }
+
+    // Hand queued debug log records to the log UART
+    debug_log_flush();
 
     // Process tap link
     if (_tapLink) {
+        calibrateClock(nowMs);
         _tapLink->poll();
+        platform_power_set_state((uint8_t)_tapLink->getState());
+        updatePowerMode();
         updateStatusDisplay();
 
 #ifdef EVAL_BOARD_TEST
@@ -82,6 +146,12 @@ void Application::loop() {
                 handleSlaveCommands();
             }
         }
+
+        // Tap ended before the ID exchange - still persist the tap count
+        if (_tapTxnOpen &&
+            _tapLink->getState() != TapLink::DetectionState::Connected) {
+            commitTapTransaction();
+        }
 #else
         handleBatteryMode(nowMs);
 #endif
@@ -94,7 +164,122 @@ void Application::loop() {
     _buzzer.loop();
 
     // Fast polling needed to detect 2ms presence pulses
-    platform_delay_ms(1);
+    if (_lowPower) {
+        idleLowPower();
+    } else {
+        platform_delay_ms(1);
+    }
+}
+
+void Application::idleLowPower() {
+#ifdef EVAL_BOARD_TEST
+    // With no host on the bus nothing else needs the core until the
+    // next presence pulse (or a peer's): stop it. A suspended host
+    // can still resume us, and an attached one that has not addressed
+    // us yet must get its bus reset answered, so both keep to the
+    // 1 ms WFI idle (lowpower_policy.h).
+    uint32_t budgetUs = _tapLink ? _tapLink->idleBudgetUs() : 0;
+    if (budgetUs >= STOP_MIN_US && !_buzzer.isPlaying() &&
+        lowpower_stop_allowed(platform_usb_clocked(), platform_usb_state(), platform_usb_supply())) {
+        uint32_t pulses = 0;
+        platform_wake_t why;
+        if (platform_lowpower_has_beacon()) {
+            why = platform_lowpower_stop(STOP_MAX_US, _tapLink->presenceIntervalUs(),
+                                         TapLink::presencePulseUs(), &pulses);
+        } else {
+            why = platform_lowpower_stop(budgetUs, 0, 0, nullptr);
+        }
+        if (pulses > 0) {
+            _tapLink->notePresencePulse();
+        }
+        if (why == PLATFORM_WAKE_LINE) {
+            _tapLink->notePeerEdge();
+            DEBUG_LOG("power: woken by the tap line after %u pulses", pulses);
+        }
+        if (why != PLATFORM_WAKE_SKIPPED) {
+            return;
+        }
+    }
+#endif
+    platform_power_idle_ms(1);
+}
+
+// =====================================================
+// USB Suspend / Low Power
+// =====================================================
+
+void Application::updatePowerMode() {
+    // Without an active host nobody watches the LEDs; a tap in
+    // progress still runs at full power so it shows and beeps
+    platform_usb_state_t usb = platform_usb_state();
+    bool lowPower = usb != PLATFORM_USB_ACTIVE && _tapLink->isIdle();
+    if (lowPower == _lowPower) {
+        return;
+    }
+    _lowPower = lowPower;
+
+    _statusDisplay.setDark(lowPower);
+#ifdef EVAL_BOARD_TEST
+    _tapLink->setLowPower(lowPower);
+#endif
+    DEBUG_LOG("power: %s, usb %s, supply %s", lowPower ? "low" : "full",
+              platform_usb_state_name(usb), platform_usb_supply_name(platform_usb_supply()));
+}
+
+// =====================================================
+// Clock Calibration
+// =====================================================
+
+void Application::calibrateClock(uint32_t nowMs) {
+    // Each step blocks for a few ms and may move the trim, so only
+    // between taps. An open SOF window keeps counting during a tap.
+    if (!_tapLink->isIdle()) {
+        return;
+    }
+    if (!_clockCalRunning) {
+        uint32_t interval = _clockCalibrated ? CLOCK_CAL_INTERVAL_MS : CLOCK_CAL_RETRY_MS;
+        if (nowMs - _lastClockCalTime < interval) {
+            return;
+        }
+        _lastClockCalTime = nowMs;
+    }
+
+    platform_clock_cal_t cal;
+    platform_clock_cal_status_t status = platform_clock_calibrate(&cal);
+    _clockCalRunning = (status == PLATFORM_CLOCK_CAL_BUSY);
+    if (status == PLATFORM_CLOCK_CAL_DONE) {
+        _clockCalibrated = true;
+        DEBUG_LOG("clock: ref=%u err=%dppm residual=%dppm trim=%u",
+                  cal.ref, cal.errorPpm, cal.residualPpm, cal.trimmed ? cal.trim : 0xFF);  // 255 = SYSCLK not on HSI
+    }
+}
+
+// =====================================================
+// Manufacturing Self-Test
+// =====================================================
+
+void Application::runSelfTest() {
+    // The line check drives the tap line, so never run it mid-tap
+    if (!_tapLink->isIdle()) {
+        _usb.publishSelfTestBusy();
+        return;
+    }
+
+    SelfTestConfig config = {};
+    config.line = createOneWireHal();
+    config.ledPins = STATUS_LED_PINS;
+    config.ledCount = 2;
+    config.buzzerPin = BUZZER_PIN;
+    config.scratchAddress = STORAGE_SCRATCH_ADDR;
+
+    SelfTestReport report;
+    self_test_run(config, report);
+    DEBUG_LOG("selftest: fail=0x%02x in %ums, stall=%u/%uus", report.failMask,
+              report.durationMs, report.nvmStallFlashUs, report.nvmStallRamUs);
+    _usb.publishSelfTest(report);
+
+    // Our own line pulses must not count as a peer
+    _tapLink->reset();
 }
 
 // =====================================================
@@ -193,10 +378,50 @@ void Application::onNegotiationComplete(uint32_t nowMs) {
     _connectionDetectedTime = nowMs;
     _lastCommandTime = nowMs;
 
-    // Increment tap count for both master and slave
-    // Use optimized save (8 bytes vs 896) since tap can be very brief
+    // Bridge mode: the host records the tap, nothing is stored locally
+    if (_usb.isBridgeMode()) {
+        return;
+    }
+
+    // Increment tap count for both master and slave. The save is held in
+    // a transaction so the link from the ID exchange lands in the same write.
+    if (!_tapTxnOpen) {
+        _storage.beginTransaction();
+        _tapTxnOpen = true;
+    }
     _storage.incrementTapCount();
     _storage.saveTapCountOnly();
+    DEBUG_LOG("app: tap #%u", _storage.state().totalTapCount);
+}
+
+void Application::onIdExchanged(const uint8_t peerId[DEVICE_UID_LEN]) {
+    if (_usb.isBridgeMode()) {
+        _usb.publishTap(_tapLink->getSelfId(), peerId, _tapLink->isMaster());
+    } else {
+        if (_storage.addLink(peerId)) {
+            _storage.saveLinkOnly();
+        }
+        commitTapTransaction();
+    }
+    // Schedule success tone with delay (ID exchange happens fast)
+    _buzzer.scheduleSuccessTone(SUCCESS_TONE_DELAY_MS);
+}
+
+void Application::applyBridgeIdentity() {
+    // Takes effect from the next negotiation
+    uint8_t stationId[DEVICE_UID_LEN];
+    if (_usb.getBridgeIdentity(stationId)) {
+        _tapLink->setIdentity(stationId);
+    } else {
+        _tapLink->setIdentity(nullptr);
+    }
+}
+
+void Application::commitTapTransaction() {
+    if (_tapTxnOpen) {
+        _storage.commitTransaction();
+        _tapTxnOpen = false;
+    }
 }
 
 void Application::handleMasterCommands(uint32_t nowMs) {
@@ -209,14 +434,9 @@ void Application::handleMasterCommands(uint32_t nowMs) {
         _tapLink->masterSendCommand(TapCommand::CHECK_READY);
     } else if (!_tapLink->isIdExchangeComplete()) {
         uint8_t peerId[DEVICE_UID_LEN];
+        // SEND_ID, then REQUEST_ID if the slave did not answer with its UID
         if (_tapLink->masterRequestId(peerId)) {
-            if (_tapLink->masterSendId()) {
-                if (_storage.addLink(peerId)) {
-                    _storage.saveLinkOnly();
-                }
-                // Schedule success tone with delay (ID exchange happens fast)
-                _buzzer.scheduleSuccessTone(SUCCESS_TONE_DELAY_MS);
-            }
+            onIdExchanged(peerId);
         }
     } else {
         _tapLink->masterSendCommand(TapCommand::CHECK_READY);
@@ -226,40 +446,19 @@ void Application::handleMasterCommands(uint32_t nowMs) {
 }
 
 void Application::handleSlaveCommands() {
-    // SLAVE: Check for incoming commands and respond
+    // SLAVE: Check for incoming commands; TapLink answers them itself
     if (!_tapLink->slaveHasCommand()) {
         return;
     }
 
-    TapCommand cmd = _tapLink->slaveReceiveCommand();
-    switch (cmd) {
-        case TapCommand::CHECK_READY:
-            _tapLink->slaveSendResponse(TapResponse::ACK);
-            break;
-
-        case TapCommand::REQUEST_ID:
-            _tapLink->slaveHandleRequestId();
-            break;
-
-        case TapCommand::SEND_ID: {
-            uint8_t peerId[DEVICE_UID_LEN];
-            if (_tapLink->slaveHandleSendId(peerId)) {
-                if (_storage.addLink(peerId)) {
-                    _storage.saveLinkOnly();
-                }
-                // Schedule success tone with delay (ID exchange happens fast)
-                _buzzer.scheduleSuccessTone(SUCCESS_TONE_DELAY_MS);
-            }
-            break;
-        }
+    bool idPending = !_tapLink->isIdExchangeComplete();
+    _tapLink->slaveServeCommand();
 
-        case TapCommand::NONE:
-            // Was just a presence pulse, ignore
-            break;
-
-        default:
-            _tapLink->slaveSendResponse(TapResponse::NAK);
-            break;
+    // Record the link once both UIDs have crossed (SEND_ID, plus
+    // REQUEST_ID from a V1 master); repeat requests are just resends
+    uint8_t peerId[DEVICE_UID_LEN];
+    if (idPending && _tapLink->isIdExchangeComplete() && _tapLink->getPeerId(peerId)) {
+        onIdExchanged(peerId);
     }
 }
 
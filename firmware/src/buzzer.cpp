@@ -131,6 +131,8 @@ void Buzzer::loop() {
         if (elapsed >= _scheduledDelayMs) {
             _scheduledPending = false;
             playSuccessTone();
+        } else {
+            platform_timing_hint_deadline_ms(_scheduledDelayMs - elapsed);
         }
     }
 
@@ -139,6 +141,14 @@ void Buzzer::loop() {
         updateMelody();
     }
 
+    // Next note or pause boundary
+    if (_melodyActive && _melody) {
+        const Note& current = _melody[_melodyIndex];
+        uint32_t phaseMs = _inPause ? current.pauseAfterMs : current.durationMs;
+        uint32_t elapsed = platform_millis() - _noteStartMs;
+        platform_timing_hint_deadline_ms(elapsed < phaseMs ? phaseMs - elapsed : 0);
+    }
+
     // Update simple tone state
     if (_isPlaying && !_melodyActive) {
         _isPlaying = platform_buzzer_is_playing();
@@ -0,0 +1,27 @@
+#include "crc32.h"
+
+// Nibble table: 64 bytes of flash instead of 1 KB for a byte table
+static const uint32_t CRC_NIBBLE_TABLE[16] = {
+    0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
+    0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
+    0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
+    0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
+};
+
+uint32_t crc32_stm32_sw(const uint8_t* data, size_t len) {
+    if (len % 4 != 0)
+        return 0;
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i += 4) {
+        uint32_t word = (uint32_t)data[i]
+                      | ((uint32_t)data[i + 1] << 8)
+                      | ((uint32_t)data[i + 2] << 16)
+                      | ((uint32_t)data[i + 3] << 24);
+        crc ^= word;
+        for (int n = 0; n < 8; n++) {
+            crc = (crc << 4) ^ CRC_NIBBLE_TABLE[crc >> 28];
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,107 @@
+#include "debug_log.h"
+
+#ifdef ENABLE_DEBUG_LOG
+
+#include "platform_log.h"
+#include "platform_timing.h"
+#include <stdio.h>
+#include <string.h>
+
+// =====================================================
+// Record ring (single producer, single consumer)
+// =====================================================
+// The producer writes only _head, the consumer only _tail.
+// A record is filled before _head is advanced past it, so
+// the consumer never sees a half-written record.
+
+struct LogRecord {
+    const char* fmt;
+    uint32_t timestampUs;
+    uint32_t args[DEBUG_LOG_MAX_ARGS];
+};
+
+static constexpr uint8_t RING_SIZE = 16;  // Power of two
+static constexpr size_t TX_BUF_SIZE = 192;
+static constexpr size_t LINE_MAX = 96;
+
+static LogRecord g_ring[RING_SIZE];
+static volatile uint8_t g_head = 0;
+static volatile uint8_t g_tail = 0;
+static volatile uint32_t g_dropped = 0;
+static uint32_t g_droppedReported = 0;
+
+// Owned by the DMA while platform_log_busy()
+static uint8_t g_tx[TX_BUF_SIZE];
+
+static inline void compilerBarrier() {
+    __asm__ volatile("" ::: "memory");
+}
+
+void debug_log_begin() {
+    platform_log_begin(DEBUG_LOG_BAUD);
+}
+
+void debug_log_record(const char* fmt, uint8_t nargs, const uint32_t* args) {
+    uint8_t head = g_head;
+    uint8_t next = (head + 1) & (RING_SIZE - 1);
+    if (next == g_tail) {
+        g_dropped++;
+        return;
+    }
+
+    LogRecord& r = g_ring[head];
+    r.fmt = fmt;
+    r.timestampUs = platform_micros();
+    for (uint8_t i = 0; i < DEBUG_LOG_MAX_ARGS; i++) {
+        r.args[i] = (i < nargs) ? args[i] : 0;
+    }
+
+    compilerBarrier();  // Publish the record before the index
+    g_head = next;
+}
+
+// Append one formatted line to g_tx; false if it does not fit
+static bool appendLine(size_t& len, const char* line, int n) {
+    if (n <= 0) return true;
+    if ((size_t)n > LINE_MAX - 3) n = LINE_MAX - 3;  // snprintf truncated
+    if (len + n + 2 > TX_BUF_SIZE) return false;
+    memcpy(g_tx + len, line, n);
+    len += n;
+    g_tx[len++] = '\r';
+    g_tx[len++] = '\n';
+    return true;
+}
+
+void debug_log_flush() {
+    // Previous transfer still owns g_tx
+    if (platform_log_busy()) return;
+
+    size_t len = 0;
+    char line[LINE_MAX];
+
+    uint32_t dropped = g_dropped;
+    if (dropped != g_droppedReported) {
+        int n = snprintf(line, sizeof(line), "[log] %lu dropped",
+                         (unsigned long)(dropped - g_droppedReported));
+        appendLine(len, line, n);
+        g_droppedReported = dropped;
+    }
+
+    while (g_tail != g_head) {
+        const LogRecord& r = g_ring[g_tail];
+        int n = snprintf(line, sizeof(line), "%10lu ", (unsigned long)r.timestampUs);
+        n += snprintf(line + n, sizeof(line) - n, r.fmt,
+                      r.args[0], r.args[1], r.args[2], r.args[3]);
+        if (!appendLine(len, line, n)) {
+            break;  // Send what we have; this record goes out next time
+        }
+        compilerBarrier();  // Done reading the record before releasing it
+        g_tail = (g_tail + 1) & (RING_SIZE - 1);
+    }
+
+    if (len > 0) {
+        platform_log_start(g_tx, len);
+    }
+}
+
+#endif
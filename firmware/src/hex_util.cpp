@@ -0,0 +1,31 @@
+#include "hex_util.h"
+#include <string.h>
+
+static int hexVal(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return 10 + c - 'A';
+    if (c >= 'a' && c <= 'f') return 10 + c - 'a';
+    return -1;
+}
+
+bool hex_decode(const char* hex, uint8_t* out, size_t outLen) {
+    size_t len = strlen(hex);
+    if (len != outLen * 2) return false;
+
+    for (size_t i = 0; i < outLen; ++i) {
+        int hi = hexVal(hex[2*i]);
+        int lo = hexVal(hex[2*i+1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = (hi << 4) | lo;
+    }
+    return true;
+}
+
+void hex_encode(const uint8_t* in, size_t len, char* out) {
+    static const char DIGITS[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < len; ++i) {
+        out[2*i]   = DIGITS[in[i] >> 4];
+        out[2*i+1] = DIGITS[in[i] & 0x0F];
+    }
+    out[2*len] = '\0';
+}
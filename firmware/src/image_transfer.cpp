@@ -0,0 +1,56 @@
+#include "image_transfer.h"
+#include "crc32.h"
+#include <string.h>
+
+size_t image_auth_message_build(uint8_t out[IMAGE_AUTH_MSG_LEN],
+                                const uint8_t selfId[DEVICE_UID_LEN],
+                                const uint8_t nonce[IMAGE_NONCE_LEN]) {
+    size_t pos = 0;
+    memcpy(out + pos, "IMG1", 4);
+    pos += 4;
+    memcpy(out + pos, selfId, DEVICE_UID_LEN);
+    pos += DEVICE_UID_LEN;
+    memcpy(out + pos, nonce, IMAGE_NONCE_LEN);
+    pos += IMAGE_NONCE_LEN;
+    return pos;
+}
+
+void ImageTransfer::begin(const uint8_t nonce[IMAGE_NONCE_LEN]) {
+    memcpy(_nonce, nonce, IMAGE_NONCE_LEN);
+    _hasNonce = true;
+    _authorized = false;
+}
+
+bool ImageTransfer::isValidChunk(size_t offset, size_t len) {
+    return len > 0 && len <= IMAGE_CHUNK_MAX && (len % 4) == 0 && (offset % 4) == 0 &&
+           offset < IMAGE_SIZE && len <= IMAGE_SIZE - offset;
+}
+
+bool ImageTransfer::canWrite(size_t offset, size_t len) const {
+    return isValidChunk(offset, len) && offset <= _next;
+}
+
+bool ImageTransfer::finishChunk(size_t offset, size_t len, uint32_t crc) {
+    if (crc32_stm32_sw(_stage + offset, len) != crc) {
+        dropChunk(offset);
+        return false;
+    }
+    if (offset + len > _next) {
+        _next = offset + len;
+    }
+    return true;
+}
+
+void ImageTransfer::dropChunk(size_t offset) {
+    if (_next > offset) {
+        _next = offset;
+    }
+}
+
+void ImageTransfer::reset() {
+    memset(_stage, 0, sizeof(_stage));
+    memset(_nonce, 0, sizeof(_nonce));
+    _next = 0;
+    _hasNonce = false;
+    _authorized = false;
+}
@@ -0,0 +1,15 @@
+#include "link_table.h"
+
+int link_table_find(const LinkRecordV1* links, uint16_t count,
+                    const uint8_t peerId[DEVICE_UID_LEN]) {
+    if (count > PersistPayloadV1::MAX_LINKS) {
+        count = PersistPayloadV1::MAX_LINKS;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (memcmp(links[i].peerId, peerId, DEVICE_UID_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,285 @@
+// =====================================================
+// Platform Clock Calibration - Arduino/STM32 Implementation
+// =====================================================
+// LSE: TIM21 counts the timer clock and captures every 8th
+// LSE edge on TI1 (TI1_RMP = LSE), as in ST AN4631.
+// USB SOF: the USB frame number (USB->FNR) advances once per
+// 1 ms frame; HCLK cycles between two frame edges, several
+// loop iterations apart, are counted with SysTick + the HAL
+// tick.
+//
+// Trimming adjusts RCC->ICSCR HSITRIM one step per window
+// while the error improves. It is skipped when SYSCLK does
+// not come from HSI16 (e.g. the Nucleo's ST-Link HSE clock).
+// =====================================================
+
+#include "platform_clock.h"
+#include "platform_power.h"
+#include "stm32l0xx_hal.h"
+
+static constexpr uint32_t LSE_HZ = 32768;
+static constexpr uint32_t LSE_EDGES_PER_CAPTURE = 8;   // IC1PSC = /8
+static constexpr uint32_t LSE_CAPTURES = 16;           // ~4 ms
+static constexpr uint16_t USB_SOF_FRAMES = 64;         // ~65 ms, counted between calls
+static constexpr int32_t SOF_MAX_ERROR_PPM = 50000;    // Beyond this the window lost frames
+static constexpr uint32_t REF_TIMEOUT_MS = 5;
+static constexpr uint32_t MAX_TRIM_STEPS = 8;
+
+void platform_clock_begin() {
+    __HAL_RCC_PWR_CLK_ENABLE();
+    PWR->CR |= PWR_CR_DBP;
+    if (!(RCC->CSR & RCC_CSR_LSEON)) {
+        RCC->CSR |= RCC_CSR_LSEON;
+    }
+}
+
+static bool sysclkFromHsi() {
+    uint32_t sws = RCC->CFGR & RCC_CFGR_SWS;
+    if (sws == RCC_CFGR_SWS_HSI) {
+        return true;
+    }
+    return sws == RCC_CFGR_SWS_PLL && (RCC->CFGR & RCC_CFGR_PLLSRC) == RCC_CFGR_PLLSRC_HSI;
+}
+
+static uint8_t getTrim() {
+    return (uint8_t)((RCC->ICSCR & RCC_ICSCR_HSITRIM) >> RCC_ICSCR_HSITRIM_Pos);
+}
+
+static void setTrim(uint8_t trim) {
+    __HAL_RCC_HSI_CALIBRATIONVALUE_ADJUST(trim);
+}
+
+static int32_t errorPpm(uint32_t measured, uint32_t expected) {
+    return (int32_t)(((int64_t)measured - (int64_t)expected) * 1000000 / (int64_t)expected);
+}
+
+// --- LSE via TIM21 input capture ---
+
+static bool measureLse(int32_t* ppm) {
+    if (!(RCC->CSR & RCC_CSR_LSERDY)) {
+        return false;
+    }
+
+    platform_power_acquire(PLATFORM_PERIPH_TIM21);
+    TIM21->CR1 = 0;
+    TIM21->PSC = 0;
+    TIM21->ARR = 0xFFFF;
+    TIM21->OR = (TIM21->OR & ~TIM21_OR_TI1_RMP) | TIM21_OR_TI1_RMP_2;   // TI1 = LSE
+    TIM21->CCMR1 = TIM_CCMR1_CC1S_0 | TIM_CCMR1_IC1PSC;                // IC1 on TI1, /8
+    TIM21->CCER = TIM_CCER_CC1E;
+    TIM21->EGR = TIM_EGR_UG;
+    TIM21->SR = 0;
+    TIM21->CR1 = TIM_CR1_CEN;
+
+    uint32_t total = 0;
+    uint16_t last = 0;
+    bool ok = true;
+    for (uint32_t i = 0; i <= LSE_CAPTURES && ok; i++) {
+        uint32_t start = HAL_GetTick();
+        while (!(TIM21->SR & TIM_SR_CC1IF)) {
+            if (HAL_GetTick() - start > REF_TIMEOUT_MS) {
+                ok = false;
+                break;
+            }
+        }
+        uint16_t capture = (uint16_t)TIM21->CCR1;   // Reading clears CC1IF
+        if (i > 0) {
+            total += (uint16_t)(capture - last);
+        }
+        last = capture;
+    }
+
+    TIM21->CR1 = 0;
+    TIM21->CCER = 0;
+    platform_power_release(PLATFORM_PERIPH_TIM21);
+    if (!ok) {
+        return false;
+    }
+
+    // Timer clock is PCLK2, doubled when APB2 is divided
+    uint32_t timClk = HAL_RCC_GetPCLK2Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_CFGR_PPRE2_DIV1) {
+        timClk *= 2;
+    }
+    uint32_t expected = (uint32_t)((uint64_t)timClk * LSE_EDGES_PER_CAPTURE * LSE_CAPTURES / LSE_HZ);
+    *ppm = errorPpm(total, expected);
+    return true;
+}
+
+// --- USB SOF via frame number ---
+//
+// The frame number counts SOFs in hardware, so a window only
+// needs an exact HCLK timestamp at a frame edge on each end;
+// the frames in between go by while the loop does other work.
+
+struct SofWindow {
+    bool open;
+    uint16_t startFrame;
+    uint32_t startCycles;
+};
+
+static SofWindow g_sof = {};
+
+static uint32_t hclkCycles() {
+    uint32_t reload = SysTick->LOAD + 1;
+    uint32_t t1, t2, val;
+    do {
+        t1 = HAL_GetTick();
+        val = SysTick->VAL;
+        t2 = HAL_GetTick();
+    } while (t1 != t2);
+    return t1 * reload + (reload - 1 - val);
+}
+
+static bool usbSofLocked() {
+    return (RCC->APB1ENR & RCC_APB1ENR_USBEN) && (USB->FNR & USB_FNR_LCK);
+}
+
+static bool waitFrameChange(uint16_t* frame) {
+    uint16_t start = USB->FNR & USB_FNR_FN;
+    uint32_t startMs = HAL_GetTick();
+    while ((USB->FNR & USB_FNR_FN) == start) {
+        if (HAL_GetTick() - startMs > REF_TIMEOUT_MS) {
+            return false;
+        }
+    }
+    *frame = USB->FNR & USB_FNR_FN;
+    return true;
+}
+
+static uint16_t framesSince(uint16_t start, uint16_t frame) {
+    return (uint16_t)(frame - start) & USB_FNR_FN;
+}
+
+enum MeasureResult : uint8_t { MEASURE_FAILED, MEASURE_PENDING, MEASURE_DONE };
+
+static MeasureResult measureUsbSof(int32_t* ppm) {
+    if (!usbSofLocked()) {
+        g_sof.open = false;
+        return MEASURE_FAILED;
+    }
+
+    uint16_t frame;
+    if (!g_sof.open) {
+        if (!waitFrameChange(&frame)) {
+            return MEASURE_FAILED;
+        }
+        g_sof.startCycles = hclkCycles();
+        g_sof.startFrame = frame;
+        g_sof.open = true;
+        return MEASURE_PENDING;
+    }
+
+    if (framesSince(g_sof.startFrame, USB->FNR & USB_FNR_FN) < USB_SOF_FRAMES) {
+        return MEASURE_PENDING;
+    }
+    g_sof.open = false;
+    if (!waitFrameChange(&frame)) {
+        return MEASURE_FAILED;
+    }
+    uint32_t cycles = hclkCycles() - g_sof.startCycles;
+    uint16_t frames = framesSince(g_sof.startFrame, frame);
+
+    // The frame number wraps every 2048 frames, and a suspended host
+    // sends none. A window stretched past a wrap by a long tap, or with
+    // frames missing, disagrees wildly with the cycle count.
+    uint32_t expected = (uint32_t)((uint64_t)SystemCoreClock * frames / 1000);
+    if (expected == 0) {
+        return MEASURE_FAILED;
+    }
+    *ppm = errorPpm(cycles, expected);
+    return (*ppm < SOF_MAX_ERROR_PPM && *ppm > -SOF_MAX_ERROR_PPM) ? MEASURE_DONE : MEASURE_FAILED;
+}
+
+static MeasureResult measure(platform_clock_ref_t ref, int32_t* ppm) {
+    if (ref == PLATFORM_CLOCK_REF_LSE) {
+        return measureLse(ppm) ? MEASURE_DONE : MEASURE_FAILED;
+    }
+    return measureUsbSof(ppm);
+}
+
+static int32_t absPpm(int32_t v) {
+    return v < 0 ? -v : v;
+}
+
+// --- Calibration run ---
+
+enum RunPhase : uint8_t { RUN_IDLE, RUN_MEASURE, RUN_TRY };
+
+static struct {
+    RunPhase phase;
+    platform_clock_cal_t r;
+    uint8_t steps;
+    uint8_t tryTrim;
+} g_run = {};
+
+static platform_clock_cal_status_t endRun(platform_clock_cal_t* result,
+                                          platform_clock_cal_status_t status) {
+    g_run.phase = RUN_IDLE;
+    g_sof.open = false;
+    if (result) *result = g_run.r;
+    return status;
+}
+
+// A higher trim speeds HSI up: step against the error
+static platform_clock_cal_status_t tryNextTrim(platform_clock_cal_t* result) {
+    int next = (int)g_run.r.trim + (g_run.r.residualPpm > 0 ? -1 : 1);
+    if (g_run.steps >= MAX_TRIM_STEPS ||
+        next < 0 || next > (int)(RCC_ICSCR_HSITRIM >> RCC_ICSCR_HSITRIM_Pos)) {
+        return endRun(result, PLATFORM_CLOCK_CAL_DONE);
+    }
+    g_run.steps++;
+    g_run.tryTrim = (uint8_t)next;
+    setTrim(g_run.tryTrim);
+    g_run.phase = RUN_TRY;
+    return PLATFORM_CLOCK_CAL_BUSY;
+}
+
+platform_clock_cal_status_t platform_clock_calibrate(platform_clock_cal_t* result) {
+    if (g_run.phase == RUN_IDLE) {
+        g_run.r = {};
+        g_run.r.trim = getTrim();
+        g_run.steps = 0;
+        if (RCC->CSR & RCC_CSR_LSERDY) {
+            g_run.r.ref = PLATFORM_CLOCK_REF_LSE;
+        } else if (usbSofLocked()) {
+            g_run.r.ref = PLATFORM_CLOCK_REF_USB_SOF;
+        } else {
+            return endRun(result, PLATFORM_CLOCK_CAL_NO_REF);
+        }
+        g_run.phase = RUN_MEASURE;
+    }
+
+    int32_t ppm;
+    MeasureResult m = measure(g_run.r.ref, &ppm);
+    if (m == MEASURE_PENDING) {
+        return PLATFORM_CLOCK_CAL_BUSY;
+    }
+
+    if (g_run.phase == RUN_MEASURE) {
+        if (m == MEASURE_FAILED) {
+            if (g_run.r.ref == PLATFORM_CLOCK_REF_LSE && usbSofLocked()) {
+                g_run.r.ref = PLATFORM_CLOCK_REF_USB_SOF;
+                return PLATFORM_CLOCK_CAL_BUSY;
+            }
+            g_run.r.ref = PLATFORM_CLOCK_REF_NONE;
+            return endRun(result, PLATFORM_CLOCK_CAL_NO_REF);
+        }
+        g_run.r.errorPpm = ppm;
+        g_run.r.residualPpm = ppm;
+        if (!sysclkFromHsi()) {
+            return endRun(result, PLATFORM_CLOCK_CAL_DONE);
+        }
+        g_run.r.trimmed = true;
+        return tryNextTrim(result);
+    }
+
+    // RUN_TRY: keep the step only if it measured better
+    if (m == MEASURE_FAILED || absPpm(ppm) >= absPpm(g_run.r.residualPpm)) {
+        setTrim(g_run.r.trim);
+        return endRun(result, PLATFORM_CLOCK_CAL_DONE);
+    }
+    g_run.r.trim = g_run.tryTrim;
+    g_run.r.residualPpm = ppm;
+    return tryNextTrim(result);
+}
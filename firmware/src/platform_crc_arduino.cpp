@@ -0,0 +1,41 @@
+// =====================================================
+// Platform CRC - Arduino/STM32 Implementation
+// =====================================================
+// Register level: the HAL CRC driver re-initialises the
+// unit on every use. The configuration registers keep their
+// values while the clock is gated, so they are written once.
+// =====================================================
+
+#include "platform_crc.h"
+#include "platform_power.h"
+#include "stm32l0xx_hal.h"
+#include <string.h>
+
+static bool g_configured = false;
+
+uint32_t platform_crc32(const uint8_t* data, size_t len) {
+    if (len % 4 != 0) {
+        return 0;
+    }
+
+    platform_power_acquire(PLATFORM_PERIPH_CRC);
+    if (!g_configured) {
+        // HAL_CRC_Init() defaults, spelled out
+        CRC->INIT = DEFAULT_CRC_INITVALUE;
+        CRC->POL = DEFAULT_CRC32_POLY;
+        CRC->CR = CRC_POLYLENGTH_32B | CRC_INPUTDATA_INVERSION_NONE | CRC_OUTPUTDATA_INVERSION_DISABLE;
+        g_configured = true;
+    }
+    CRC->CR |= CRC_CR_RESET;
+
+    // One 32-bit DR write per word (CRC_INPUTDATA_FORMAT_WORDS)
+    for (size_t i = 0; i < len; i += 4) {
+        uint32_t word;
+        memcpy(&word, data + i, 4);
+        CRC->DR = word;
+    }
+    uint32_t crc = CRC->DR;
+
+    platform_power_release(PLATFORM_PERIPH_CRC);
+    return crc;
+}
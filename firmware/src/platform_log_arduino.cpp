@@ -0,0 +1,79 @@
+// =====================================================
+// Platform Debug Log - Arduino/STM32 Implementation
+// =====================================================
+// Drives USART1 TX through DMA1 channel 2 at register level.
+// The STM32duino core does not use USART1 or DMA1 channel 2,
+// and no interrupt handlers are needed: completion is polled
+// in platform_log_busy().
+//
+// TX pin defaults to PB6 (AF0) because PA9, the other USART1
+// TX pin, is the tap link on the Nucleo. Override with
+// -DDEBUG_LOG_TX_PORT=GPIOA -DDEBUG_LOG_TX_PIN=GPIO_PIN_9
+// -DDEBUG_LOG_TX_AF=GPIO_AF4_USART1 on the card (PA9 free).
+// =====================================================
+
+#include "platform_log.h"
+#include "platform_power.h"
+#include "stm32l0xx_hal.h"
+
+#ifndef DEBUG_LOG_TX_PORT
+#define DEBUG_LOG_TX_PORT GPIOB
+#define DEBUG_LOG_TX_PIN  GPIO_PIN_6
+#define DEBUG_LOG_TX_AF   GPIO_AF0_USART1
+#endif
+
+// DMA1 channel 2 request mapping for USART1_TX (RM0367 table 51)
+static constexpr uint32_t DMA_REQ_USART1_TX = 3;
+
+void platform_log_begin(uint32_t baud) {
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    // Held for good: records are queued from anywhere, any time
+    platform_power_acquire(PLATFORM_PERIPH_USART1);
+    platform_power_acquire(PLATFORM_PERIPH_DMA1);
+
+    GPIO_InitTypeDef gpio = {};
+    gpio.Pin = DEBUG_LOG_TX_PIN;
+    gpio.Mode = GPIO_MODE_AF_PP;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_HIGH;
+    gpio.Alternate = DEBUG_LOG_TX_AF;
+    HAL_GPIO_Init(DEBUG_LOG_TX_PORT, &gpio);
+
+    // 8N1, TX only, DMA transmit
+    USART1->CR1 = 0;
+    USART1->BRR = (HAL_RCC_GetPCLK2Freq() + baud / 2) / baud;
+    USART1->CR3 = USART_CR3_DMAT;
+    USART1->CR1 = USART_CR1_TE | USART_CR1_UE;
+
+    // Memory -> peripheral, byte transfers, memory increment
+    DMA1_Channel2->CCR = 0;
+    DMA1_CSELR->CSELR = (DMA1_CSELR->CSELR & ~DMA_CSELR_C2S) |
+                        (DMA_REQ_USART1_TX << DMA_CSELR_C2S_Pos);
+    DMA1_Channel2->CPAR = (uint32_t)&USART1->TDR;
+    DMA1_Channel2->CCR = DMA_CCR_MINC | DMA_CCR_DIR;
+}
+
+bool platform_log_busy() {
+    if (!(DMA1_Channel2->CCR & DMA_CCR_EN)) {
+        return false;
+    }
+    if (DMA1->ISR & DMA_ISR_TCIF2) {
+        // Last byte handed to the UART; buffer is free again
+        DMA1->IFCR = DMA_IFCR_CGIF2;
+        DMA1_Channel2->CCR &= ~DMA_CCR_EN;
+        return false;
+    }
+    return true;
+}
+
+bool platform_log_start(const uint8_t* data, size_t len) {
+    if (len == 0 || platform_log_busy()) {
+        return false;
+    }
+    DMA1->IFCR = DMA_IFCR_CGIF2;
+    DMA1_Channel2->CMAR = (uint32_t)data;
+    DMA1_Channel2->CNDTR = len;
+    DMA1_Channel2->CCR |= DMA_CCR_EN;
+    return true;
+}
@@ -0,0 +1,313 @@
+// =====================================================
+// Platform Low-Power Wait - Arduino/STM32 Implementation
+// =====================================================
+// LPTIM1 runs from LSE (LSI until the crystal is up) and is
+// the only clock left in STOP. Both wake sources are EXTI
+// events (EMR), taken with WFE, so no interrupt handler runs:
+//   line 29     LPTIM1 (ARRM: wait over, CMPM: pulse ended)
+//   line n      falling edge on the tap pin (Pxn)
+//   line m      rising edge on USB_VBUS_SENSE_PIN (Pxm), so a
+//               cable plugged in during STOP wakes the core
+//               before the host resets the bus
+//
+// STOP is refused while a host could be on the bus (see
+// lowpower_policy.h): the USB peripheral has no clock in STOP.
+//
+// Beacon: PWM mode, output low from CNT = 0 to CMP and high
+// until ARR, open-drain on TAP_BEACON_LPTIM_PIN. Our own
+// falling edge also sets the line EXTI; it is recognised by
+// CNT <= CMP (still inside our pulse) and STOP resumes. A
+// peer still holding the line when our pulse ends has no
+// edge of its own, so the line is also sampled on CMPM.
+//
+// On the way out SYSCLK is rebuilt by the core's
+// SystemClock_Config() (STOP wakes on HSI16), and the HAL
+// tick is moved on by the LPTIM count, keeping fractions.
+// SystemClock_Config() writes the default HSI trim, so the
+// trim from platform_clock_calibrate() is put back after it.
+// =====================================================
+
+#include "platform_lowpower.h"
+#include "platform_power.h"
+#include "platform_storage.h"
+#include "platform_usb.h"
+#include "lowpower_policy.h"
+#include "board_config.h"
+#include "stm32l0xx_hal.h"
+#include <Arduino.h>
+#ifdef ENABLE_DEBUG_LOG
+#include "platform_log.h"
+#endif
+
+extern "C" void SystemClock_Config(void);
+
+static constexpr uint32_t LSE_HZ = 32768;
+static constexpr uint32_t LSI_HZ = 37000;      // Nominal; only used until LSE is ready
+static constexpr uint32_t LSI_TIMEOUT_MS = 2;
+static constexpr uint32_t LPTIM_MAX = 0xFFFF;
+static constexpr uint32_t LPTIM_EXTI = EXTI_EMR_EM29;
+
+static GPIO_TypeDef* g_linePort = nullptr;
+static uint32_t g_lineMask = 0;               // Pin bit = EXTI line bit
+static uint32_t g_vbusMask = 0;               // VBUS sense EXTI line, 0 if none
+static uint32_t g_tickRemainder = 0;          // Sub-ms LPTIM time not yet in uwTick
+
+// --- Clock ---
+
+static uint32_t selectClock() {
+    uint32_t sel;
+    uint32_t hz;
+    if (RCC->CSR & RCC_CSR_LSERDY) {
+        sel = RCC_CCIPR_LPTIM1SEL;            // 11 = LSE
+        hz = LSE_HZ;
+    } else {
+        if (!(RCC->CSR & RCC_CSR_LSIRDY)) {
+            RCC->CSR |= RCC_CSR_LSION;
+            uint32_t start = HAL_GetTick();
+            while (!(RCC->CSR & RCC_CSR_LSIRDY)) {
+                if (HAL_GetTick() - start > LSI_TIMEOUT_MS) {
+                    return 0;
+                }
+            }
+        }
+        sel = RCC_CCIPR_LPTIM1SEL_0;          // 01 = LSI
+        hz = LSI_HZ;
+    }
+    RCC->CCIPR = (RCC->CCIPR & ~RCC_CCIPR_LPTIM1SEL) | sel;   // Timer is disabled here
+    return hz;
+}
+
+static uint32_t ticksFor(uint32_t us, uint32_t hz) {
+    uint32_t ticks = (uint32_t)((uint64_t)us * hz / 1000000);
+    return ticks > LPTIM_MAX ? LPTIM_MAX : ticks;
+}
+
+// CNT runs on the asynchronous kernel clock: read until stable
+static uint32_t readCount() {
+    uint32_t a;
+    uint32_t b = LPTIM1->CNT;
+    do {
+        a = b;
+        b = LPTIM1->CNT;
+    } while (a != b);
+    return a;
+}
+
+static void advanceTick(uint32_t ticks, uint32_t hz) {
+    uint64_t total = (uint64_t)ticks * 1000 + g_tickRemainder;
+    uwTick += (uint32_t)(total / hz);
+    g_tickRemainder = (uint32_t)(total % hz);
+}
+
+// --- Beacon pin ---
+
+#ifdef TAP_BEACON_LPTIM_PIN
+struct PinMode {
+    uint32_t moder;
+    uint32_t otyper;
+    uint32_t afr;
+};
+
+static PinMode beaconPinToLptim() {
+    GPIO_TypeDef* port = digitalPinToPort(TAP_BEACON_LPTIM_PIN);
+    uint32_t bit = __builtin_ctz(digitalPinToBitMask(TAP_BEACON_LPTIM_PIN));
+    volatile uint32_t* afr = &port->AFR[bit >> 3];
+    uint32_t afShift = 4 * (bit & 7);
+    PinMode saved = { port->MODER, port->OTYPER, *afr };
+
+    *afr = (*afr & ~(0xFu << afShift)) | ((uint32_t)TAP_BEACON_LPTIM_AF << afShift);
+    port->OTYPER |= 1u << bit;                                          // Open-drain
+    port->MODER = (port->MODER & ~(3u << (2 * bit))) | (2u << (2 * bit));   // Alternate
+    return saved;
+}
+
+static void beaconPinRestore(const PinMode& saved) {
+    GPIO_TypeDef* port = digitalPinToPort(TAP_BEACON_LPTIM_PIN);
+    uint32_t bit = __builtin_ctz(digitalPinToBitMask(TAP_BEACON_LPTIM_PIN));
+    port->MODER = saved.moder;
+    port->OTYPER = saved.otyper;
+    port->AFR[bit >> 3] = saved.afr;
+}
+#endif
+
+// --- API ---
+
+// EXTI line n follows whichever port SYSCFG selects for it
+static void routeExti(GPIO_TypeDef* port, uint32_t mask) {
+    uint32_t bit = __builtin_ctz(mask);
+    uint32_t shift = 4 * (bit & 3);
+    SYSCFG->EXTICR[bit >> 2] = (SYSCFG->EXTICR[bit >> 2] & ~(0xFu << shift)) |
+                               (GPIO_GET_INDEX(port) << shift);
+}
+
+bool platform_lowpower_begin(uint32_t linePin) {
+    GPIO_TypeDef* port = digitalPinToPort(linePin);
+    uint32_t mask = digitalPinToBitMask(linePin);
+    if (port == nullptr || mask == 0) {
+        return false;
+    }
+
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    routeExti(port, mask);
+    EXTI->FTSR |= mask;
+    EXTI->RTSR &= ~mask;
+    EXTI->PR = mask;
+
+#ifdef USB_VBUS_SENSE_PIN
+    // Same EXTI line as the tap pin (same pin number): no VBUS wake-up
+    GPIO_TypeDef* vbusPort = digitalPinToPort(USB_VBUS_SENSE_PIN);
+    uint32_t vbusMask = digitalPinToBitMask(USB_VBUS_SENSE_PIN);
+    if (vbusPort != nullptr && vbusMask != 0 && vbusMask != mask) {
+        routeExti(vbusPort, vbusMask);
+        EXTI->RTSR |= vbusMask;
+        EXTI->FTSR &= ~vbusMask;
+        EXTI->PR = vbusMask;
+        g_vbusMask = vbusMask;
+    }
+#endif
+
+    // VREFINT off in STOP, and wake on HSI16 without waiting for it
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWREx_EnableUltraLowPower();
+    HAL_PWREx_EnableFastWakeUp();
+    RCC->CFGR |= RCC_CFGR_STOPWUCK;
+
+    g_linePort = port;
+    g_lineMask = mask;
+    return true;
+}
+
+bool platform_lowpower_has_beacon() {
+#ifdef TAP_BEACON_LPTIM_PIN
+    return true;
+#else
+    return false;
+#endif
+}
+
+platform_wake_t platform_lowpower_stop(uint32_t maxUs, uint32_t beaconIntervalUs,
+                                       uint32_t beaconPulseUs, uint32_t* pulsesOut) {
+    if (pulsesOut) {
+        *pulsesOut = 0;
+    }
+    // EEPROM programming finishes from its interrupt, log DMA
+    // from its own: neither runs with the clocks stopped
+    if (g_lineMask == 0 || platform_storage_busy()) {
+        return PLATFORM_WAKE_SKIPPED;
+    }
+    if (!lowpower_stop_allowed(platform_usb_clocked(), platform_usb_state(), platform_usb_supply())) {
+        return PLATFORM_WAKE_SKIPPED;
+    }
+#ifdef ENABLE_DEBUG_LOG
+    if (platform_log_busy()) {
+        return PLATFORM_WAKE_SKIPPED;
+    }
+#endif
+    bool beacon = beaconIntervalUs != 0;
+    if (beacon && !platform_lowpower_has_beacon()) {
+        return PLATFORM_WAKE_SKIPPED;
+    }
+
+    platform_power_acquire(PLATFORM_PERIPH_LPTIM1);
+    uint32_t hz = selectClock();
+    uint32_t arr = ticksFor(beacon ? beaconIntervalUs : maxUs, hz);
+    uint32_t cmp = beacon ? ticksFor(beaconPulseUs, hz) : 0;
+    if (hz == 0 || arr < 2 || (beacon && (cmp == 0 || cmp >= arr))) {
+        platform_power_release(PLATFORM_PERIPH_LPTIM1);
+        return PLATFORM_WAKE_SKIPPED;
+    }
+
+    // CFGR and IER are only writable while disabled, ARR and CMP only while enabled
+    LPTIM1->CR = 0;
+    LPTIM1->CFGR = 0;                                  // Internal clock, /1, PWM, active low
+    LPTIM1->IER = beacon ? LPTIM_IER_CMPMIE : LPTIM_IER_ARRMIE;
+    LPTIM1->CR = LPTIM_CR_ENABLE;
+    LPTIM1->ICR = LPTIM_ICR_ARROKCF | LPTIM_ICR_CMPOKCF;
+    LPTIM1->ARR = arr;
+    while (!(LPTIM1->ISR & LPTIM_ISR_ARROK)) {
+    }
+    LPTIM1->CMP = cmp;
+    while (!(LPTIM1->ISR & LPTIM_ISR_CMPOK)) {
+    }
+    LPTIM1->ICR = LPTIM_ICR_ARRMCF | LPTIM_ICR_CMPMCF | LPTIM_ICR_ARROKCF | LPTIM_ICR_CMPOKCF;
+    LPTIM1->CR = LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT;
+
+#ifdef TAP_BEACON_LPTIM_PIN
+    PinMode saved = {};
+    if (beacon) {
+        saved = beaconPinToLptim();                    // First pulse starts now
+    }
+#endif
+    EXTI->PR = g_lineMask | g_vbusMask;                // Including our own first edge
+    EXTI->EMR |= g_lineMask | g_vbusMask | LPTIM_EXTI;
+
+    uint32_t hsiTrim = RCC->ICSCR & RCC_ICSCR_HSITRIM;
+    HAL_SuspendTick();
+    uint32_t wraps = 0;
+    uint32_t pulses = 0;
+    uint32_t pulsesForMax = beacon ? (maxUs + beaconIntervalUs - 1) / beaconIntervalUs : 0;
+    platform_wake_t why;
+    for (;;) {
+        HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFE);
+
+        uint32_t isr = LPTIM1->ISR;
+        LPTIM1->ICR = isr & (LPTIM_ISR_ARRM | LPTIM_ISR_CMPM);
+        bool edge = (EXTI->PR & g_lineMask) != 0;
+        bool attach = (EXTI->PR & g_vbusMask) != 0;
+        EXTI->PR = g_lineMask | g_vbusMask;
+        if (isr & LPTIM_ISR_ARRM) {
+            wraps++;
+        }
+        if (attach) {
+            why = PLATFORM_WAKE_OTHER;                 // USB cable: the host needs us awake
+            break;
+        }
+
+        if (!beacon) {
+            why = edge ? PLATFORM_WAKE_LINE
+                       : (isr & LPTIM_ISR_ARRM) ? PLATFORM_WAKE_TIMER : PLATFORM_WAKE_OTHER;
+            break;
+        }
+
+        uint32_t cnt = readCount();
+        bool ownPulse = cnt <= cmp && !(isr & LPTIM_ISR_CMPM);
+        bool lineLow = !(g_linePort->IDR & g_lineMask);
+        if (isr & LPTIM_ISR_CMPM) {
+            pulses++;
+            if (lineLow) {                             // Peer overlapped our pulse
+                why = PLATFORM_WAKE_LINE;
+                break;
+            }
+            if (pulses >= pulsesForMax) {
+                why = PLATFORM_WAKE_TIMER;             // Line released: a clean place to stop
+                break;
+            }
+        } else if (edge && !ownPulse) {
+            why = PLATFORM_WAKE_LINE;
+            break;
+        } else if (!edge && !(isr & LPTIM_ISR_ARRM)) {
+            why = PLATFORM_WAKE_OTHER;
+            break;
+        }
+    }
+
+    uint32_t elapsed = wraps * (arr + 1) + readCount();
+    EXTI->EMR &= ~(g_lineMask | g_vbusMask | LPTIM_EXTI);
+#ifdef TAP_BEACON_LPTIM_PIN
+    if (beacon) {
+        beaconPinRestore(saved);
+    }
+#endif
+    LPTIM1->CR = 0;
+    platform_power_release(PLATFORM_PERIPH_LPTIM1);
+
+    SystemClock_Config();
+    __HAL_RCC_HSI_CALIBRATIONVALUE_ADJUST(hsiTrim >> RCC_ICSCR_HSITRIM_Pos);
+    advanceTick(elapsed, hz);
+    HAL_ResumeTick();
+
+    if (pulsesOut) {
+        *pulsesOut = pulses;
+    }
+    return why;
+}
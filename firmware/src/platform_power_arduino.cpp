@@ -0,0 +1,171 @@
+// =====================================================
+// Platform Power - Arduino/STM32 Implementation
+// =====================================================
+// One RCC enable bit per managed peripheral. The STM32duino
+// core keeps its own timers (tone on TIM6) and the console
+// UART, so those are not listed here.
+//
+// RNG also needs HSI48: it is turned on with the first RNG
+// user and off with the last, unless USB (which runs from
+// HSI48 too) had it on already.
+// =====================================================
+
+#include "platform_power.h"
+#include "stm32l0xx_hal.h"
+#include <Arduino.h>
+
+struct PeriphClock {
+    const char* name;
+    volatile uint32_t* enr;
+    uint32_t bit;
+};
+
+static const PeriphClock CLOCKS[PLATFORM_PERIPH_COUNT] = {
+    { "crc",    &RCC->AHBENR,  RCC_AHBENR_CRCEN },
+    { "rng",    &RCC->AHBENR,  RCC_AHBENR_RNGEN },
+    { "tim21",  &RCC->APB2ENR, RCC_APB2ENR_TIM21EN },
+    { "tim22",  &RCC->APB2ENR, RCC_APB2ENR_TIM22EN },
+    { "usart1", &RCC->APB2ENR, RCC_APB2ENR_USART1EN },
+    { "dma1",   &RCC->AHBENR,  RCC_AHBENR_DMA1EN },
+    { "i2c1",   &RCC->APB1ENR, RCC_APB1ENR_I2C1EN },
+    { "lptim1", &RCC->APB1ENR, RCC_APB1ENR_LPTIM1EN },
+    { "usb",    &RCC->APB1ENR, RCC_APB1ENR_USBEN },
+};
+
+static constexpr uint32_t HSI48_TIMEOUT_MS = 10;
+
+static uint8_t g_users[PLATFORM_PERIPH_COUNT];
+static bool g_hsi48Ours = false;
+static uint8_t g_state = 0;
+static uint32_t g_stateMask[PLATFORM_POWER_STATE_MAX];
+
+static void hsi48On() {
+    if (RCC->CRRCR & RCC_CRRCR_HSI48ON) {
+        return;
+    }
+    RCC->CRRCR |= RCC_CRRCR_HSI48ON;
+    g_hsi48Ours = true;
+    uint32_t start = HAL_GetTick();
+    while (!(RCC->CRRCR & RCC_CRRCR_HSI48RDY) && HAL_GetTick() - start <= HSI48_TIMEOUT_MS) {
+    }
+    RCC->CCIPR |= RCC_CCIPR_HSI48SEL;
+}
+
+static void hsi48Off() {
+    if (g_hsi48Ours) {
+        RCC->CRRCR &= ~RCC_CRRCR_HSI48ON;
+        g_hsi48Ours = false;
+    }
+}
+
+void platform_power_begin() {
+    for (uint8_t i = 0; i < PLATFORM_PERIPH_COUNT; i++) {
+        if (i != PLATFORM_PERIPH_USB && g_users[i] == 0) {
+            *CLOCKS[i].enr &= ~CLOCKS[i].bit;
+        }
+    }
+}
+
+void platform_power_acquire(platform_periph_t periph) {
+    if (periph >= PLATFORM_PERIPH_COUNT || periph == PLATFORM_PERIPH_USB) {
+        return;
+    }
+    if (g_users[periph]++ == 0) {
+        if (periph == PLATFORM_PERIPH_RNG) {
+            hsi48On();
+        }
+        *CLOCKS[periph].enr |= CLOCKS[periph].bit;
+        (void)*CLOCKS[periph].enr;   // Let the enable land before first register access
+    }
+    g_stateMask[g_state] |= platform_power_active_mask();
+}
+
+void platform_power_release(platform_periph_t periph) {
+    if (periph >= PLATFORM_PERIPH_COUNT || periph == PLATFORM_PERIPH_USB || g_users[periph] == 0) {
+        return;
+    }
+    if (--g_users[periph] == 0) {
+        *CLOCKS[periph].enr &= ~CLOCKS[periph].bit;
+        if (periph == PLATFORM_PERIPH_RNG) {
+            hsi48Off();
+        }
+    }
+}
+
+uint32_t platform_power_active_mask() {
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < PLATFORM_PERIPH_COUNT; i++) {
+        if (*CLOCKS[i].enr & CLOCKS[i].bit) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+const char* platform_power_periph_name(uint8_t periph) {
+    return periph < PLATFORM_PERIPH_COUNT ? CLOCKS[periph].name : "?";
+}
+
+void platform_power_set_state(uint8_t state) {
+    if (state >= PLATFORM_POWER_STATE_MAX) {
+        return;
+    }
+    g_state = state;
+    g_stateMask[state] |= platform_power_active_mask();
+}
+
+uint32_t platform_power_state_mask(uint8_t state) {
+    return state < PLATFORM_POWER_STATE_MAX ? g_stateMask[state] : 0;
+}
+
+void platform_power_reset_states() {
+    for (uint8_t i = 0; i < PLATFORM_POWER_STATE_MAX; i++) {
+        g_stateMask[i] = 0;
+    }
+    g_stateMask[g_state] = platform_power_active_mask();
+}
+
+void platform_power_idle_ms(uint32_t ms) {
+    uint32_t start = HAL_GetTick();
+    while (HAL_GetTick() - start < ms) {
+        __WFI();   // SysTick wakes us every millisecond at the latest
+    }
+}
+
+// --- Idle pins ---
+
+static bool isKept(GPIO_TypeDef* port, uint32_t bit, const uint32_t* keepPins, size_t keepCount) {
+    for (size_t i = 0; i < keepCount; i++) {
+        if (digitalPinToPort(keepPins[i]) == port && digitalPinToBitMask(keepPins[i]) == (1u << bit)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t platform_power_idle_pins(const uint32_t* keepPins, size_t keepCount) {
+    // Port H carries the oscillator pins; leave it alone
+    static GPIO_TypeDef* const PORTS[] = { GPIOA, GPIOB, GPIOC, GPIOD };
+    static const uint32_t PORT_CLOCKS[] = {
+        RCC_IOPENR_GPIOAEN, RCC_IOPENR_GPIOBEN, RCC_IOPENR_GPIOCEN, RCC_IOPENR_GPIODEN
+    };
+
+    uint32_t switched = 0;
+    for (size_t p = 0; p < sizeof(PORTS) / sizeof(PORTS[0]); p++) {
+        // An unclocked port was never configured: its pins are still analog
+        if (!(RCC->IOPENR & PORT_CLOCKS[p])) {
+            continue;
+        }
+        GPIO_TypeDef* port = PORTS[p];
+        for (uint32_t bit = 0; bit < 16; bit++) {
+            uint32_t shift = 2 * bit;
+            bool floatingInput = ((port->MODER >> shift) & 3u) == 0 &&
+                                 ((port->PUPDR >> shift) & 3u) == 0;
+            if (floatingInput && !isKept(port, bit, keepPins, keepCount)) {
+                port->MODER |= 3u << shift;
+                switched++;
+            }
+        }
+    }
+    return switched;
+}
@@ -0,0 +1,37 @@
+// =====================================================
+// Platform RAM Function Placement - Arduino/STM32 Implementation
+// =====================================================
+// Copies the vector table into RAM (VTOR needs 256-byte
+// alignment for the 48 Cortex-M0+ vectors) and replaces the
+// SysTick entry. STM32duino's SysTick_Handler only calls
+// HAL_IncTick() and HAL_SYSTICK_IRQHandler(), both in flash;
+// the RAM handler does the same tick update without leaving
+// RAM. No callback is registered for HAL_SYSTICK_Callback.
+//
+// Other IRQs (USB) still vector into flash and stall for the
+// rest of an EEPROM program; USB retries NAKed transfers.
+// =====================================================
+
+#include "platform_ramfunc.h"
+#include "stm32l0xx_hal.h"
+#include <string.h>
+
+static constexpr uint32_t VECTOR_COUNT = 16 + 32;
+static constexpr uint32_t SYSTICK_VECTOR = 15;
+
+alignas(256) static uint32_t g_ramVectors[VECTOR_COUNT];
+
+static PLATFORM_RAMFUNC void ramSysTickHandler() {
+    uwTick += (uint32_t)uwTickFreq;
+}
+
+void platform_ramfunc_begin() {
+    const uint32_t* flashVectors = (const uint32_t*)SCB->VTOR;
+    memcpy(g_ramVectors, flashVectors, sizeof(g_ramVectors));
+    g_ramVectors[SYSTICK_VECTOR] = (uint32_t)(uintptr_t)&ramSysTickHandler;
+
+    __disable_irq();
+    SCB->VTOR = (uint32_t)(uintptr_t)g_ramVectors;
+    __DSB();
+    __enable_irq();
+}
@@ -0,0 +1,40 @@
+// =====================================================
+// Platform Random Number - Arduino/STM32 Implementation
+// =====================================================
+// The power manager clocks the RNG and its HSI48 kernel
+// clock for the duration of the read (platform_power.h).
+// =====================================================
+
+#include "platform_rng.h"
+#include "platform_power.h"
+#include "stm32l0xx_hal.h"
+
+static constexpr uint32_t RNG_TIMEOUT_MS = 10;
+
+bool platform_rng_read(uint32_t* out, size_t n) {
+    platform_power_acquire(PLATFORM_PERIPH_RNG);
+    if (!(RCC->CRRCR & RCC_CRRCR_HSI48RDY)) {
+        platform_power_release(PLATFORM_PERIPH_RNG);
+        return false;
+    }
+    RNG->CR |= RNG_CR_RNGEN;
+
+    bool ok = true;
+    for (size_t i = 0; i < n && ok; i++) {
+        uint32_t start = HAL_GetTick();
+        while (!(RNG->SR & RNG_SR_DRDY)) {
+            if ((RNG->SR & (RNG_SR_SECS | RNG_SR_CECS)) ||
+                HAL_GetTick() - start > RNG_TIMEOUT_MS) {
+                ok = false;
+                break;
+            }
+        }
+        if (ok) {
+            out[i] = RNG->DR;
+        }
+    }
+
+    RNG->CR &= ~RNG_CR_RNGEN;
+    platform_power_release(PLATFORM_PERIPH_RNG);
+    return ok;
+}
@@ -0,0 +1,75 @@
+// =====================================================
+// Platform Self-Test Probes - Arduino/STM32 Implementation
+// =====================================================
+// NVM stall: TIM22 free-runs at 1 MHz while a data EEPROM
+// word programs. The same polling loop is built twice, once
+// in flash and once in .RamFunc, so the report shows what
+// moving code to RAM buys (platform_ramfunc.h).
+// =====================================================
+
+#include "platform_selftest.h"
+#include "platform_ramfunc.h"
+#include "platform_power.h"
+#include "platform_storage.h"
+#include "stm32l0xx_hal.h"
+
+// --- NVM stall ---
+
+static inline __attribute__((always_inline)) uint32_t stallLoop(volatile uint32_t* dst, uint32_t value) {
+    uint16_t last = TIM22->CNT;
+    uint16_t maxGap = 0;
+    *dst = value;
+    while (FLASH->SR & FLASH_SR_BSY) {
+        uint16_t now = TIM22->CNT;
+        uint16_t gap = now - last;
+        if (gap > maxGap) maxGap = gap;
+        last = now;
+    }
+    uint16_t gap = (uint16_t)TIM22->CNT - last;
+    return gap > maxGap ? gap : maxGap;
+}
+
+static __attribute__((noinline)) uint32_t stallLoopFlash(volatile uint32_t* dst, uint32_t value) {
+    return stallLoop(dst, value);
+}
+
+static PLATFORM_RAMFUNC uint32_t stallLoopRam(volatile uint32_t* dst, uint32_t value) {
+    return stallLoop(dst, value);
+}
+
+bool platform_selftest_nvm_stall(size_t address, uint32_t* flashUs, uint32_t* ramUs) {
+    // Queued writes would end the probe's operation early
+    platform_storage_flush();
+    volatile uint32_t* dst = (volatile uint32_t*)(DATA_EEPROM_BASE + address);
+    uint32_t original = *dst;
+
+    // TIM22 on APB2; timer clock doubles when APB2 is divided
+    uint32_t timClk = HAL_RCC_GetPCLK2Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_CFGR_PPRE2_DIV1) {
+        timClk *= 2;
+    }
+    platform_power_acquire(PLATFORM_PERIPH_TIM22);
+    TIM22->CR1 = 0;
+    TIM22->PSC = timClk / 1000000 - 1;
+    TIM22->ARR = 0xFFFF;
+    TIM22->EGR = TIM_EGR_UG;
+    TIM22->CR1 = TIM_CR1_CEN;
+
+    if (FLASH->PECR & FLASH_PECR_PELOCK) {
+        FLASH->PEKEYR = FLASH_PEKEY1;
+        FLASH->PEKEYR = FLASH_PEKEY2;
+    }
+    while (FLASH->SR & FLASH_SR_BSY) {
+    }
+
+    // Interrupts off: only the loop's own code placement is measured
+    __disable_irq();
+    *flashUs = stallLoopFlash(dst, ~original);
+    *ramUs = stallLoopRam(dst, original);
+    __enable_irq();
+
+    FLASH->PECR |= FLASH_PECR_PELOCK;
+    TIM22->CR1 = 0;
+    platform_power_release(PLATFORM_PERIPH_TIM22);
+    return *dst == original;
+}
@@ -37,6 +37,10 @@ void platform_serial_print_hex(uint8_t byte) {
     Serial.print(byte, HEX);
 }
 
+void platform_serial_write(const uint8_t* data, size_t len) {
+    Serial.write(data, len);
+}
+
 void platform_serial_println(const char* str) {
     Serial.println(str);
 }
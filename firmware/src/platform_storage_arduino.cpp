@@ -1,15 +1,162 @@
 // Platform storage implementation for Arduino framework
 #include "platform_storage.h"
+#include "platform_ramfunc.h"
+#include "stm32l0xx_hal.h"
 #include <EEPROM.h>
 #include <cstddef>  // for size_t
 
+// Writes program the data EEPROM at register level from RAM
+// (platform_ramfunc.h): flash fetches stall while a word programs,
+// so the program-and-wait loop must not run from flash. Reads go
+// through the EEPROM library, which maps the same DATA_EEPROM_BASE.
+//
+// Queued writes are programmed from FLASH_IRQHandler, also in RAM:
+// each end-of-operation interrupt starts the next word, and the
+// EEPROM stays unlocked until the queue drains. Code in flash still
+// stalls while a word programs, but nothing spins waiting for BSY.
+
 static size_t g_storage_size = 0;
 
+// Power of two: the RAM handler must not divide
+static constexpr uint32_t QUEUE_LEN = 32;
+static constexpr uint32_t MAX_FENCES = 4;
+static constexpr uint32_t FLASH_SR_ERRORS = FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_SIZERR |
+                                            FLASH_SR_NOTZEROERR | FLASH_SR_FWWERR;
+
+static volatile uint16_t g_queueAddr[QUEUE_LEN];
+static volatile uint32_t g_queueWord[QUEUE_LEN];
+static volatile uint32_t g_queueHead = 0;     // Programming while g_queueCount > 0
+static volatile uint32_t g_queueCount = 0;
+static volatile bool g_queueFailed = false;
+
+struct Fence {
+    platform_storage_done_fn done;
+    void* ctx;
+};
+static Fence g_fences[MAX_FENCES];
+static volatile uint32_t g_fenceCount = 0;
+
+static PLATFORM_RAMFUNC void eepromWaitReady() {
+    while (FLASH->SR & FLASH_SR_BSY) {
+    }
+}
+
+static void eepromUnlock() {
+    if (FLASH->PECR & FLASH_PECR_PELOCK) {
+        FLASH->PEKEYR = FLASH_PEKEY1;
+        FLASH->PEKEYR = FLASH_PEKEY2;
+    }
+}
+
+static void eepromLock() {
+    FLASH->PECR |= FLASH_PECR_PELOCK;
+}
+
+static PLATFORM_RAMFUNC void eepromProgramByte(size_t address, uint8_t value) {
+    eepromWaitReady();
+    *(volatile uint8_t*)(DATA_EEPROM_BASE + address) = value;
+    eepromWaitReady();
+}
+
+// Program [address, address + len) with address and len word aligned
+static PLATFORM_RAMFUNC void eepromProgramWords(size_t address, const uint8_t* data, size_t len) {
+    volatile uint32_t* dst = (volatile uint32_t*)(DATA_EEPROM_BASE + address);
+    for (size_t i = 0; i < len; i += 4) {
+        uint32_t word = (uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) |
+                        ((uint32_t)data[i + 2] << 16) | ((uint32_t)data[i + 3] << 24);
+        if (*dst != word) {
+            eepromWaitReady();
+            *dst = word;
+            eepromWaitReady();
+        }
+        dst++;
+    }
+}
+
+static PLATFORM_RAMFUNC void queueStartHead() {
+    uint32_t head = g_queueHead;
+    *(volatile uint32_t*)(DATA_EEPROM_BASE + g_queueAddr[head]) = g_queueWord[head];
+}
+
+extern "C" PLATFORM_RAMFUNC void FLASH_IRQHandler(void) {
+    uint32_t sr = FLASH->SR;
+    FLASH->SR = sr & (FLASH_SR_EOP | FLASH_SR_ERRORS);   // Write 1 to clear
+    if (g_queueCount == 0) {
+        return;
+    }
+    if (sr & FLASH_SR_ERRORS) {
+        g_queueFailed = true;
+    }
+
+    g_queueHead = (g_queueHead + 1) & (QUEUE_LEN - 1);
+    g_queueCount = g_queueCount - 1;
+    if (g_queueCount > 0) {
+        queueStartHead();
+        return;
+    }
+
+    // Drained: nothing is programming, so the callbacks may run from flash
+    FLASH->PECR &= ~(FLASH_PECR_EOPIE | FLASH_PECR_ERRIE);
+    FLASH->PECR |= FLASH_PECR_PELOCK;
+    bool ok = !g_queueFailed;
+    g_queueFailed = false;
+    uint32_t fences = g_fenceCount;
+    g_fenceCount = 0;
+    for (uint32_t i = 0; i < fences; i++) {
+        g_fences[i].done(g_fences[i].ctx, ok);
+    }
+}
+
+static void queueWord(size_t address, uint32_t word, uint32_t mask) {
+    // Wait for room; the interrupt frees a slot every word
+    while (g_queueCount == QUEUE_LEN) {
+    }
+
+    __disable_irq();
+    uint32_t count = g_queueCount;
+
+    // A word still waiting (not the one programming) is updated in place
+    for (uint32_t i = 1; i < count; i++) {
+        uint32_t slot = (g_queueHead + i) & (QUEUE_LEN - 1);
+        if (g_queueAddr[slot] == address) {
+            g_queueWord[slot] = (g_queueWord[slot] & ~mask) | (word & mask);
+            __enable_irq();
+            return;
+        }
+    }
+
+    // The newest copy of a word programming now is still in the queue
+    uint32_t current;
+    if (count > 0 && g_queueAddr[g_queueHead] == address) {
+        current = g_queueWord[g_queueHead];
+    } else {
+        current = *(volatile uint32_t*)(DATA_EEPROM_BASE + address);
+    }
+    word = (current & ~mask) | (word & mask);
+    if (word == current) {
+        __enable_irq();
+        return;
+    }
+
+    uint32_t slot = (g_queueHead + count) & (QUEUE_LEN - 1);
+    g_queueAddr[slot] = (uint16_t)address;
+    g_queueWord[slot] = word;
+    g_queueCount = count + 1;
+    if (count == 0) {
+        eepromUnlock();
+        FLASH->PECR |= FLASH_PECR_EOPIE | FLASH_PECR_ERRIE;
+        queueStartHead();
+    }
+    __enable_irq();
+}
+
 bool platform_storage_begin(size_t size) {
     g_storage_size = size;
     // STM32 Arduino EEPROM.begin() doesn't take a size parameter
     // It uses the size configured in the EEPROM library
     EEPROM.begin();
+    NVIC_SetPriority(FLASH_IRQn, 3);
+    NVIC_EnableIRQ(FLASH_IRQn);
     return true;
 }
 
@@ -17,6 +164,7 @@ uint8_t platform_storage_read(size_t address) {
     if (address >= g_storage_size) {
         return 0;
     }
+    platform_storage_flush();
     return EEPROM.read(address);
 }
 
@@ -24,7 +172,41 @@ void platform_storage_write(size_t address, uint8_t value) {
     if (address >= g_storage_size) {
         return;
     }
-    EEPROM.write(address, value);
+    platform_storage_flush();
+    eepromUnlock();
+    eepromProgramByte(address, value);
+    eepromLock();
+}
+
+void platform_storage_write_block(size_t address, const uint8_t* data, size_t len) {
+    if (address >= g_storage_size || len > g_storage_size - address) {
+        return;
+    }
+    platform_storage_flush();
+    eepromUnlock();
+    // Unaligned head and tail go byte by byte, the middle as words
+    while (len > 0 && (address & 3) != 0) {
+        if (EEPROM.read(address) != *data) {
+            eepromProgramByte(address, *data);
+        }
+        address++;
+        data++;
+        len--;
+    }
+    size_t words = len & ~(size_t)3;
+    eepromProgramWords(address, data, words);
+    address += words;
+    data += words;
+    len -= words;
+    while (len > 0) {
+        if (EEPROM.read(address) != *data) {
+            eepromProgramByte(address, *data);
+        }
+        address++;
+        data++;
+        len--;
+    }
+    eepromLock();
 }
 
 bool platform_storage_commit() {
@@ -36,3 +218,48 @@ bool platform_storage_commit() {
     #endif
     return true;
 }
+
+void platform_storage_queue_block(size_t address, const uint8_t* data, size_t len) {
+    if (address >= g_storage_size || len > g_storage_size - address) {
+        return;
+    }
+    while (len > 0) {
+        // Merge the bytes that fall in this word; the rest keep their value
+        size_t wordAddr = address & ~(size_t)3;
+        uint32_t word = 0;
+        uint32_t mask = 0;
+        for (size_t i = address - wordAddr; i < 4 && len > 0; i++) {
+            word |= (uint32_t)*data << (8 * i);
+            mask |= (uint32_t)0xFF << (8 * i);
+            address++;
+            data++;
+            len--;
+        }
+        queueWord(wordAddr, word, mask);
+    }
+}
+
+void platform_storage_queue_fence(platform_storage_done_fn done, void* ctx) {
+    while (g_fenceCount == MAX_FENCES) {
+    }
+    __disable_irq();
+    if (g_queueCount == 0) {
+        __enable_irq();
+        done(ctx, true);
+        return;
+    }
+    g_fences[g_fenceCount].done = done;
+    g_fences[g_fenceCount].ctx = ctx;
+    g_fenceCount = g_fenceCount + 1;
+    __enable_irq();
+}
+
+bool platform_storage_busy() {
+    return g_queueCount > 0;
+}
+
+void platform_storage_flush() {
+    while (g_queueCount > 0) {
+        __WFI();   // The end-of-operation interrupt wakes us
+    }
+}
@@ -0,0 +1,48 @@
+// Platform timing dispatch (portable)
+#include "platform_timing.h"
+
+#ifdef UNIT_TEST
+// Host builds have no hardware clock: time stands still until a
+// test installs a backend.
+static uint32_t nullNow(void*) { return 0; }
+static void nullDelay(void*, uint32_t) {}
+static const platform_timing_backend_t kDefaultBackend = {
+    nullNow, nullNow, nullDelay, nullDelay, nullptr, nullptr
+};
+#define PLATFORM_TIMING_DEFAULT (&kDefaultBackend)
+#else
+#define PLATFORM_TIMING_DEFAULT (&platform_timing_hw_backend)
+#endif
+
+static const platform_timing_backend_t* g_backend = PLATFORM_TIMING_DEFAULT;
+
+void platform_timing_set_backend(const platform_timing_backend_t* backend) {
+    g_backend = backend ? backend : PLATFORM_TIMING_DEFAULT;
+}
+
+uint32_t platform_millis() {
+    return g_backend->millis(g_backend->ctx);
+}
+
+uint32_t platform_micros() {
+    return g_backend->micros(g_backend->ctx);
+}
+
+void platform_delay_ms(uint32_t ms) {
+    g_backend->delay_ms(g_backend->ctx, ms);
+}
+
+void platform_delay_us(uint32_t us) {
+    g_backend->delay_us(g_backend->ctx, us);
+}
+
+void platform_timing_hint_deadline_us(uint32_t inUs) {
+    if (g_backend->deadline_hint) {
+        g_backend->deadline_hint(g_backend->ctx, inUs);
+    }
+}
+
+void platform_timing_hint_deadline_ms(uint32_t inMs) {
+    // Clamp so the microsecond hint cannot wrap
+    platform_timing_hint_deadline_us(inMs >= UINT32_MAX / 1000 ? UINT32_MAX : inMs * 1000);
+}
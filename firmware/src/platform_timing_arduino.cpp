@@ -6,18 +6,22 @@ void platform_timing_init() {
     // No-op for Arduino
 }
 
-uint32_t platform_millis() {
+static uint32_t hwMillis(void*) {
     return millis();
 }
 
-uint32_t platform_micros() {
+static uint32_t hwMicros(void*) {
     return micros();
 }
 
-void platform_delay_ms(uint32_t ms) {
+static void hwDelayMs(void*, uint32_t ms) {
     delay(ms);
 }
 
-void platform_delay_us(uint32_t us) {
+static void hwDelayUs(void*, uint32_t us) {
     delayMicroseconds(us);
 }
+
+const platform_timing_backend_t platform_timing_hw_backend = {
+    hwMillis, hwMicros, hwDelayMs, hwDelayUs, nullptr, nullptr
+};
@@ -0,0 +1,67 @@
+// =====================================================
+// Platform USB Power State - Arduino/STM32 Implementation
+// =====================================================
+// The STM32duino core owns the USB device stack, including
+// HAL_PCD_SuspendCallback(). The state is read back from the
+// peripheral instead: the PCD interrupt handler sets
+// CNTR.FSUSP on a suspend and clears it on resume, and DADDR
+// holds the address the host assigned during enumeration.
+// =====================================================
+
+#include "platform_usb.h"
+#include "platform_gpio.h"
+#include "board_config.h"
+#include "stm32l0xx_hal.h"
+
+void platform_usb_begin() {
+#ifdef USB_VBUS_SENSE_PIN
+    platform_gpio_pin_mode(USB_VBUS_SENSE_PIN, PLATFORM_GPIO_MODE_INPUT);
+#endif
+}
+
+static bool vbusPresent() {
+#ifdef USB_VBUS_SENSE_PIN
+    return platform_gpio_read(USB_VBUS_SENSE_PIN);
+#else
+    return true;
+#endif
+}
+
+bool platform_usb_clocked() {
+    return (RCC->APB1ENR & RCC_APB1ENR_USBEN) != 0;
+}
+
+platform_usb_state_t platform_usb_state() {
+    if (!vbusPresent() || !platform_usb_clocked()) {
+        return PLATFORM_USB_NO_HOST;
+    }
+    // A charger also lets the bus go idle (SUSP), but never assigns an address
+    if (!(USB->DADDR & USB_DADDR_ADD)) {
+        return PLATFORM_USB_NO_HOST;
+    }
+    return (USB->CNTR & USB_CNTR_FSUSP) ? PLATFORM_USB_SUSPENDED : PLATFORM_USB_ACTIVE;
+}
+
+platform_supply_t platform_usb_supply() {
+#ifdef USB_VBUS_SENSE_PIN
+    return vbusPresent() ? PLATFORM_SUPPLY_USB : PLATFORM_SUPPLY_BATTERY;
+#else
+    return platform_usb_state() != PLATFORM_USB_NO_HOST ? PLATFORM_SUPPLY_USB : PLATFORM_SUPPLY_UNKNOWN;
+#endif
+}
+
+const char* platform_usb_state_name(platform_usb_state_t state) {
+    switch (state) {
+        case PLATFORM_USB_ACTIVE:    return "active";
+        case PLATFORM_USB_SUSPENDED: return "suspended";
+        default:                     return "no_host";
+    }
+}
+
+const char* platform_usb_supply_name(platform_supply_t supply) {
+    switch (supply) {
+        case PLATFORM_SUPPLY_USB:     return "usb";
+        case PLATFORM_SUPPLY_BATTERY: return "battery";
+        default:                      return "unknown";
+    }
+}
@@ -0,0 +1,443 @@
+#include "response_schema.h"
+#include <string.h>
+
+// =====================================================
+// Encoder
+// =====================================================
+
+namespace {
+
+class Writer {
+public:
+    Writer(uint8_t* out, size_t cap) : _out(out), _cap(cap) {}
+
+    void byte(uint8_t b) {
+        if (_len < _cap) _out[_len] = b;
+        _len++;
+    }
+    void bytes(const void* data, size_t n) {
+        if (_len + n <= _cap) memcpy(_out + _len, data, n);
+        _len += n;
+    }
+    void text(const char* s) { bytes(s, strlen(s)); }
+    void number(uint32_t v) {
+        char digits[10];
+        bytes(digits, response_format_u32(v, digits));
+    }
+    void hex(const uint8_t* in, size_t n) {
+        static const char HEX[] = "0123456789ABCDEF";
+        for (size_t i = 0; i < n; i++) {
+            byte(HEX[in[i] >> 4]);
+            byte(HEX[in[i] & 0x0F]);
+        }
+    }
+
+    size_t length() const { return _len; }
+    bool overflowed() const { return _len > _cap; }
+    void patchU16(size_t at, uint16_t v) {
+        if (at + 2 <= _cap) {
+            _out[at] = (uint8_t)v;
+            _out[at + 1] = (uint8_t)(v >> 8);
+        }
+    }
+
+private:
+    uint8_t* _out;
+    size_t _cap;
+    size_t _len = 0;
+};
+
+uint32_t readNumber(const uint8_t* p, uint8_t width) {
+    switch (width) {
+        case 1: return *p;
+        case 2: { uint16_t v; memcpy(&v, p, 2); return v; }
+        default: { uint32_t v; memcpy(&v, p, 4); return v; }
+    }
+}
+
+const char* readString(const uint8_t* p) {
+    const char* s;
+    memcpy(&s, p, sizeof(s));
+    return s ? s : "";
+}
+
+bool isZero(const ResponseField& f, const uint8_t* p) {
+    switch (f.type) {
+        case RF_STR:
+            return readString(p)[0] == '\0';
+        case RF_HEX:
+            for (uint8_t i = 0; i < f.width; i++) {
+                if (p[i]) return false;
+            }
+            return true;
+        case RF_BOOL:
+            return !*reinterpret_cast<const bool*>(p);
+        default:
+            return readNumber(p, f.width) == 0;
+    }
+}
+
+// Variable fields of a template being built: their value is left out
+// (JSON) or written as a placeholder (binary) and the spot recorded
+struct HoleRecorder {
+    ResponseTemplateInfo* info;
+    uint32_t mask;
+
+    bool wants(uint8_t field) const { return mask & (1u << field); }
+    void add(size_t at, uint8_t field) {
+        if (info->holeCount < RESPONSE_TEMPLATE_MAX_HOLES) {
+            info->holes[info->holeCount] = { (uint16_t)at, field };
+        }
+        info->holeCount++;
+    }
+};
+
+void encodeJson(Writer& w, const ResponseSchema& schema, const uint8_t* values,
+                HoleRecorder* holes = nullptr) {
+    w.text("{\"event\":\"");
+    w.text(schema.event);
+    w.byte('"');
+
+    for (uint8_t i = 0; i < schema.fieldCount; i++) {
+        const ResponseField& f = schema.fields[i];
+        const uint8_t* p = values + f.offset;
+        if (f.omitIfZero && isZero(f, p)) continue;
+
+        w.text(",\"");
+        w.text(f.name);
+        w.text("\":");
+        if (holes && holes->wants(i)) {
+            holes->add(w.length(), i);
+            continue;
+        }
+        switch (f.type) {
+            case RF_STR:
+                // Values are literals or hex/ASCII tokens: nothing to escape
+                w.byte('"');
+                w.text(readString(p));
+                w.byte('"');
+                break;
+            case RF_HEX:
+                w.byte('"');
+                w.hex(p, f.width);
+                w.byte('"');
+                break;
+            case RF_BOOL:
+                w.text(*reinterpret_cast<const bool*>(p) ? "true" : "false");
+                break;
+            default:
+                w.number(readNumber(p, f.width));
+                break;
+        }
+    }
+    w.text("}\r\n");
+}
+
+void encodeBinary(Writer& w, const ResponseSchema& schema, const uint8_t* values,
+                  HoleRecorder* holes = nullptr) {
+    w.byte(RESPONSE_FRAME_SYNC);
+    w.byte(schema.id);
+    w.byte(0);  // payload length, patched below
+    w.byte(0);
+
+    for (uint8_t i = 0; i < schema.fieldCount; i++) {
+        const ResponseField& f = schema.fields[i];
+        const uint8_t* p = values + f.offset;
+        if (holes && holes->wants(i)) {
+            holes->add(w.length(), i);
+        }
+        switch (f.type) {
+            case RF_STR: {
+                const char* s = readString(p);
+                size_t n = strlen(s);
+                if (n > 255) n = 255;
+                w.byte((uint8_t)n);
+                w.bytes(s, n);
+                break;
+            }
+            case RF_HEX:
+                w.bytes(p, f.width);
+                break;
+            case RF_BOOL:
+                w.byte(*reinterpret_cast<const bool*>(p) ? 1 : 0);
+                break;
+            default: {
+                // Structs hold numbers in host order; the wire is little-endian
+                uint32_t v = readNumber(p, f.width);
+                for (uint8_t b = 0; b < f.width; b++) {
+                    w.byte((uint8_t)(v >> (8 * b)));
+                }
+                break;
+            }
+        }
+    }
+    w.patchU16(2, (uint16_t)(w.length() - RESPONSE_FRAME_HEADER));
+}
+
+const char* typeName(uint8_t type) {
+    switch (type) {
+        case RF_U8:   return "u8";
+        case RF_U16:  return "u16";
+        case RF_U32:  return "u32";
+        case RF_BOOL: return "bool";
+        case RF_STR:  return "str";
+        default:      return "hex";
+    }
+}
+
+}  // namespace
+
+size_t response_format_u32(uint32_t v, char* out) {
+    char rev[10];
+    size_t n = 0;
+    do {
+        rev[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = rev[n - 1 - i];
+    }
+    return n;
+}
+
+size_t response_encode(const ResponseSchema& schema, const void* values,
+                       ResponseFormat format, uint8_t* out, size_t cap) {
+    Writer w(out, cap);
+    const uint8_t* v = static_cast<const uint8_t*>(values);
+    if (format == RESPONSE_BINARY) {
+        encodeBinary(w, schema, v);
+    } else {
+        encodeJson(w, schema, v);
+    }
+    return w.overflowed() ? 0 : w.length();
+}
+
+// =====================================================
+// Templates
+// =====================================================
+
+static bool isNumber(uint8_t type) {
+    return type == RF_U8 || type == RF_U16 || type == RF_U32;
+}
+
+bool response_template_build(ResponseTemplateInfo& info, uint8_t* text, size_t cap,
+                             const ResponseSchema& schema, const void* values,
+                             uint32_t variableMask, ResponseFormat format) {
+    info = {};
+    for (uint8_t i = 0; i < schema.fieldCount; i++) {
+        const ResponseField& f = schema.fields[i];
+        // Optional fields change the JSON shape, so they cannot be holes
+        if ((variableMask & (1u << i)) && (!isNumber(f.type) || f.omitIfZero)) {
+            return false;
+        }
+    }
+
+    Writer w(text, cap);
+    HoleRecorder holes = { &info, variableMask };
+    const uint8_t* v = static_cast<const uint8_t*>(values);
+    if (format == RESPONSE_BINARY) {
+        encodeBinary(w, schema, v, &holes);
+    } else {
+        encodeJson(w, schema, v, &holes);
+    }
+    if (w.overflowed() || w.length() > 0xFFFF || info.holeCount > RESPONSE_TEMPLATE_MAX_HOLES) {
+        info = {};
+        return false;
+    }
+    info.schema = &schema;
+    info.format = format;
+    info.len = (uint16_t)w.length();
+    return true;
+}
+
+size_t response_template_render(const ResponseTemplateInfo& info, const uint8_t* text,
+                                const void* values, uint8_t* out, size_t cap) {
+    if (!info.len) {
+        return 0;
+    }
+    const uint8_t* v = static_cast<const uint8_t*>(values);
+    Writer w(out, cap);
+
+    if (info.format == RESPONSE_BINARY) {
+        // Fixed layout: copy, then overwrite each number in place
+        w.bytes(text, info.len);
+        if (w.overflowed()) {
+            return 0;
+        }
+        for (uint8_t h = 0; h < info.holeCount; h++) {
+            const ResponseField& f = info.schema->fields[info.holes[h].field];
+            uint32_t n = readNumber(v + f.offset, f.width);
+            for (uint8_t b = 0; b < f.width; b++) {
+                out[info.holes[h].at + b] = (uint8_t)(n >> (8 * b));
+            }
+        }
+        return w.length();
+    }
+
+    // JSON: cached text up to each hole, then the value's digits
+    size_t from = 0;
+    for (uint8_t h = 0; h < info.holeCount; h++) {
+        const ResponseField& f = info.schema->fields[info.holes[h].field];
+        w.bytes(text + from, info.holes[h].at - from);
+        w.number(readNumber(v + f.offset, f.width));
+        from = info.holes[h].at;
+    }
+    w.bytes(text + from, info.len - from);
+    return w.overflowed() ? 0 : w.length();
+}
+
+size_t response_describe(const ResponseSchema& schema, uint8_t* out, size_t cap) {
+    Writer w(out, cap);
+    w.text("{\"event\":\"schema\",\"id\":");
+    w.number(schema.id);
+    w.text(",\"name\":\"");
+    w.text(schema.event);
+    w.text("\",\"fields\":[");
+    for (uint8_t i = 0; i < schema.fieldCount; i++) {
+        const ResponseField& f = schema.fields[i];
+        w.text(i ? ",[\"" : "[\"");
+        w.text(f.name);
+        w.text("\",\"");
+        w.text(typeName(f.type));
+        w.text("\",");
+        w.number(f.width);
+        w.byte(']');
+    }
+    w.text("]}\r\n");
+    return w.overflowed() ? 0 : w.length();
+}
+
+// =====================================================
+// Reply Definitions
+// =====================================================
+// Field order is the JSON key order and the binary layout.
+// Ids are part of the binary protocol: append, never renumber.
+
+static constexpr ResponseField ERROR_FIELDS[] = {
+    RESPONSE_FIELD(ErrorResponse, msg),
+};
+static constexpr ResponseField ACK_FIELDS[] = {
+    RESPONSE_FIELD(AckResponse, cmd),
+    RESPONSE_FIELD_OPTIONAL(AckResponse, keyVersion),
+};
+static constexpr ResponseField HELLO_FIELDS[] = {
+    RESPONSE_FIELD(HelloResponse, device_id),
+    RESPONSE_FIELD(HelloResponse, fw),
+    RESPONSE_FIELD(HelloResponse, build),
+    RESPONSE_FIELD(HelloResponse, hash),
+};
+static constexpr ResponseField STATE_FIELDS[] = {
+    RESPONSE_FIELD(StateResponse, totalTapCount),
+    RESPONSE_FIELD(StateResponse, linkCount),
+};
+static constexpr ResponseField SNAPSHOT_FIELDS[] = {
+    RESPONSE_FIELD(SnapshotResponse, snap),
+    RESPONSE_FIELD(SnapshotResponse, totalTapCount),
+    RESPONSE_FIELD(SnapshotResponse, linkCount),
+};
+static constexpr ResponseField SIGNED_STATE_FIELDS[] = {
+    RESPONSE_FIELD(SignedStateResponse, device_id),
+    RESPONSE_FIELD(SignedStateResponse, nonce),
+    RESPONSE_FIELD(SignedStateResponse, totalTapCount),
+    RESPONSE_FIELD(SignedStateResponse, linkCount),
+    RESPONSE_FIELD_OPTIONAL(SignedStateResponse, snap),
+    RESPONSE_FIELD(SignedStateResponse, keyVersion),
+    RESPONSE_FIELD(SignedStateResponse, hmac),
+};
+static constexpr ResponseField KEY_FIELDS[] = {
+    RESPONSE_FIELD(KeyResponse, keyVersion),
+    RESPONSE_FIELD(KeyResponse, key),
+};
+static constexpr ResponseField BRIDGE_FIELDS[] = {
+    RESPONSE_FIELD(BridgeResponse, on),
+    RESPONSE_FIELD_OPTIONAL(BridgeResponse, station),
+    RESPONSE_FIELD(BridgeResponse, seq),
+};
+static constexpr ResponseField TAP_FIELDS[] = {
+    RESPONSE_FIELD(TapEventResponse, seq),
+    RESPONSE_FIELD(TapEventResponse, role),
+    RESPONSE_FIELD(TapEventResponse, self),
+    RESPONSE_FIELD(TapEventResponse, peer),
+};
+static constexpr ResponseField FORMAT_FIELDS[] = {
+    RESPONSE_FIELD(FormatResponse, format),
+};
+static constexpr ResponseField IMAGE_ERROR_FIELDS[] = {
+    RESPONSE_FIELD(ImageErrorResponse, msg),
+    RESPONSE_FIELD(ImageErrorResponse, next),
+};
+static constexpr ResponseField IMAGE_BEGIN_FIELDS[] = {
+    RESPONSE_FIELD(ImageBeginResponse, nonce),
+    RESPONSE_FIELD(ImageBeginResponse, size),
+    RESPONSE_FIELD(ImageBeginResponse, chunk),
+    RESPONSE_FIELD(ImageBeginResponse, next),
+};
+static constexpr ResponseField IMAGE_AUTH_FIELDS[] = {
+    RESPONSE_FIELD(ImageAuthResponse, ok),
+    RESPONSE_FIELD(ImageAuthResponse, next),
+};
+static constexpr ResponseField IMAGE_DATA_FIELDS[] = {
+    RESPONSE_FIELD(ImageDataResponse, off),
+    RESPONSE_FIELD(ImageDataResponse, len),
+    RESPONSE_FIELD(ImageDataResponse, crc),
+};
+static constexpr ResponseField IMAGE_ACK_FIELDS[] = {
+    RESPONSE_FIELD(ImageAckResponse, next),
+};
+static constexpr ResponseField IMAGE_COMMIT_FIELDS[] = {
+    RESPONSE_FIELD(ImageCommitResponse, ok),
+    RESPONSE_FIELD(ImageCommitResponse, totalTapCount),
+    RESPONSE_FIELD(ImageCommitResponse, linkCount),
+};
+
+static constexpr ResponseField LINKS_Z_FIELDS[] = {
+    RESPONSE_FIELD_OPTIONAL(LinksExportResponse, snap),
+    RESPONSE_FIELD(LinksExportResponse, totalTapCount),
+    RESPONSE_FIELD(LinksExportResponse, linkCount),
+    RESPONSE_FIELD(LinksExportResponse, len),
+};
+
+const ResponseSchemaOf<ErrorResponse> SCHEMA_ERROR =
+    response_schema<ErrorResponse>(1, "error", ERROR_FIELDS);
+const ResponseSchemaOf<AckResponse> SCHEMA_ACK =
+    response_schema<AckResponse>(2, "ack", ACK_FIELDS);
+const ResponseSchemaOf<HelloResponse> SCHEMA_HELLO =
+    response_schema<HelloResponse>(3, "hello", HELLO_FIELDS);
+const ResponseSchemaOf<StateResponse> SCHEMA_STATE =
+    response_schema<StateResponse>(4, "state", STATE_FIELDS);
+const ResponseSchemaOf<SnapshotResponse> SCHEMA_SNAPSHOT =
+    response_schema<SnapshotResponse>(5, "snapshot", SNAPSHOT_FIELDS);
+const ResponseSchemaOf<SignedStateResponse> SCHEMA_SIGNED_STATE =
+    response_schema<SignedStateResponse>(6, "SIGNED_STATE", SIGNED_STATE_FIELDS);
+const ResponseSchemaOf<KeyResponse> SCHEMA_KEY =
+    response_schema<KeyResponse>(7, "key", KEY_FIELDS);
+const ResponseSchemaOf<BridgeResponse> SCHEMA_BRIDGE =
+    response_schema<BridgeResponse>(8, "bridge", BRIDGE_FIELDS);
+const ResponseSchemaOf<TapEventResponse> SCHEMA_TAP =
+    response_schema<TapEventResponse>(9, "tap", TAP_FIELDS);
+const ResponseSchemaOf<FormatResponse> SCHEMA_FORMAT =
+    response_schema<FormatResponse>(10, "format", FORMAT_FIELDS);
+const ResponseSchemaOf<ImageErrorResponse> SCHEMA_IMAGE_ERROR =
+    response_schema<ImageErrorResponse>(11, "error", IMAGE_ERROR_FIELDS);
+const ResponseSchemaOf<ImageBeginResponse> SCHEMA_IMAGE_BEGIN =
+    response_schema<ImageBeginResponse>(12, "image_begin", IMAGE_BEGIN_FIELDS);
+const ResponseSchemaOf<ImageAuthResponse> SCHEMA_IMAGE_AUTH =
+    response_schema<ImageAuthResponse>(13, "image_auth", IMAGE_AUTH_FIELDS);
+const ResponseSchemaOf<ImageDataResponse> SCHEMA_IMAGE_DATA =
+    response_schema<ImageDataResponse>(14, "image_data", IMAGE_DATA_FIELDS);
+const ResponseSchemaOf<ImageAckResponse> SCHEMA_IMAGE_ACK =
+    response_schema<ImageAckResponse>(15, "image_ack", IMAGE_ACK_FIELDS);
+const ResponseSchemaOf<ImageCommitResponse> SCHEMA_IMAGE_COMMIT =
+    response_schema<ImageCommitResponse>(16, "image_commit", IMAGE_COMMIT_FIELDS);
+const ResponseSchemaOf<LinksExportResponse> SCHEMA_LINKS_Z =
+    response_schema<LinksExportResponse>(17, "links_z", LINKS_Z_FIELDS);
+
+const ResponseSchema* const RESPONSE_SCHEMAS[] = {
+    &SCHEMA_ERROR.schema, &SCHEMA_ACK.schema, &SCHEMA_HELLO.schema,
+    &SCHEMA_STATE.schema, &SCHEMA_SNAPSHOT.schema, &SCHEMA_SIGNED_STATE.schema,
+    &SCHEMA_KEY.schema, &SCHEMA_BRIDGE.schema, &SCHEMA_TAP.schema,
+    &SCHEMA_FORMAT.schema, &SCHEMA_IMAGE_ERROR.schema, &SCHEMA_IMAGE_BEGIN.schema,
+    &SCHEMA_IMAGE_AUTH.schema, &SCHEMA_IMAGE_DATA.schema, &SCHEMA_IMAGE_ACK.schema,
+    &SCHEMA_IMAGE_COMMIT.schema, &SCHEMA_LINKS_Z.schema,
+};
+const size_t RESPONSE_SCHEMA_COUNT = sizeof(RESPONSE_SCHEMAS) / sizeof(RESPONSE_SCHEMAS[0]);
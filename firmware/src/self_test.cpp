@@ -0,0 +1,157 @@
+#include "self_test.h"
+#include "crc32.h"
+#include "platform_selftest.h"
+#include "platform_crc.h"
+#include "platform_rng.h"
+#include "platform_storage.h"
+#include "platform_gpio.h"
+#include "platform_buzzer.h"
+#include "platform_timing.h"
+
+static constexpr uint32_t LINE_SETTLE_US = 200;   // Pull-up rise time with margin
+static constexpr uint32_t PIN_SETTLE_US = 10;
+static constexpr uint32_t CHIRP_HZ = 2700;
+static constexpr uint32_t CHIRP_MS = 50;
+static constexpr size_t RNG_WORDS = 32;  // A bit stuck across all 32 by chance: ~1e-8
+
+static const char* const ITEM_NAMES[SELFTEST_ITEM_COUNT] = {
+    "line", "led", "buzzer", "eeprom", "rng", "crc"
+};
+
+const char* self_test_item_name(uint8_t item) {
+    return item < SELFTEST_ITEM_COUNT ? ITEM_NAMES[item] : "?";
+}
+
+// =====================================================
+// Checks
+// =====================================================
+
+static bool checkLine(IOneWireHal* line) {
+    if (!line) return false;
+
+    // A stuck-low line, missing pull-up or a peer still attached fails here
+    line->driveLow(false);
+    line->delayMicros(LINE_SETTLE_US);
+    bool idleHigh = line->readLine();
+
+    line->driveLow(true);
+    line->delayMicros(PIN_SETTLE_US);
+    bool drivenLow = !line->readLine();
+
+    line->driveLow(false);
+    line->delayMicros(LINE_SETTLE_US);
+    bool releasedHigh = line->readLine();
+
+    return idleHigh && drivenLow && releasedHigh;
+}
+
+// Output pin reads back the level written (catches shorts to rail/neighbour)
+static bool checkOutputPin(uint32_t pin) {
+    platform_gpio_pin_mode(pin, PLATFORM_GPIO_MODE_OUTPUT);
+    platform_gpio_write(pin, PLATFORM_GPIO_HIGH);
+    platform_delay_us(PIN_SETTLE_US);
+    bool high = platform_gpio_read(pin);
+    platform_gpio_write(pin, PLATFORM_GPIO_LOW);
+    platform_delay_us(PIN_SETTLE_US);
+    bool low = !platform_gpio_read(pin);
+    return high && low;
+}
+
+static bool checkLeds(const uint32_t* pins, uint8_t count) {
+    bool ok = count > 0;
+    for (uint8_t i = 0; i < count; i++) {
+        ok &= checkOutputPin(pins[i]);
+    }
+    return ok;
+}
+
+static bool checkBuzzer(uint32_t pin) {
+    bool ok = checkOutputPin(pin);
+    platform_buzzer_init(pin);
+    platform_buzzer_tone(CHIRP_HZ);
+    platform_delay_ms(CHIRP_MS);
+    platform_buzzer_stop();
+    return ok;
+}
+
+static uint32_t readWord(size_t address) {
+    uint32_t w = 0;
+    for (size_t i = 0; i < 4; i++) {
+        w |= (uint32_t)platform_storage_read(address + i) << (8 * i);
+    }
+    return w;
+}
+
+static void writeWord(size_t address, uint32_t w) {
+    uint8_t b[4] = { (uint8_t)w, (uint8_t)(w >> 8), (uint8_t)(w >> 16), (uint8_t)(w >> 24) };
+    platform_storage_write_block(address, b, sizeof(b));
+}
+
+static bool checkEeprom(size_t address, SelfTestReport& report) {
+    // All-0/all-1 and both checkerboards: every cell stores each level
+    // next to a neighbour holding the opposite one
+    static const uint32_t PATTERNS[] = { 0x00000000, 0xFFFFFFFF, 0x55555555, 0xAAAAAAAA };
+
+    uint32_t original = readWord(address);
+    bool ok = true;
+    for (uint32_t pattern : PATTERNS) {
+        writeWord(address, pattern);
+        ok &= readWord(address) == pattern;
+    }
+    writeWord(address, original);
+    ok &= readWord(address) == original;
+
+    ok &= platform_selftest_nvm_stall(address, &report.nvmStallFlashUs, &report.nvmStallRamUs);
+    return ok;
+}
+
+static bool checkRng() {
+    uint32_t words[RNG_WORDS];
+    if (!platform_rng_read(words, RNG_WORDS)) {
+        return false;
+    }
+    // Stuck output: repeated words or a constant bit across all of them
+    uint32_t anyOne = 0;
+    uint32_t anyZero = 0;
+    for (size_t i = 0; i < RNG_WORDS; i++) {
+        if (i > 0 && words[i] == words[i - 1]) {
+            return false;
+        }
+        anyOne |= words[i];
+        anyZero |= ~words[i];
+    }
+    return anyOne == 0xFFFFFFFF && anyZero == 0xFFFFFFFF;
+}
+
+static bool checkCrc() {
+    static const uint8_t VECTOR[] = {
+        0x78, 0x56, 0x34, 0x12, 0x00, 0x00, 0x00, 0x00,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xA5, 0x5A, 0xC3, 0x3C
+    };
+    return platform_crc32(VECTOR, sizeof(VECTOR)) == crc32_stm32_sw(VECTOR, sizeof(VECTOR));
+}
+
+// =====================================================
+// Runner
+// =====================================================
+
+bool self_test_run(const SelfTestConfig& config, SelfTestReport& report) {
+    report = {};
+    uint32_t start = platform_millis();
+
+    bool pass[SELFTEST_ITEM_COUNT];
+    pass[SELFTEST_LINE] = checkLine(config.line);
+    pass[SELFTEST_LED] = checkLeds(config.ledPins, config.ledCount);
+    pass[SELFTEST_BUZZER] = checkBuzzer(config.buzzerPin);
+    pass[SELFTEST_EEPROM] = checkEeprom(config.scratchAddress, report);
+    pass[SELFTEST_RNG] = checkRng();
+    pass[SELFTEST_CRC] = checkCrc();
+
+    for (uint8_t i = 0; i < SELFTEST_ITEM_COUNT; i++) {
+        if (!pass[i]) {
+            report.failMask |= (uint8_t)(1u << i);
+        }
+    }
+    report.durationMs = platform_millis() - start;
+    return report.failMask == 0;
+}
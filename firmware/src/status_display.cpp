@@ -43,7 +43,8 @@ static constexpr StatusDisplay::BlinkStep PATTERN_PEER_READY_STEPS[] = {
      : _pins{0}
      , _ledCount(0)
      , _states{}
-     , _initialized(false) {
+     , _initialized(false)
+     , _dark(false) {
  }
  
  void StatusDisplay::begin(const uint32_t* ledPins, size_t ledCount) {
@@ -81,11 +82,12 @@ static constexpr StatusDisplay::BlinkStep PATTERN_PEER_READY_STEPS[] = {
  }
  
  void StatusDisplay::loop() {
-     if (!_initialized) {
+     if (!_initialized || _dark) {
          return;
      }
  
      uint32_t now = platform_millis();
+     uint32_t nextInMs = UINT32_MAX;
      for (size_t i = 0; i < _ledCount; i++) {
          const LedPattern* pattern = _states[i].pattern;
          if (!pattern) {
@@ -103,6 +105,33 @@ static constexpr StatusDisplay::BlinkStep PATTERN_PEER_READY_STEPS[] = {
              const BlinkStep& next = pattern->steps[_states[i].stepIndex];
              driveLed(i, next.levelHigh);
              _states[i].lastChangeMs = now;
+             elapsed = 0;
+         }
+
+         uint32_t durationMs = pattern->steps[_states[i].stepIndex].durationMs;
+         uint32_t remaining = elapsed < durationMs ? durationMs - elapsed : 0;
+         if (remaining < nextInMs) {
+             nextInMs = remaining;
+         }
+     }
+
+     if (nextInMs != UINT32_MAX) {
+         platform_timing_hint_deadline_ms(nextInMs);
+     }
+ }
+ 
+ void StatusDisplay::setDark(bool dark) {
+     if (dark == _dark) {
+         return;
+     }
+     _dark = dark;
+     for (size_t i = 0; i < _ledCount; i++) {
+         const LedPattern* pattern = _states[i].pattern;
+         if (dark || !pattern) {
+             driveLed(i, false);
+         } else {
+             _states[i].pattern = nullptr;   // Force a restart from step 0
+             applyPattern(i, *pattern);
          }
      }
  }
@@ -182,5 +211,6 @@ const StatusDisplay::LedPattern& StatusDisplay::patternFor(RolePattern pattern)
      if (ledIndex >= _ledCount) {
          return;
      }
-     platform_gpio_write(_pins[ledIndex], level ? PLATFORM_GPIO_HIGH : PLATFORM_GPIO_LOW);
+     bool on = level && !_dark;
+     platform_gpio_write(_pins[ledIndex], on ? PLATFORM_GPIO_HIGH : PLATFORM_GPIO_LOW);
  }
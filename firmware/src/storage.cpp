@@ -1,7 +1,9 @@
 #include "storage.h"
+#include "link_table.h"
 #include "platform_storage.h"
 #include "platform_timing.h"
-#include "stm32l0xx_hal.h"
+#include "platform_crc.h"
+#include "platform_rng.h"
 
 
 Storage::Storage() {}
@@ -39,6 +41,13 @@ bool Storage::begin() {
         }
     }
 
+    // The generation lives in RAM. Start each boot somewhere random so
+    // a host holding a generation from before a reset cannot match it
+    uint32_t seed;
+    if (platform_rng_read(&seed, 1)) {
+        _linkGeneration = seed;
+    }
+
     _dirty = false;
     _lastSaveMs = platform_millis();
     return true;
@@ -53,11 +62,19 @@ void Storage::markDirty() {
 }
 
 void Storage::loop() {
+    if (_nvmFailed) {
+        // A queued word did not program; rewrite whatever differs
+        _nvmFailed = false;
+        _dirty = true;
+    }
     if (!_dirty) return;
+    if (_txnDepth > 0) return;  // Commit will write it
 
-    uint32_t now = platform_millis();
-    if (now - _lastSaveMs >= STORAGE_DELAYED_WRITE_MS) {
+    uint32_t elapsed = platform_millis() - _lastSaveMs;
+    if (elapsed >= STORAGE_DELAYED_WRITE_MS) {
         saveNow();
+    } else {
+        platform_timing_hint_deadline_ms(STORAGE_DELAYED_WRITE_MS - elapsed);
     }
 }
 
@@ -73,6 +90,9 @@ bool Storage::saveNow() {
     bool ok = writeToNvm();
     if (ok) {
         _dirty = false;
+        _pendingTapCount = false;
+        _pendingLinkCount = false;
+        _pendingLinks = 0;
         _lastSaveMs = platform_millis();
     }
     return ok;
@@ -85,6 +105,7 @@ void Storage::clearAll() {
 
     memset(&_image.payload, 0, sizeof(_image.payload));
     memcpy(_image.payload.selfId, selfId, DEVICE_UID_LEN);
+    _linkGeneration++;
 
     markDirty();
     saveNow();
@@ -93,18 +114,7 @@ void Storage::clearAll() {
 
 bool Storage::hasLink(const uint8_t peerId[DEVICE_UID_LEN]) const {
     const PersistPayloadV1& p = _image.payload;
-    
-    uint16_t count = p.linkCount;
-    if (count > PersistPayloadV1::MAX_LINKS) {
-        count = PersistPayloadV1::MAX_LINKS;
-    }
-    
-    for (uint16_t i = 0; i < count; i++) {
-        if (memcmp(p.links[i].peerId, peerId, DEVICE_UID_LEN) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return link_table_find(p.links, p.linkCount, peerId) >= 0;
 }
 
 bool Storage::addLink(const uint8_t peerId[DEVICE_UID_LEN]) {
@@ -118,6 +128,7 @@ bool Storage::addLink(const uint8_t peerId[DEVICE_UID_LEN]) {
     if (idx >= PersistPayloadV1::MAX_LINKS) {
         idx = idx % PersistPayloadV1::MAX_LINKS;
         _linkCountChanged = false;
+        _linkGeneration++;  // Overwriting a slot a snapshot may cover
     } else {
         p.linkCount++;
         _linkCountChanged = true;
@@ -136,71 +147,132 @@ void Storage::incrementTapCount() {
 }
 
 void Storage::saveTapCountOnly() {
-    // Recalculate CRC
-    _image.header.crc32 = calcCrc32(
-        reinterpret_cast<uint8_t*>(&_image.payload),
-        sizeof(PersistPayloadV1)
-    );
-    
-    constexpr size_t tapCountOffset = offsetof(PersistImageV1, payload) + 
-                                      offsetof(PersistPayloadV1, totalTapCount);
-    constexpr size_t crcOffset = offsetof(PersistImageV1, header) + 
-                                 offsetof(PersistHeader, crc32);
-    
-    uint8_t* tapCountPtr = reinterpret_cast<uint8_t*>(&_image.payload.totalTapCount);
-    for (size_t i = 0; i < sizeof(uint32_t); i++) {
-        platform_storage_write(STORAGE_EEPROM_BASE + tapCountOffset + i, tapCountPtr[i]);
+    _pendingTapCount = true;
+    if (_txnDepth == 0) {
+        flushPending();
     }
-    
-    uint8_t* crcPtr = reinterpret_cast<uint8_t*>(&_image.header.crc32);
-    for (size_t i = 0; i < sizeof(uint32_t); i++) {
-        platform_storage_write(STORAGE_EEPROM_BASE + crcOffset + i, crcPtr[i]);
-    }
-    
-    platform_storage_commit();
-    
-    _dirty = false;
-    _lastSaveMs = platform_millis();
 }
 
 void Storage::saveLinkOnly() {
-    // Recalculate CRC
-    _image.header.crc32 = calcCrc32(
-        reinterpret_cast<uint8_t*>(&_image.payload),
-        sizeof(PersistPayloadV1)
-    );
-    
+    if (_linkCountChanged) {
+        _pendingLinkCount = true;
+        _linkCountChanged = false;
+    }
+    _pendingLinks |= (uint64_t)1 << _lastLinkIndex;
+    if (_txnDepth == 0) {
+        flushPending();
+    }
+}
+
+// =====================================================
+// Transactions
+// =====================================================
+
+void Storage::beginTransaction() {
+    _txnDepth++;
+}
+
+bool Storage::commitTransaction() {
+    if (_txnDepth == 0) return false;
+    if (--_txnDepth > 0) return true;  // Outer transaction still open
+    return flushPending();
+}
+
+bool Storage::flushPending() {
+    if (!_pendingTapCount && !_pendingLinkCount && _pendingLinks == 0) {
+        return true;
+    }
+
+    constexpr size_t tapCountOffset = offsetof(PersistImageV1, payload) + 
+                                      offsetof(PersistPayloadV1, totalTapCount);
     constexpr size_t linkCountOffset = offsetof(PersistImageV1, payload) + 
                                        offsetof(PersistPayloadV1, linkCount);
     constexpr size_t linksArrayOffset = offsetof(PersistImageV1, payload) + 
                                         offsetof(PersistPayloadV1, links);
     constexpr size_t crcOffset = offsetof(PersistImageV1, header) + 
                                  offsetof(PersistHeader, crc32);
-    
-    size_t linkEntryOffset = linksArrayOffset + (_lastLinkIndex * sizeof(LinkRecordV1));
-    
-    if (_linkCountChanged) {
-        uint8_t* linkCountPtr = reinterpret_cast<uint8_t*>(&_image.payload.linkCount);
-        for (size_t i = 0; i < sizeof(uint16_t); i++) {
-            platform_storage_write(STORAGE_EEPROM_BASE + linkCountOffset + i, linkCountPtr[i]);
-        }
+
+    // One CRC for everything written in this batch
+    _image.header.crc32 = calcCrc32(
+        reinterpret_cast<uint8_t*>(&_image.payload),
+        sizeof(PersistPayloadV1)
+    );
+
+    if (_pendingTapCount) {
+        writeRangeToNvm(tapCountOffset,
+                        reinterpret_cast<uint8_t*>(&_image.payload.totalTapCount),
+                        sizeof(uint32_t));
     }
-    
-    uint8_t* linkPtr = _image.payload.links[_lastLinkIndex].peerId;
-    for (size_t i = 0; i < DEVICE_UID_LEN; i++) {
-        platform_storage_write(STORAGE_EEPROM_BASE + linkEntryOffset + i, linkPtr[i]);
+
+    if (_pendingLinkCount) {
+        writeRangeToNvm(linkCountOffset,
+                        reinterpret_cast<uint8_t*>(&_image.payload.linkCount),
+                        sizeof(uint16_t));
     }
-    
-    uint8_t* crcPtr = reinterpret_cast<uint8_t*>(&_image.header.crc32);
-    for (size_t i = 0; i < sizeof(uint32_t); i++) {
-        platform_storage_write(STORAGE_EEPROM_BASE + crcOffset + i, crcPtr[i]);
+
+    for (uint16_t i = 0; i < PersistPayloadV1::MAX_LINKS; i++) {
+        if (_pendingLinks & ((uint64_t)1 << i)) {
+            writeRangeToNvm(linksArrayOffset + i * sizeof(LinkRecordV1),
+                            _image.payload.links[i].peerId, DEVICE_UID_LEN);
+        }
     }
-    
+
+    writeRangeToNvm(crcOffset,
+                    reinterpret_cast<uint8_t*>(&_image.header.crc32),
+                    sizeof(uint32_t));
+    platform_storage_queue_fence(&Storage::onNvmWritten, this);
+
     platform_storage_commit();
-    
+
+    _pendingTapCount = false;
+    _pendingLinkCount = false;
+    _pendingLinks = 0;
     _dirty = false;
-    _linkCountChanged = false;
     _lastSaveMs = platform_millis();
+    return true;
+}
+
+// =====================================================
+// Image Transfer
+// =====================================================
+
+bool Storage::readImage(size_t offset, uint8_t* out, size_t len) {
+    if (offset > sizeof(PersistImageV1) || len > sizeof(PersistImageV1) - offset) {
+        return false;
+    }
+    // The RAM image matches NVM once pending changes are written
+    if (_dirty && _txnDepth == 0) {
+        saveNow();
+    }
+    memcpy(out, reinterpret_cast<const uint8_t*>(&_image) + offset, len);
+    return true;
+}
+
+bool Storage::restoreImage(const uint8_t* image, size_t len) {
+    if (len != sizeof(PersistImageV1) || _txnDepth > 0) {
+        return false;
+    }
+
+    // Checked where it lies in the caller's staging buffer; a copy
+    // would put a second image on the stack
+    const uint8_t* payload = image + offsetof(PersistImageV1, payload);
+    PersistHeader header;
+    memcpy(&header, image, sizeof(header));
+    if (!isValidImage(header, payload)) {
+        return false;
+    }
+
+    // Keep who we are: our own UID and our own provisioned key
+    uint8_t keyVersion = _image.payload.keyVersion;
+    uint8_t secretKey[sizeof(_image.payload.secretKey)];
+    memcpy(secretKey, _image.payload.secretKey, sizeof(secretKey));
+
+    memcpy(&_image.payload, payload, sizeof(PersistPayloadV1));
+    getDeviceUidRaw(_image.payload.selfId);
+    _image.payload.keyVersion = keyVersion;
+    memcpy(_image.payload.secretKey, secretKey, sizeof(secretKey));
+    _linkGeneration++;
+    return saveNow();   // writeToNvm() skips words that already match
 }
 
 // per-device key
@@ -235,63 +307,51 @@ void Storage::setSecretKey(uint8_t version, const uint8_t key[32]) {
 bool Storage::loadFromNvm() {
     if (sizeof(PersistImageV1) > STORAGE_EEPROM_SIZE) return false;
 
-    PersistImageV1 temp;
-
+    // Read straight into _image; begin() starts blank if it is invalid
     for (size_t i = 0; i < sizeof(PersistImageV1); ++i) {
-        ((uint8_t*)&temp)[i] = platform_storage_read(STORAGE_EEPROM_BASE + i);
+        ((uint8_t*)&_image)[i] = platform_storage_read(STORAGE_EEPROM_BASE + i);
     }
 
-    if (temp.header.magic != STORAGE_MAGIC) return false;
-    if (temp.header.version != STORAGE_VERSION) return false;
-    if (temp.header.length  != sizeof(PersistPayloadV1)) return false;
+    return isValidImage(_image.header, reinterpret_cast<const uint8_t*>(&_image.payload));
+}
 
-    uint32_t crc = calcCrc32(
-        reinterpret_cast<uint8_t*>(&temp.payload),
-        sizeof(PersistPayloadV1)
-    );
-    if (crc != temp.header.crc32) return false;
+bool Storage::isValidImage(const PersistHeader& header, const uint8_t* payload) {
+    if (header.magic != STORAGE_MAGIC) return false;
+    if (header.version != STORAGE_VERSION) return false;
+    if (header.length  != sizeof(PersistPayloadV1)) return false;
 
-    _image = temp;
-    return true;
+    uint32_t crc = calcCrc32(payload, sizeof(PersistPayloadV1));
+    return crc == header.crc32;
 }
 
 
 bool Storage::writeToNvm() {
-    // Write in chunks with periodic yields
-    const size_t CHUNK_SIZE = 32;
-    for (size_t i = 0; i < sizeof(PersistImageV1); ++i) {
-        platform_storage_write(STORAGE_EEPROM_BASE + i, ((uint8_t*)&_image)[i]);
-        
-        if ((i % CHUNK_SIZE) == (CHUNK_SIZE - 1)) {
-            platform_delay_ms(1);
-        }
-    }
-    
+    // Only words that differ are queued; the NVM interrupt programs
+    // them while the main loop carries on
+    platform_storage_queue_block(STORAGE_EEPROM_BASE, (const uint8_t*)&_image, sizeof(PersistImageV1));
+    platform_storage_queue_fence(&Storage::onNvmWritten, this);
     platform_storage_commit();
-    
     return true;
 }
 
+void Storage::writeRangeToNvm(size_t offset, const uint8_t* data, size_t len) {
+    // Skips words that already match - each EEPROM program is costly
+    platform_storage_queue_block(STORAGE_EEPROM_BASE + offset, data, len);
+}
+
+void Storage::onNvmWritten(void* ctx, bool ok) {
+    // Interrupt context: loop() picks the failure up
+    if (!ok) {
+        static_cast<Storage*>(ctx)->_nvmFailed = true;
+    }
+}
+
 
 // =====================================================
 // Hardware CRC32
 // =====================================================
 
 uint32_t Storage::calcCrc32(const uint8_t* data, size_t len) {
-    if (len % 4 != 0)
-        return 0;  // should never happen due to static_assert
-
-    CRC_HandleTypeDef hcrc;
-    hcrc.Instance = CRC;
-
-    __HAL_RCC_CRC_CLK_ENABLE();
-    HAL_CRC_DeInit(&hcrc);
-    if (HAL_CRC_Init(&hcrc) != HAL_OK) {
-        return 0;
-    }
-
-    uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t*)data, len / 4);
-
-    __HAL_RCC_CRC_CLK_DISABLE();
-    return crc;
+    // len % 4 is guaranteed by static_assert; platform_crc32 returns 0 otherwise
+    return platform_crc32(data, len);
 }
@@ -0,0 +1,143 @@
+#include "sync_format.h"
+#include "hex_util.h"
+
+static_assert(sizeof(LinkRecordV1) == DEVICE_UID_LEN, "links are copied as packed UIDs");
+
+size_t sign_message_build(uint8_t* out,
+                          const uint8_t selfId[DEVICE_UID_LEN],
+                          const uint8_t* nonce, size_t nonceLen,
+                          uint32_t tapCount,
+                          const LinkRecordV1* links, uint16_t linkCount) {
+    if (nonceLen > SIGN_NONCE_MAX_LEN) nonceLen = SIGN_NONCE_MAX_LEN;
+    if (linkCount > PersistPayloadV1::MAX_LINKS) linkCount = PersistPayloadV1::MAX_LINKS;
+
+    size_t pos = 0;
+
+    // selfId
+    memcpy(out + pos, selfId, DEVICE_UID_LEN);
+    pos += DEVICE_UID_LEN;
+
+    // nonce
+    memcpy(out + pos, nonce, nonceLen);
+    pos += nonceLen;
+
+    // totalTapCount (little-endian)
+    out[pos++] = (uint8_t)(tapCount & 0xFF);
+    out[pos++] = (uint8_t)((tapCount >> 8) & 0xFF);
+    out[pos++] = (uint8_t)((tapCount >> 16) & 0xFF);
+    out[pos++] = (uint8_t)((tapCount >> 24) & 0xFF);
+
+    // linkCount (little-endian, 2 bytes)
+    out[pos++] = (uint8_t)(linkCount & 0xFF);
+    out[pos++] = (uint8_t)((linkCount >> 8) & 0xFF);
+
+    // links peerId (records are packed 12-byte arrays)
+    memcpy(out + pos, links, (size_t)linkCount * DEVICE_UID_LEN);
+    pos += (size_t)linkCount * DEVICE_UID_LEN;
+
+    return pos;
+}
+
+size_t sync_header_build(uint8_t* out,
+                         const uint8_t selfId[DEVICE_UID_LEN],
+                         const uint8_t* nonce, size_t nonceLen,
+                         uint32_t tapCount, uint16_t linkCount, uint16_t since,
+                         uint32_t linkGeneration) {
+    if (nonceLen > SIGN_NONCE_MAX_LEN) nonceLen = SIGN_NONCE_MAX_LEN;
+
+    size_t pos = 0;
+    memcpy(out + pos, "SYNC", 4);
+    pos += 4;
+
+    memcpy(out + pos, selfId, DEVICE_UID_LEN);
+    pos += DEVICE_UID_LEN;
+
+    memcpy(out + pos, nonce, nonceLen);
+    pos += nonceLen;
+
+    out[pos++] = (uint8_t)(tapCount & 0xFF);
+    out[pos++] = (uint8_t)((tapCount >> 8) & 0xFF);
+    out[pos++] = (uint8_t)((tapCount >> 16) & 0xFF);
+    out[pos++] = (uint8_t)((tapCount >> 24) & 0xFF);
+
+    out[pos++] = (uint8_t)(linkCount & 0xFF);
+    out[pos++] = (uint8_t)((linkCount >> 8) & 0xFF);
+
+    out[pos++] = (uint8_t)(since & 0xFF);
+    out[pos++] = (uint8_t)((since >> 8) & 0xFF);
+
+    out[pos++] = (uint8_t)(linkGeneration & 0xFF);
+    out[pos++] = (uint8_t)((linkGeneration >> 8) & 0xFF);
+    out[pos++] = (uint8_t)((linkGeneration >> 16) & 0xFF);
+    out[pos++] = (uint8_t)((linkGeneration >> 24) & 0xFF);
+
+    return pos;
+}
+
+size_t dump_format_item(char* out, const uint8_t peerId[DEVICE_UID_LEN]) {
+    static const char PREFIX[] = "{\"peer\":\"";
+    const size_t prefixLen = sizeof(PREFIX) - 1;
+
+    memcpy(out, PREFIX, prefixLen);
+    hex_encode(peerId, DEVICE_UID_LEN, out + prefixLen);
+    size_t pos = prefixLen + DEVICE_UID_HEX_LEN;
+    out[pos++] = '"';
+    out[pos++] = '}';
+    out[pos] = '\0';
+    return pos;
+}
+
+// =====================================================
+// Compressed Link Export
+// =====================================================
+
+static_assert(PersistPayloadV1::MAX_LINKS < 128, "LINK_EXPORT_MAX_LEN assumes one-byte indexes");
+
+// Append v as an unsigned LEB128 varint; false if it does not fit
+static bool putVarint(uint8_t* out, size_t cap, size_t& pos, uint32_t v) {
+    do {
+        if (pos >= cap) return false;
+        out[pos++] = (uint8_t)(v >= 0x80 ? (v | 0x80) : v);
+        v >>= 7;
+    } while (v != 0);
+    return true;
+}
+
+size_t link_export_encode(const LinkRecordV1* links, uint16_t count, uint8_t* out, size_t cap) {
+    if (count > PersistPayloadV1::MAX_LINKS) count = PersistPayloadV1::MAX_LINKS;
+
+    // Insertion sort of indexes: at most 64 entries
+    uint8_t order[PersistPayloadV1::MAX_LINKS];
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t j = i;
+        while (j > 0 && memcmp(links[order[j - 1]].peerId, links[i].peerId, DEVICE_UID_LEN) > 0) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = (uint8_t)i;
+    }
+
+    if (cap < 1) return 0;
+    size_t pos = 0;
+    out[pos++] = LINK_EXPORT_VERSION;
+    if (!putVarint(out, cap, pos, count)) return 0;
+
+    static const uint8_t ZERO_UID[DEVICE_UID_LEN] = {};
+    const uint8_t* prev = ZERO_UID;
+    for (uint16_t i = 0; i < count; i++) {
+        const uint8_t* uid = links[order[i]].peerId;
+        size_t shared = 0;
+        while (shared < DEVICE_UID_LEN && uid[shared] == prev[shared]) {
+            shared++;
+        }
+        size_t suffix = DEVICE_UID_LEN - shared;
+        if (!putVarint(out, cap, pos, (uint32_t)suffix) || pos + suffix > cap) return 0;
+        memcpy(out + pos, uid + shared, suffix);
+        pos += suffix;
+        prev = uid;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        if (!putVarint(out, cap, pos, order[i])) return 0;
+    }
+    return pos;
+}
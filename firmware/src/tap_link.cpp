@@ -1,6 +1,15 @@
 #include "tap_link.h"
+#include "debug_log.h"
+#include "uid_codec.h"
+#include "platform_ramfunc.h"
 #include <string.h>
 
+// Virtual calls, for a HAL without direct entry points
+static bool virtualReadLine(IOneWireHal* hal) { return hal->readLine(); }
+static void virtualDriveLow(IOneWireHal* hal, bool enableLow) { hal->driveLow(enableLow); }
+static uint32_t virtualMicros(IOneWireHal* hal) { return hal->micros(); }
+static void virtualDelayMicros(IOneWireHal* hal, uint32_t us) { hal->delayMicros(us); }
+
 TapLink::TapLink(IOneWireHal* hal)
     : _hal(hal)
     , _roleKnown(false)
@@ -15,15 +24,20 @@ TapLink::TapLink(IOneWireHal* hal)
     , _lastPulseTime(0)
     , _isPulsing(false)
     , _pulseStartTime(0)
+    , _lowPower(false)
     , _negotiationBitIndex(0)
     , _bitSlotStartTime(0)
     , _waitingForSync(false)
     , _syncSent(false)
+    , _peerIdKnown(false)
     , _randomSeed(0)
+    , _peerSkewPpm(0)
+    , _peerScaleQ16(65536)
     , _peerReady(false)
     , _lastCommandTime(0)
     , _commandFailures(0)
     , _idExchangeComplete(false)
+    , _idSent(false)
 #else
     , _state(DetectionState::Sleeping)
     , _stateStartTime(0)
@@ -33,18 +47,25 @@ TapLink::TapLink(IOneWireHal* hal)
     , _wasConnected(false)
 #endif
 {
+    if (!_hal->getOps(&_ops)) {
+        _ops = { virtualReadLine, virtualDriveLow, virtualMicros, virtualDelayMicros };
+    }
+
     // Get our device UID for negotiation
     getDeviceUidRaw(_selfId);
 
 #ifdef EVAL_BOARD_TEST
     // Initialize with current line state for continuous monitoring
-    _lastLineState = _hal->readLine();
-    _lastLineChangeTime = _hal->micros();
-    _lastPulseTime = _hal->micros();
-
-    // Initialize random seed from UID and micros for tie-breaker
-    _randomSeed = _hal->micros();
-    for (int i = 0; i < DEVICE_UID_LEN; i++) {
+    _lastLineState = halReadLine();
+    _lastLineChangeTime = halMicros();
+    _lastPulseTime = halMicros();
+    memset(_peerId, 0, DEVICE_UID_LEN);
+    memcpy(_nextSelfId, _selfId, DEVICE_UID_LEN);
+    _replyId.len = 0;
+
+    // Initialize random seed from UID and time
+    _randomSeed = halMicros();
+    for (size_t i = 0; i < DEVICE_UID_LEN; i++) {
         _randomSeed ^= (_selfId[i] << (i % 4) * 8);
     }
 #endif
@@ -52,7 +73,7 @@ TapLink::TapLink(IOneWireHal* hal)
 }
 
 void TapLink::poll() {
-    uint32_t now = _hal->micros();
+    uint32_t now = halMicros();
 
 #ifdef EVAL_BOARD_TEST
     // EVAL BOARD MODE: Continuous monitoring with presence pulses
@@ -62,16 +83,18 @@ void TapLink::poll() {
         uint32_t pulseElapsed = elapsedMicros(_pulseStartTime);
         if (pulseElapsed >= PRESENCE_PULSE_US) {
             // Pulse complete, release line
-            _hal->driveLow(false);
+            halDriveLow(false);
             _isPulsing = false;
             _lastPulseTime = now;
+        } else {
+            _hal->deadlineHint(PRESENCE_PULSE_US - pulseElapsed);
         }
         // While pulsing, we can't detect (we're driving the line ourselves)
         return;
     }
 
     // Read line state
-    bool lineState = _hal->readLine();
+    bool lineState = halReadLine();
 
     // Detect line state changes for connection detection
     if (lineState != _lastLineState) {
@@ -88,9 +111,12 @@ void TapLink::poll() {
                 _stateStartTime = now;
             } else {
                 // Send periodic presence pulses when not connected
+                uint32_t interval = presenceIntervalUs();
                 uint32_t sincePulse = elapsedMicros(_lastPulseTime);
-                if (sincePulse >= PULSE_INTERVAL_US) {
+                if (sincePulse >= interval) {
                     sendPresencePulse();
+                } else {
+                    _hal->deadlineHint(interval - sincePulse);
                 }
             }
             break;
@@ -101,14 +127,17 @@ void TapLink::poll() {
                 // Line went back HIGH - was just a pulse, that's good!
                 // This means peer is present - start negotiation
                 _connectionJustDetected = true;
-                startNegotiation();
+                startNegotiation(false);
             } else {
                 // Line is still LOW, check debounce time
                 uint32_t elapsed = elapsedMicros(_stateStartTime);
                 if (elapsed >= DEBOUNCE_TIME_US) {
-                    // Line stayed LOW for a while - peer is connected and holding
+                    // Line stayed LOW for a while - the peer saw our presence
+                    // pulse and this is its first sync pulse
                     _connectionJustDetected = true;
-                    startNegotiation();
+                    startNegotiation(true);
+                } else {
+                    _hal->deadlineHint(DEBOUNCE_TIME_US - elapsed);
                 }
             }
             break;
@@ -116,6 +145,7 @@ void TapLink::poll() {
         case DetectionState::Negotiating:
             // Handle bit-by-bit UID negotiation
             pollNegotiation();
+            finishNegotiation();
             break;
 
         case DetectionState::Connected:
@@ -124,6 +154,18 @@ void TapLink::poll() {
             // Slave listens for commands and responds.
             // Disconnect is detected via command timeout, not presence pulses.
             
+            // Master: the line is ours between commands. Once our first
+            // command has gone unanswered, a low line here is a V1 peer that
+            // lost arbitration and still took master on its UID sum parity
+            // (its last arbitration bits are over by then); let it have the role.
+            if (_roleKnown && _isMaster && !_peerReady && _commandFailures > 0 && !lineState) {
+                DEBUG_LOG("tap: peer is master too, yielding");
+                _isMaster = false;
+                _lastCommandTime = now;
+                prepareSlaveReplies();
+                break;
+            }
+
             // Slave: Check for idle timeout (no commands received)
             if (_roleKnown && !_isMaster) {
                 uint32_t sinceLastCommand = elapsedMicros(_lastCommandTime);
@@ -133,6 +175,8 @@ void TapLink::poll() {
                     _roleKnown = false;
                     _peerReady = false;
                     _lastPulseTime = now;  // Reset pulse timer for detection phase
+                } else {
+                    _hal->deadlineHint(SLAVE_IDLE_TIMEOUT_US - sinceLastCommand);
                 }
             }
             break;
@@ -187,106 +231,167 @@ void TapLink::poll() {
 }
 
 #ifdef EVAL_BOARD_TEST
+uint32_t TapLink::idleBudgetUs() {
+    if (_state != DetectionState::NoConnection || _isPulsing || !halReadLine()) {
+        return 0;
+    }
+    uint32_t interval = presenceIntervalUs();
+    uint32_t sincePulse = elapsedMicros(_lastPulseTime);
+    return sincePulse >= interval ? 0 : interval - sincePulse;
+}
+
+void TapLink::notePeerEdge() {
+    // Same as seeing the line low in poll(): Detecting goes on to
+    // negotiate once the line is released, or debounces a long low
+    if (_state == DetectionState::NoConnection && !_isPulsing) {
+        _state = DetectionState::Detecting;
+        _stateStartTime = halMicros();
+    }
+}
+
 void TapLink::sendPresencePulse() {
     // Send a brief LOW pulse to signal our presence
     // Other device will detect this and know we're connected
-    _hal->driveLow(true);
+    halDriveLow(true);
     _isPulsing = true;
-    _pulseStartTime = _hal->micros();
+    _pulseStartTime = halMicros();
     // Pulse will be released in poll() after PRESENCE_PULSE_US
 }
 
-void TapLink::startNegotiation() {
+void TapLink::startNegotiation(bool peerSyncSeen) {
+    // The responder (it saw our presence pulse) sends the first sync
+    // pulse; we, the initiator, entered here while it was on the wire.
+    // Both sides then start their second sync pulse 5ms after the
+    // initiator's first one ends, so they overlap. The initiator holds
+    // its second pulse SYNC_EXTEND_US longer: a responder that still
+    // sees the line low afterwards knows the pulses overlapped. Firmware
+    // before this waited for a further peer pulse here, which as the
+    // initiator is the responder's second one; a responder that does
+    // not see the overlap waits for that late pulse instead.
+    memcpy(_selfId, _nextSelfId, DEVICE_UID_LEN);
     _state = DetectionState::Negotiating;
     _negotiationBitIndex = 0;
     _roleKnown = false;
     _isMaster = false;
+    _peerIdKnown = false;
+    _peerSkewPpm = 0;
+    _peerScaleQ16 = 65536;
 
     // Release line and wait for HIGH
-    _hal->driveLow(false);
-    uint32_t waitStart = _hal->micros();
-    while (!_hal->readLine()) {
+    halDriveLow(false);
+    uint32_t waitStart = halMicros();
+    while (!halReadLine()) {
         if (elapsedMicros(waitStart) > 100000) break;
     }
-    _hal->delayMicros(1000);
+    halDelayMicros(1000);
 
     // First sync pulse
-    _hal->driveLow(true);
-    _hal->delayMicros(SYNC_PULSE_US);
-    _hal->driveLow(false);
+    halDriveLow(true);
+    halDelayMicros(SYNC_PULSE_US);
+    halDriveLow(false);
 
     // Wait for line HIGH
-    waitStart = _hal->micros();
-    while (!_hal->readLine()) {
+    waitStart = halMicros();
+    while (!halReadLine()) {
         if (elapsedMicros(waitStart) > 20000) break;
     }
 
-    // Wait for peer's sync pulse
-    waitStart = _hal->micros();
+    // Wait for peer's sync pulse (the initiator has seen it already)
+    waitStart = halMicros();
     bool sawPeerSync = false;
-    while (elapsedMicros(waitStart) < 50000) {
-        if (!_hal->readLine()) {
+    while (!peerSyncSeen && elapsedMicros(waitStart) < 50000) {
+        if (!halReadLine()) {
             sawPeerSync = true;
             break;
         }
     }
 
     if (sawPeerSync) {
-        waitStart = _hal->micros();
-        while (!_hal->readLine()) {
+        waitStart = halMicros();
+        while (!halReadLine()) {
             if (elapsedMicros(waitStart) > 20000) break;
         }
+
+        // The peer timed its pulse with its own clock, so the width we
+        // measure gives the skew between the two oscillators
+        int32_t widthUs = (int32_t)elapsedMicros(waitStart);
+        int32_t skewPpm = (int32_t)((int64_t)(widthUs - (int32_t)SYNC_PULSE_US) * 1000000 / (int32_t)SYNC_PULSE_US);
+        if (skewPpm > -MAX_PEER_SKEW_PPM && skewPpm < MAX_PEER_SKEW_PPM) {
+            _peerSkewPpm = skewPpm;
+        }
     }
 
     // Second sync pulse
-    _hal->delayMicros(SYNC_WAIT_US);
-    _hal->driveLow(true);
-    _hal->delayMicros(SYNC_PULSE_US);
-    _hal->driveLow(false);
+    halDelayMicros(SYNC_WAIT_US);
+    halDriveLow(true);
+    halDelayMicros(peerSyncSeen ? SYNC_PULSE_US + SYNC_EXTEND_US : SYNC_PULSE_US);
+    halDriveLow(false);
+
+    // Still LOW: an initiator's longer pulse overlaps ours
+    bool overlapped = !halReadLine();
 
     // Final alignment delay
-    waitStart = _hal->micros();
-    while (!_hal->readLine()) {
+    waitStart = halMicros();
+    while (!halReadLine()) {
         if (elapsedMicros(waitStart) > 20000) break;
     }
-    _hal->delayMicros(SYNC_WAIT_US);
 
-    _bitSlotStartTime = _hal->micros();
+    if (!peerSyncSeen && !overlapped) {
+        // Older initiator: its second pulse follows ours by SYNC_WAIT_US
+        waitStart = halMicros();
+        while (halReadLine()) {
+            if (elapsedMicros(waitStart) > SYNC_WAIT_US + LATE_SYNC_MARGIN_US) break;
+        }
+        waitStart = halMicros();
+        while (!halReadLine()) {
+            if (elapsedMicros(waitStart) > 20000) break;
+        }
+    }
+    halDelayMicros(SYNC_WAIT_US);
+
+    // Each side moves half way towards the other's clock. An initiator
+    // measures nothing, so after an overlap the responder goes all the way.
+    int32_t scaleDiv = overlapped ? 1000000 : 2000000;
+    _peerScaleQ16 = (uint32_t)(65536 + (int64_t)_peerSkewPpm * 65536 / scaleDiv);
+
+    _bitSlotStartTime = halMicros();
     _waitingForSync = false;
     _syncSent = true;
 }
 
-void TapLink::pollNegotiation() {
+PLATFORM_RAMFUNC void TapLink::pollNegotiation() {
+    // V1 arbitration, as cards in the field run it: the first 32 UID
+    // bits, MSB first, '0' dominant (drive LOW). Whoever releases for a
+    // '1' and sees LOW has the higher UID and stops at once as master.
+    // The other side cannot see that bit under its own drive, so it
+    // runs all 32 bits and then the tie-breaker below.
     while (_negotiationBitIndex < NEGOTIATION_BITS && !_roleKnown) {
         // Get my bit for this position
         uint8_t byteIdx = _negotiationBitIndex / 8;
         uint8_t bitIdx = 7 - (_negotiationBitIndex % 8);  // MSB first
         bool myBit = (_selfId[byteIdx] >> bitIdx) & 1;
 
-        if (!myBit) {
-            _hal->driveLow(true);   // Send '0' by driving low
-        } else {
-            _hal->driveLow(false);  // Send '1' by releasing (high)
-        }
+        // Send '0' by driving low, '1' by releasing (high)
+        halDriveLow(!myBit);
 
         // Wait until sample point
-        _hal->delayMicros(BIT_SAMPLE_US);
+        halDelayMicros(peerUs(BIT_SAMPLE_US));
 
         // Sample the line multiple times
-        bool sample1 = _hal->readLine();
-        _hal->delayMicros(100);
-        bool sample2 = _hal->readLine();
-        _hal->delayMicros(100);
-        bool sample3 = _hal->readLine();
+        bool sample1 = halReadLine();
+        halDelayMicros(100);
+        bool sample2 = halReadLine();
+        halDelayMicros(100);
+        bool sample3 = halReadLine();
 
         // Use majority voting
         int lowCount = (!sample1 ? 1 : 0) + (!sample2 ? 1 : 0) + (!sample3 ? 1 : 0);
         bool lineIsLow = (lowCount >= 2);
 
         // Continue driving until end of drive period
-        _hal->delayMicros(BIT_DRIVE_US - BIT_SAMPLE_US - 200);
+        halDelayMicros(peerUs(BIT_DRIVE_US - BIT_SAMPLE_US - 200));
 
-        _hal->driveLow(false);
+        halDriveLow(false);
 
         if (myBit && lineIsLow) {
             // Higher UID wins master role
@@ -294,67 +399,63 @@ void TapLink::pollNegotiation() {
             _roleKnown = true;
         }
 
-        _hal->delayMicros(BIT_RECOVERY_US);
+        halDelayMicros(peerUs(BIT_RECOVERY_US));
 
         _negotiationBitIndex++;
     }
 
-    // Negotiation complete
     if (!_roleKnown) {
-        // All 32 bits compared equal (extremely unlikely with STM32 UIDs)
-        // Use random tie-breaker with same protocol
+        // Either the peer won (and has gone quiet) or all 32 bits were
+        // equal, e.g. two cards from one wafer. Exchange a random bit the
+        // way V1 does; only our '1' against the peer's '0' makes us master.
+        // V1 breaks what is still tied by UID sum parity, which can leave
+        // both sides master; a quiet winner looks just the same, so we take
+        // the slave role instead.
         _randomSeed = _randomSeed * 1103515245 + 12345;  // LCG random
         bool myTieBreaker = (_randomSeed >> 16) & 1;
 
-        // Exchange tie-breaker bit
-        if (!myTieBreaker) {
-            _hal->driveLow(true);   // Send '0'
-        } else {
-            _hal->driveLow(false);  // Send '1'
-        }
-
-        _hal->delayMicros(BIT_SAMPLE_US);
-        bool peerTieBreaker = _hal->readLine();  // HIGH means peer sent '1'
-        _hal->delayMicros(BIT_DRIVE_US - BIT_SAMPLE_US);
-        _hal->driveLow(false);
+        halDriveLow(!myTieBreaker);
+        halDelayMicros(peerUs(BIT_SAMPLE_US));
+        bool peerTieBreaker = halReadLine();  // HIGH means peer sent '1' (or nothing)
+        halDelayMicros(peerUs(BIT_DRIVE_US - BIT_SAMPLE_US));
+        halDriveLow(false);
 
-        if (myTieBreaker && !peerTieBreaker) {
-            _isMaster = true;
-        } else if (!myTieBreaker && peerTieBreaker) {
-            _isMaster = false;
-        } else {
-            // Still tied - use UID sum as final fallback
-            uint32_t sum = 0;
-            for (int i = 0; i < DEVICE_UID_LEN; i++) {
-                sum += _selfId[i];
-            }
-            _isMaster = (sum & 1);  // Odd sum = master
-        }
+        _isMaster = myTieBreaker && !peerTieBreaker;
         _roleKnown = true;
     }
+}
+
+// Outside the RAM function: logging and the slave's replies are flash code
+void TapLink::finishNegotiation() {
+    DEBUG_LOG("tap: negotiated master=%u skew=%dppm", _isMaster, _peerSkewPpm);
 
     _state = DetectionState::Connected;
     _negotiationJustCompleted = true;
-    _lastPulseTime = _hal->micros();
-    _lastCommandTime = _hal->micros();
+    _lastPulseTime = halMicros();
+    _lastCommandTime = halMicros();
     _commandFailures = 0;
     _idExchangeComplete = false;
+    _idSent = false;
+
+    if (!_isMaster) {
+        prepareSlaveReplies();
+    }
 }
 
 bool TapLink::sendBit(bool bit) {
     if (!bit) {
-        _hal->driveLow(true);  // Drive low for '0'
-        _hal->delayMicros(BIT_DRIVE_US);
-        _hal->driveLow(false);
+        halDriveLow(true);  // Drive low for '0'
+        halDelayMicros(BIT_DRIVE_US);
+        halDriveLow(false);
     } else {
-        _hal->driveLow(false); // Release for '1'
-        _hal->delayMicros(BIT_DRIVE_US);
+        halDriveLow(false); // Release for '1'
+        halDelayMicros(BIT_DRIVE_US);
     }
     return true;
 }
 
 bool TapLink::readBit() {
-    return _hal->readLine();  // HIGH = '1', LOW = '0'
+    return halReadLine();  // HIGH = '1', LOW = '0'
 }
 
 bool TapLink::isConnectionDetected() {
@@ -381,22 +482,30 @@ void TapLink::reset() {
     _roleKnown = false;
     _isMaster = false;
     _negotiationBitIndex = 0;
+    _peerIdKnown = false;
     _peerReady = false;
     _lastCommandTime = 0;
     _commandFailures = 0;
     _idExchangeComplete = false;
-    _hal->driveLow(false);  // Make sure line is released
+    _idSent = false;
+    halDriveLow(false);  // Make sure line is released
 }
 
-void TapLink::sendStartPulse() {
-    _hal->driveLow(true);
-    _hal->delayMicros(CMD_START_PULSE_US);
-    _hal->driveLow(false);
+PLATFORM_RAMFUNC void TapLink::sendStartPulse() {
+    halDriveLow(true);
+    halDelayMicros(CMD_START_PULSE_US);
+    halDriveLow(false);
 }
 
-bool TapLink::waitForLineHigh(uint32_t timeoutUs) {
-    uint32_t startTime = _hal->micros();
-    while (!_hal->readLine()) {
+PLATFORM_RAMFUNC uint32_t TapLink::peerUs(uint32_t us) const {
+    // Each side moves half way towards the other's clock, so the two
+    // bit grids line up without either card knowing which is accurate
+    return (us * _peerScaleQ16) >> 16;
+}
+
+PLATFORM_RAMFUNC bool TapLink::waitForLineHigh(uint32_t timeoutUs) {
+    uint32_t startTime = halMicros();
+    while (!halReadLine()) {
         if (elapsedMicros(startTime) > timeoutUs) {
             return false;
         }
@@ -404,39 +513,39 @@ bool TapLink::waitForLineHigh(uint32_t timeoutUs) {
     return true;
 }
 
-void TapLink::sendByte(uint8_t byte) {
+PLATFORM_RAMFUNC void TapLink::sendByte(uint8_t byte) {
     // Send 8 bits, MSB first
     for (int i = 7; i >= 0; i--) {
         bool bit = (byte >> i) & 1;
         if (!bit) {
-            _hal->driveLow(true);   // Send '0' by driving LOW
+            halDriveLow(true);   // Send '0' by driving LOW
         } else {
-            _hal->driveLow(false);  // Send '1' by releasing (HIGH via pull-up)
+            halDriveLow(false);  // Send '1' by releasing (HIGH via pull-up)
         }
-        _hal->delayMicros(CMD_BIT_DRIVE_US);
-        _hal->driveLow(false);  // Release line
-        _hal->delayMicros(CMD_BIT_RECOVERY_US);
+        halDelayMicros(peerUs(CMD_BIT_DRIVE_US));
+        halDriveLow(false);  // Release line
+        halDelayMicros(peerUs(CMD_BIT_RECOVERY_US));
     }
 }
 
-bool TapLink::receiveByte(uint8_t* byte, uint32_t timeoutUs) {
+PLATFORM_RAMFUNC bool TapLink::receiveByte(uint8_t* byte, uint32_t timeoutUs) {
     uint8_t result = 0;
     
     for (int i = 7; i >= 0; i--) {
-        _hal->delayMicros(CMD_BIT_SAMPLE_US);
+        halDelayMicros(peerUs(CMD_BIT_SAMPLE_US));
         
-        bool sample1 = _hal->readLine();
-        _hal->delayMicros(100);
-        bool sample2 = _hal->readLine();
-        _hal->delayMicros(100);
-        bool sample3 = _hal->readLine();
+        bool sample1 = halReadLine();
+        halDelayMicros(100);
+        bool sample2 = halReadLine();
+        halDelayMicros(100);
+        bool sample3 = halReadLine();
         
         int highCount = (sample1 ? 1 : 0) + (sample2 ? 1 : 0) + (sample3 ? 1 : 0);
         bool bit = (highCount >= 2);
         
         result |= (bit ? 1 : 0) << i;
         
-        _hal->delayMicros(CMD_BIT_DRIVE_US - CMD_BIT_SAMPLE_US - 200 + CMD_BIT_RECOVERY_US);
+        halDelayMicros(peerUs(CMD_BIT_DRIVE_US - CMD_BIT_SAMPLE_US - 200 + CMD_BIT_RECOVERY_US));
     }
     
     *byte = result;
@@ -448,18 +557,14 @@ TapResponse TapLink::masterSendCommand(TapCommand cmd) {
     if (_state != DetectionState::Connected) return TapResponse::NONE;
     
     sendStartPulse();
-    _hal->delayMicros(CMD_TURNAROUND_US);
+    halDelayMicros(CMD_TURNAROUND_US);
     sendByte(static_cast<uint8_t>(cmd));
-    _hal->delayMicros(CMD_TURNAROUND_US);
+    halDelayMicros(CMD_TURNAROUND_US);
     
     uint8_t response;
     if (!receiveByte(&response, CMD_TIMEOUT_US)) {
-        _commandFailures++;
-        if (_commandFailures >= MAX_COMMAND_FAILURES) {
-            _state = DetectionState::NoConnection;
-            _roleKnown = false;
-            _peerReady = false;
-        }
+        DEBUG_LOG("tap: cmd 0x%02x no response (%u)", cmd, _commandFailures + 1);
+        commandFailed();
         return TapResponse::NONE;
     }
     
@@ -467,12 +572,8 @@ TapResponse TapLink::masterSendCommand(TapCommand cmd) {
                           response == static_cast<uint8_t>(TapResponse::NAK));
     
     if (!validResponse) {
-        _commandFailures++;
-        if (_commandFailures >= MAX_COMMAND_FAILURES) {
-            _state = DetectionState::NoConnection;
-            _roleKnown = false;
-            _peerReady = false;
-        }
+        DEBUG_LOG("tap: cmd 0x%02x bad response 0x%02x (%u)", cmd, response, _commandFailures + 1);
+        commandFailed();
         return TapResponse::NONE;
     }
     
@@ -483,16 +584,27 @@ TapResponse TapLink::masterSendCommand(TapCommand cmd) {
         _peerReady = (response == static_cast<uint8_t>(TapResponse::ACK));
     }
     
-    _lastCommandTime = _hal->micros();
+    _lastCommandTime = halMicros();
     return static_cast<TapResponse>(response);
 }
 
+void TapLink::commandFailed() {
+    // Shared by every master command, REQUEST_ID included: a slave that
+    // stopped answering mid-exchange must still drop the connection
+    _commandFailures++;
+    if (_commandFailures >= MAX_COMMAND_FAILURES) {
+        _state = DetectionState::NoConnection;
+        _roleKnown = false;
+        _peerReady = false;
+    }
+}
+
 bool TapLink::slaveHasCommand() {
     if (!_roleKnown || _isMaster) return false;
     if (_state != DetectionState::Connected) return false;
     
     // Check if line is LOW (potential START pulse)
-    return !_hal->readLine();
+    return !halReadLine();
 }
 
 TapCommand TapLink::slaveReceiveCommand() {
@@ -500,9 +612,9 @@ TapCommand TapLink::slaveReceiveCommand() {
     if (_state != DetectionState::Connected) return TapCommand::NONE;
     
     // Measure how long line has been LOW (to distinguish from presence pulse)
-    uint32_t startTime = _hal->micros();
+    uint32_t startTime = halMicros();
     
-    while (!_hal->readLine()) {
+    while (!halReadLine()) {
         if (elapsedMicros(startTime) > CMD_TIMEOUT_US) {
             return TapCommand::NONE;
         }
@@ -516,14 +628,14 @@ TapCommand TapLink::slaveReceiveCommand() {
         return TapCommand::NONE;
     }
     
-    _hal->delayMicros(CMD_TURNAROUND_US);
+    halDelayMicros(CMD_TURNAROUND_US);
     
     uint8_t cmd;
     if (!receiveByte(&cmd, CMD_TIMEOUT_US)) {
         return TapCommand::NONE;
     }
     
-    _lastCommandTime = _hal->micros();
+    _lastCommandTime = halMicros();
     
     return static_cast<TapCommand>(cmd);
 }
@@ -532,10 +644,71 @@ void TapLink::slaveSendResponse(TapResponse response) {
     if (!_roleKnown || _isMaster) return;
     if (_state != DetectionState::Connected) return;
     
-    _hal->delayMicros(CMD_TURNAROUND_US);
+    halDelayMicros(CMD_TURNAROUND_US);
     sendByte(static_cast<uint8_t>(response));
 }
 
+void TapLink::prepareSlaveReplies() {
+    _replyId.bytes[0] = static_cast<uint8_t>(TapResponse::ACK);
+    memcpy(_replyId.bytes + 1, _selfId, DEVICE_UID_LEN);
+    _replyId.len = 1 + DEVICE_UID_LEN;
+}
+
+const TapLink::SlaveReply& TapLink::slaveReplyFor(TapCommand cmd) const {
+    static const SlaveReply ACK_REPLY = { 1, { static_cast<uint8_t>(TapResponse::ACK) } };
+    static const SlaveReply NAK_REPLY = { 1, { static_cast<uint8_t>(TapResponse::NAK) } };
+    switch (cmd) {
+        case TapCommand::CHECK_READY:        return ACK_REPLY;
+        case TapCommand::REQUEST_ID:         return _replyId;
+        default:                             return NAK_REPLY;
+    }
+}
+
+void TapLink::sendSlaveReply(TapCommand cmd) {
+    const SlaveReply& reply = slaveReplyFor(cmd);
+    halDelayMicros(CMD_REPLY_TURNAROUND_US);
+    sendBytes(reply.bytes, reply.len);
+    _lastCommandTime = halMicros();
+
+    if (cmd == TapCommand::REQUEST_ID) {
+        _idSent = true;
+        _idExchangeComplete = _peerIdKnown;
+    }
+}
+
+void TapLink::slaveReceiveId() {
+    // SEND_ID: the master's 12 raw UID bytes follow the command byte.
+    // If the master has not asked for our UID yet (current firmware
+    // sends SEND_ID first), it rides on the ACK as a uid_codec frame
+    // against the master's UID; a V1 master asks with REQUEST_ID
+    // before SEND_ID, so it never sees the extra bytes.
+    receiveBytes(_peerId, DEVICE_UID_LEN);
+    _peerIdKnown = true;
+
+    uint8_t reply[1 + UID_COMPACT_MAX_LEN];
+    size_t len = 1;
+    reply[0] = static_cast<uint8_t>(TapResponse::ACK);
+    if (!_idSent) {
+        len += uid_compact_encode(_selfId, _peerId, reply + 1);
+    }
+    halDelayMicros(CMD_REPLY_TURNAROUND_US);
+    sendBytes(reply, len);
+    _lastCommandTime = halMicros();
+
+    _idSent = true;
+    _idExchangeComplete = true;
+}
+
+TapCommand TapLink::slaveServeCommand() {
+    TapCommand cmd = slaveReceiveCommand();
+    if (cmd == TapCommand::SEND_ID) {
+        slaveReceiveId();
+    } else if (cmd != TapCommand::NONE) {
+        sendSlaveReply(cmd);
+    }
+    return cmd;
+}
+
 void TapLink::sendBytes(const uint8_t* data, size_t len) {
     for (size_t i = 0; i < len; i++) {
         sendByte(data[i]);
@@ -555,85 +728,94 @@ bool TapLink::masterRequestId(uint8_t peerIdOut[DEVICE_UID_LEN]) {
     if (!_roleKnown || !_isMaster) return false;
     if (_state != DetectionState::Connected) return false;
     
+    uint8_t response;
+
+    // SEND_ID first. A current slave appends its UID to the ACK as a
+    // uid_codec frame against ours, which ends the exchange; a V1 slave
+    // sends nothing more, so the frame header reads as an idle line.
+    if (!_idSent) {
+        sendStartPulse();
+        halDelayMicros(CMD_TURNAROUND_US);
+        sendByte(static_cast<uint8_t>(TapCommand::SEND_ID));
+        sendBytes(_selfId, DEVICE_UID_LEN);
+        halDelayMicros(CMD_TURNAROUND_US);
+
+        if (!receiveByte(&response, CMD_TIMEOUT_US) ||
+            response != static_cast<uint8_t>(TapResponse::ACK)) {
+            commandFailed();
+            return false;
+        }
+        _idSent = true;
+
+        uint8_t frame[UID_COMPACT_MAX_LEN];
+        receiveByte(&frame[0], CMD_TIMEOUT_US);
+        if (frame[0] != LINE_IDLE_BYTE) {
+            size_t bodyLen = uid_compact_body_len(frame[0]);
+            if (bodyLen > DEVICE_UID_LEN ||
+                !receiveBytes(frame + 1, bodyLen) ||
+                !uid_compact_decode(frame, 1 + bodyLen, _selfId, peerIdOut)) {
+                // Ask again with REQUEST_ID next time
+                commandFailed();
+                DEBUG_LOG("tap: bad compact id frame 0x%02x", frame[0]);
+                return false;
+            }
+
+            _commandFailures = 0;
+            _lastCommandTime = halMicros();
+            _idExchangeComplete = true;
+            return true;
+        }
+
+        // V1 slave: it stores the link before it polls the line again
+        halDelayMicros(SEND_ID_SETTLE_US);
+    }
+
     sendStartPulse();
-    _hal->delayMicros(CMD_TURNAROUND_US);
+    halDelayMicros(CMD_TURNAROUND_US);
     sendByte(static_cast<uint8_t>(TapCommand::REQUEST_ID));
-    _hal->delayMicros(CMD_TURNAROUND_US);
+    halDelayMicros(CMD_TURNAROUND_US);
     
-    uint8_t response;
     if (!receiveByte(&response, CMD_TIMEOUT_US)) {
-        _commandFailures++;
+        commandFailed();
         return false;
     }
     
     if (response != static_cast<uint8_t>(TapResponse::ACK)) {
-        _commandFailures++;
+        commandFailed();
         return false;
     }
     
     if (!receiveBytes(peerIdOut, DEVICE_UID_LEN)) {
-        _commandFailures++;
-        return false;
-    }
-    
-    _commandFailures = 0;
-    _lastCommandTime = _hal->micros();
-    return true;
-}
-
-bool TapLink::masterSendId() {
-    if (!_roleKnown || !_isMaster) return false;
-    if (_state != DetectionState::Connected) return false;
-    
-    sendStartPulse();
-    _hal->delayMicros(CMD_TURNAROUND_US);
-    sendByte(static_cast<uint8_t>(TapCommand::SEND_ID));
-    sendBytes(_selfId, DEVICE_UID_LEN);
-    _hal->delayMicros(CMD_TURNAROUND_US);
-    
-    uint8_t response;
-    if (!receiveByte(&response, CMD_TIMEOUT_US)) {
-        _commandFailures++;
-        return false;
-    }
-    
-    if (response != static_cast<uint8_t>(TapResponse::ACK)) {
-        _commandFailures++;
+        commandFailed();
         return false;
     }
     
     _commandFailures = 0;
-    _lastCommandTime = _hal->micros();
+    _lastCommandTime = halMicros();
     _idExchangeComplete = true;
     return true;
 }
 
-void TapLink::slaveHandleRequestId() {
+void TapLink::slaveHandleRequestId(TapCommand cmd) {
     if (!_roleKnown || _isMaster) return;
     if (_state != DetectionState::Connected) return;
     
-    _hal->delayMicros(CMD_TURNAROUND_US);
-    sendByte(static_cast<uint8_t>(TapResponse::ACK));
-    sendBytes(_selfId, DEVICE_UID_LEN);
-    _lastCommandTime = _hal->micros();
+    sendSlaveReply(cmd);
 }
 
-bool TapLink::slaveHandleSendId(uint8_t peerIdOut[DEVICE_UID_LEN]) {
-    if (!_roleKnown || _isMaster) return false;
-    if (_state != DetectionState::Connected) return false;
-    
-    if (!receiveBytes(peerIdOut, DEVICE_UID_LEN)) {
-        _hal->delayMicros(CMD_TURNAROUND_US);
-        sendByte(static_cast<uint8_t>(TapResponse::NAK));
-        return false;
-    }
-    
-    _hal->delayMicros(CMD_TURNAROUND_US);
-    sendByte(static_cast<uint8_t>(TapResponse::ACK));
-    _lastCommandTime = _hal->micros();
-    _idExchangeComplete = true;
+bool TapLink::getPeerId(uint8_t peerIdOut[DEVICE_UID_LEN]) const {
+    if (!_peerIdKnown) return false;
+    memcpy(peerIdOut, _peerId, DEVICE_UID_LEN);
     return true;
 }
+
+void TapLink::setIdentity(const uint8_t id[DEVICE_UID_LEN]) {
+    if (id) {
+        memcpy(_nextSelfId, id, DEVICE_UID_LEN);
+    } else {
+        getDeviceUidRaw(_nextSelfId);
+    }
+}
 #else
 bool TapLink::isConnectionEstablished() {
     if (_connectionJustEstablished) {
@@ -658,7 +840,7 @@ void TapLink::prepareForSleep() {
 }
 
 void TapLink::handleWakeUp() {
-    _lastWakeTime = _hal->micros();
+    _lastWakeTime = halMicros();
     _state = DetectionState::Waking;
     _stateStartTime = _lastWakeTime;
 }
@@ -674,8 +856,8 @@ bool TapLink::validateConnection() {
     // Read line multiple times to check stability
     bool readings[5];
     for (int i = 0; i < 5; i++) {
-        readings[i] = _hal->readLine();
-        _hal->delayMicros(100);
+        readings[i] = halReadLine();
+        halDelayMicros(100);
     }
 
     // Check if readings are consistent
@@ -690,8 +872,8 @@ bool TapLink::validateConnection() {
 }
 #endif
 
-uint32_t TapLink::elapsedMicros(uint32_t startTime) {
-    uint32_t now = _hal->micros();
+PLATFORM_RAMFUNC uint32_t TapLink::elapsedMicros(uint32_t startTime) {
+    uint32_t now = halMicros();
     if (now >= startTime) {
         return now - startTime;
     } else {
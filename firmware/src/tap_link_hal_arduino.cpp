@@ -2,42 +2,122 @@
 #include "board_config.h"
 #include "platform_timing.h"
 #include "platform_gpio.h"
+#include "platform_ramfunc.h"
+#include "stm32l0xx_hal.h"
+#include <Arduino.h>
 
 // Arduino implementation for 1-wire tap link interface
+//
+// The line primitives are the tap bit engine's inner loop, so they run
+// from RAM (platform_ramfunc.h) and touch registers directly: GPIO MODER
+// switches between input-with-pull-up and output-low, and time comes from
+// the HAL tick plus SysTick->VAL. TapLink calls them through getOps(),
+// whose table it keeps in RAM, not through the vtable (in flash).
 
-class OneWireHalArduino : public IOneWireHal {
+class OneWireHalArduino final : public IOneWireHal {
 private:
     uint32_t _pin;
-    
+    GPIO_TypeDef* _port;
+    uint32_t _mask;
+    uint32_t _moderMask;      // MODER/PUPDR bits for the pin (2 bits)
+    uint32_t _moderOutput;    // MODER value for general purpose output
+    uint32_t _pupdrPullUp;    // PUPDR value for pull-up
+    uint32_t _usPerCountQ16;  // SysTick counts -> us, 16.16 fixed point
+
 public:
-    OneWireHalArduino(uint32_t pin) : _pin(pin) {
-        // Configure pin as input with pull-up initially (Hi-Z)
-        platform_gpio_pin_mode(_pin, PLATFORM_GPIO_MODE_INPUT_PULLUP);
-    }
-    
-    bool readLine() override {
-        // Read the physical line state
-        // true = high, false = low
-        return platform_gpio_read(_pin);
+    OneWireHalArduino(uint32_t pin);
+
+    bool readLine() override;
+    void driveLow(bool enableLow) override;
+    uint32_t micros() override;
+    void delayMicros(uint32_t us) override;
+
+    void deadlineHint(uint32_t inUs) override {
+        platform_timing_hint_deadline_us(inUs);
     }
-    
-    void driveLow(bool enableLow) override {
-        if (enableLow) {
-            platform_gpio_pin_mode(_pin, PLATFORM_GPIO_MODE_OUTPUT);
-            platform_gpio_write(_pin, PLATFORM_GPIO_LOW);
-        } else {
-            platform_gpio_pin_mode(_pin, PLATFORM_GPIO_MODE_INPUT_PULLUP);
-        }
+
+    bool getOps(OneWireHalOps* ops) override;
+};
+
+// Direct entry points: the class is final, so these call the RAM
+// functions below without a vtable lookup
+static PLATFORM_RAMFUNC bool opsReadLine(IOneWireHal* hal) {
+    return static_cast<OneWireHalArduino*>(hal)->readLine();
+}
+
+static PLATFORM_RAMFUNC void opsDriveLow(IOneWireHal* hal, bool enableLow) {
+    static_cast<OneWireHalArduino*>(hal)->driveLow(enableLow);
+}
+
+static PLATFORM_RAMFUNC uint32_t opsMicros(IOneWireHal* hal) {
+    return static_cast<OneWireHalArduino*>(hal)->micros();
+}
+
+static PLATFORM_RAMFUNC void opsDelayMicros(IOneWireHal* hal, uint32_t us) {
+    static_cast<OneWireHalArduino*>(hal)->delayMicros(us);
+}
+
+OneWireHalArduino::OneWireHalArduino(uint32_t pin) : _pin(pin) {
+    // Configure pin as input with pull-up initially (Hi-Z)
+    platform_gpio_pin_mode(_pin, PLATFORM_GPIO_MODE_INPUT_PULLUP);
+
+    _port = digitalPinToPort(_pin);
+    _mask = digitalPinToBitMask(_pin);
+    _port->BRR = _mask;   // Output latch low, used by driveLow()
+    uint32_t shift = 2 * (31 - __builtin_clz(_mask));
+    _moderMask = 3u << shift;
+    _moderOutput = 1u << shift;
+    _pupdrPullUp = 1u << shift;
+    _usPerCountQ16 = (uint32_t)((1000ull << 16) / (SysTick->LOAD + 1));
+}
+
+PLATFORM_RAMFUNC bool OneWireHalArduino::readLine() {
+    // Read the physical line state
+    // true = high, false = low
+    return (_port->IDR & _mask) != 0;
+}
+
+PLATFORM_RAMFUNC void OneWireHalArduino::driveLow(bool enableLow) {
+    // ODR stays low, so output mode drives the line low
+    if (enableLow) {
+        _port->PUPDR &= ~_moderMask;
+        _port->MODER = (_port->MODER & ~_moderMask) | _moderOutput;
+    } else {
+        _port->MODER &= ~_moderMask;
+        _port->PUPDR = (_port->PUPDR & ~_moderMask) | _pupdrPullUp;
     }
-    
-    uint32_t micros() override {
-        return platform_micros();
+}
+
+bool OneWireHalArduino::getOps(OneWireHalOps* ops) {
+    *ops = { opsReadLine, opsDriveLow, opsMicros, opsDelayMicros };
+    return true;
+}
+
+PLATFORM_RAMFUNC uint32_t OneWireHalArduino::micros() {
+    // VAL reloads before the tick interrupt has run, and the interrupt
+    // waits while masked or behind a higher priority handler. Retry if
+    // SysTick wrapped (COUNTFLAG, cleared by reading CTRL) or the tick
+    // moved during the reads; a wrap from before them is still pending
+    // and its millisecond is counted here.
+    uint32_t ms, val, pending;
+    do {
+        (void)SysTick->CTRL;
+        ms = uwTick;
+        val = SysTick->VAL;
+        pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+    } while ((SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) || ms != uwTick);
+    if (pending) {
+        ms += (uint32_t)uwTickFreq;
     }
-    
-    void delayMicros(uint32_t us) override {
-        platform_delay_us(us);
+    uint32_t counted = SysTick->LOAD - val;
+    return ms * 1000 + ((counted * _usPerCountQ16) >> 16);
+}
+
+PLATFORM_RAMFUNC void OneWireHalArduino::delayMicros(uint32_t us) {
+    uint32_t start = micros();
+    while (micros() - start < us) {
     }
-};
+}
 
 // Global instance (will be initialized in setup)
 static OneWireHalArduino* g_oneWireHal = nullptr;
@@ -0,0 +1,113 @@
+#include "uid_codec.h"
+#include <string.h>
+
+static constexpr size_t WAFER_OFFSET = 0;
+static constexpr size_t LOT_OFFSET = 1;
+static constexpr size_t LOT_LEN = 7;
+static constexpr size_t X_OFFSET = 8;
+static constexpr size_t Y_OFFSET = 10;
+
+static size_t putVarint(uint8_t* out, uint16_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// Returns bytes consumed, 0 if truncated or too long for 16 bits
+static size_t getVarint(const uint8_t* in, size_t avail, uint16_t* v) {
+    uint32_t result = 0;
+    for (size_t n = 0; n < avail && n < 3; n++) {
+        result |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            if (result > 0xFFFF) return 0;
+            *v = (uint16_t)result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+size_t uid_compact_encode(const uint8_t uid[DEVICE_UID_LEN],
+                          const uint8_t dict[DEVICE_UID_LEN],
+                          uint8_t out[UID_COMPACT_MAX_LEN]) {
+    uint8_t body[LOT_LEN + 1 + 3 + 3];
+    size_t pos = 0;
+    uint8_t header = 0;
+
+    if (memcmp(uid + LOT_OFFSET, dict + LOT_OFFSET, LOT_LEN) == 0) {
+        header |= UID_COMPACT_LOT_SAME;
+    } else {
+        memcpy(body + pos, uid + LOT_OFFSET, LOT_LEN);
+        pos += LOT_LEN;
+    }
+
+    if (uid[WAFER_OFFSET] == dict[WAFER_OFFSET]) {
+        header |= UID_COMPACT_WAF_SAME;
+    } else {
+        body[pos++] = uid[WAFER_OFFSET];
+    }
+
+    pos += putVarint(body + pos, (uint16_t)((uid[X_OFFSET] << 8) | uid[X_OFFSET + 1]));
+    pos += putVarint(body + pos, (uint16_t)((uid[Y_OFFSET] << 8) | uid[Y_OFFSET + 1]));
+
+    if (pos >= DEVICE_UID_LEN) {
+        out[0] = UID_COMPACT_RAW | DEVICE_UID_LEN;
+        memcpy(out + 1, uid, DEVICE_UID_LEN);
+        return 1 + DEVICE_UID_LEN;
+    }
+
+    out[0] = header | (uint8_t)pos;
+    memcpy(out + 1, body, pos);
+    return 1 + pos;
+}
+
+bool uid_compact_decode(const uint8_t* frame, size_t len,
+                        const uint8_t dict[DEVICE_UID_LEN],
+                        uint8_t uidOut[DEVICE_UID_LEN]) {
+    if (len < 1) return false;
+    uint8_t header = frame[0];
+    size_t bodyLen = uid_compact_body_len(header);
+    if (len != 1 + bodyLen) return false;
+    const uint8_t* body = frame + 1;
+
+    if (header & UID_COMPACT_RAW) {
+        if (bodyLen != DEVICE_UID_LEN) return false;
+        memcpy(uidOut, body, DEVICE_UID_LEN);
+        return true;
+    }
+
+    size_t pos = 0;
+    if (header & UID_COMPACT_LOT_SAME) {
+        memcpy(uidOut + LOT_OFFSET, dict + LOT_OFFSET, LOT_LEN);
+    } else {
+        if (bodyLen - pos < LOT_LEN) return false;
+        memcpy(uidOut + LOT_OFFSET, body + pos, LOT_LEN);
+        pos += LOT_LEN;
+    }
+
+    if (header & UID_COMPACT_WAF_SAME) {
+        uidOut[WAFER_OFFSET] = dict[WAFER_OFFSET];
+    } else {
+        if (bodyLen - pos < 1) return false;
+        uidOut[WAFER_OFFSET] = body[pos++];
+    }
+
+    uint16_t x, y;
+    size_t n = getVarint(body + pos, bodyLen - pos, &x);
+    if (n == 0) return false;
+    pos += n;
+    n = getVarint(body + pos, bodyLen - pos, &y);
+    if (n == 0) return false;
+    pos += n;
+    if (pos != bodyLen) return false;
+
+    uidOut[X_OFFSET]     = (uint8_t)(x >> 8);
+    uidOut[X_OFFSET + 1] = (uint8_t)x;
+    uidOut[Y_OFFSET]     = (uint8_t)(y >> 8);
+    uidOut[Y_OFFSET + 1] = (uint8_t)y;
+    return true;
+}
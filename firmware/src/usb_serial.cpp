@@ -3,45 +3,21 @@
 #include "fw_config.h"
 #include "platform_serial.h"
 #include "platform_timing.h"
+#include "hex_util.h"
+#include "crc32.h"
+#include "sync_format.h"
+#include "platform_rng.h"
+#include "platform_power.h"
+#include "platform_usb.h"
 #include "mbedtls/md.h"
-#include <cstdlib>  // for atoi
-
-// ========= util =========
-bool UsbCommandHandler::hexToBytes(const char* hex, uint8_t* out, size_t outLen) {
-    size_t len = strlen(hex);
-    if (len != outLen * 2) return false;
-
-    auto hexVal = [](char c) -> int {
-        if (c >= '0' && c <= '9') return c - '0';
-        if (c >= 'A' && c <= 'F') return 10 + c - 'A';
-        if (c >= 'a' && c <= 'f') return 10 + c - 'a';
-        return -1;
-    };
-
-    for (size_t i = 0; i < outLen; ++i) {
-        int hi = hexVal(hex[2*i]);
-        int lo = hexVal(hex[2*i+1]);
-        if (hi < 0 || lo < 0) return false;
-        out[i] = (hi << 4) | lo;
-    }
-    return true;
-}
+#include <cstdlib>  // for atoi, strtoul
 
-void UsbCommandHandler::bytesToHex(const uint8_t* in, size_t len, char* out) {
-    auto hexDigit = [](uint8_t v) -> char {
-        return (v < 10) ? ('0' + v) : ('A' + (v - 10));
-    };
-    for (size_t i = 0; i < len; ++i) {
-        out[2*i]   = hexDigit((in[i] >> 4) & 0x0F);
-        out[2*i+1] = hexDigit(in[i] & 0x0F);
-    }
-    out[2*len] = '\0';
-}
-
-void UsbCommandHandler::printHex(const uint8_t* data, size_t len) {
-    for (size_t i = 0; i < len; ++i) {
-        platform_serial_print_hex(data[i]);
-    }
+static bool parseUint(const char* tok, int base, uint32_t& out)
+{
+    if (!tok || !*tok) return false;
+    char* end;
+    out = strtoul(tok, &end, base);
+    return *end == '\0';
 }
 
 void UsbCommandHandler::begin(unsigned long baud)
@@ -62,16 +38,32 @@ void UsbCommandHandler::begin(unsigned long baud)
     
     // Reset command buffer state
     _len = 0;
+
+    buildHelloReply();
 }
 
 // Call inside loop()
 void UsbCommandHandler::poll(IStorage &storage)
 {
+    if (_imageRxLen > 0) {
+        pollImageWrite();
+    }
+
     while (platform_serial_available() > 0)
     {
         int c = platform_serial_read();
         if (c < 0) break;  // No data available
 
+        // Raw IMAGE_WRITE payload bytes bypass the line parser
+        if (_imageRxLen > 0) {
+            *_image.chunkTarget(_imageRxOffset + _imageRxPos) = (uint8_t)c;
+            _imageRxLastMs = platform_millis();
+            if (++_imageRxPos == _imageRxLen) {
+                finishImageWrite();
+            }
+            continue;
+        }
+
         if (c == '\r')
             continue;
 
@@ -135,36 +127,87 @@ void UsbCommandHandler::handleLine(IStorage &storage, const char *line)
     {
         cmdClear(storage);
     }
+    else if (strcmp(cmd, "SNAPSHOT") == 0)
+    {
+        cmdSnapshot(storage);
+    }
     else if (strcmp(cmd, "DUMP") == 0)
     {
         char *tokOffset = strtok(nullptr, " \t");
         char *tokCount = strtok(nullptr, " \t");
+        char *tokSnap = strtok(nullptr, " \t");
         int offset = 0;
         int count = 10;
         if (tokOffset)
             offset = atoi(tokOffset);
         if (tokCount)
             count = atoi(tokCount);
-        cmdDump(storage, offset, count);
+        cmdDump(storage, offset, count, tokSnap);
+    }
+    else if (strcmp(cmd, "DUMPZ") == 0)
+    {
+        cmdDumpCompressed(storage, strtok(nullptr, " \t"));
     }
      else if (strcmp(cmd, "PROVISION_KEY") == 0) {
         char* tokVer = strtok(nullptr, " \t");
         char* tokKey = strtok(nullptr, " \t");
         if (!tokVer || !tokKey) {
-            platform_serial_println("{\"event\":\"error\",\"msg\":\"PROVISION_KEY args\"}");
-            platform_serial_flush();
+            sendError("PROVISION_KEY args");
             return;
         }
         int ver = atoi(tokVer);
         cmdProvisionKey(storage, ver, tokKey);
     } else if (strcmp(cmd, "SIGN_STATE") == 0) {
         char* tokNonce = strtok(nullptr, " \t");
+        char* tokSnap = strtok(nullptr, " \t");
+        if (!tokNonce) {
+            sendError("SIGN_STATE args");
+            return;
+        }
+        cmdSignState(storage, tokNonce, tokSnap);
+    } else if (strcmp(cmd, "SYNC") == 0) {
+        char* tokNonce = strtok(nullptr, " \t");
+        char* tokSince = strtok(nullptr, " \t");
+        char* tokGen = strtok(nullptr, " \t");
         if (!tokNonce) {
-            platform_serial_println("{\"event\":\"error\",\"msg\":\"SIGN_STATE args\"}");
-            platform_serial_flush();
+            sendError("SYNC args");
             return;
         }
-        cmdSignState(storage, tokNonce);
+        cmdSync(storage, tokNonce, tokSince, tokGen);
+    } else if (strcmp(cmd, "BRIDGE") == 0) {
+        char* tokMode = strtok(nullptr, " \t");
+        char* tokId = strtok(nullptr, " \t");
+        cmdBridge(tokMode, tokId);
+    } else if (strcmp(cmd, "FORMAT") == 0) {
+        cmdFormat(strtok(nullptr, " \t"));
+    } else if (strcmp(cmd, "SCHEMA") == 0) {
+        cmdSchema();
+    } else if (strcmp(cmd, "SELFTEST") == 0) {
+        _selfTestRequested = true;
+    } else if (strcmp(cmd, "POWER") == 0) {
+        char* tokArg = strtok(nullptr, " \t");
+        if (tokArg && strcmp(tokArg, "RESET") == 0) {
+            platform_power_reset_states();
+        } else if (tokArg) {
+            sendError("POWER args");
+            return;
+        }
+        _powerRequested = true;
+    } else if (strcmp(cmd, "IMAGE_BEGIN") == 0) {
+        cmdImageBegin(storage);
+    } else if (strcmp(cmd, "IMAGE_AUTH") == 0) {
+        cmdImageAuth(storage, strtok(nullptr, " \t"));
+    } else if (strcmp(cmd, "IMAGE_READ") == 0) {
+        char* tokOff = strtok(nullptr, " \t");
+        char* tokLen = strtok(nullptr, " \t");
+        cmdImageRead(storage, tokOff, tokLen);
+    } else if (strcmp(cmd, "IMAGE_WRITE") == 0) {
+        char* tokOff = strtok(nullptr, " \t");
+        char* tokLen = strtok(nullptr, " \t");
+        char* tokCrc = strtok(nullptr, " \t");
+        cmdImageWrite(tokOff, tokLen, tokCrc);
+    } else if (strcmp(cmd, "IMAGE_COMMIT") == 0) {
+        cmdImageCommit(storage);
 #ifdef ENABLE_TEST_COMMANDS
     } else if (strcmp(cmd, "GET_KEY") == 0) {
         cmdGetKey(storage);
@@ -172,61 +215,118 @@ void UsbCommandHandler::handleLine(IStorage &storage, const char *line)
     }
     else
     {
-        platform_serial_print("{\"event\":\"error\",\"msg\":\"unknown command: ");
-        platform_serial_print(cmd);
-        platform_serial_println("\"}");
-        platform_serial_flush();
+        static const char PREFIX[] = "unknown command: ";
+        char msg[sizeof(PREFIX) + CMD_BUF_SIZE];
+        memcpy(msg, PREFIX, sizeof(PREFIX) - 1);
+        strcpy(msg + sizeof(PREFIX) - 1, cmd);
+        sendError(msg);
     }
 }
 
-void UsbCommandHandler::cmdHello(IStorage &storage)
+static HelloResponse helloValues()
 {
-    char hexId[DEVICE_UID_HEX_LEN + 1];
-    getDeviceUidHex(hexId);
-
-    platform_serial_print("{\"event\":\"hello\"");
-    platform_serial_print(",\"device_id\":\"");
-    platform_serial_print(hexId);
-
-    platform_serial_print("\",\"fw\":\"");
-    platform_serial_print(FW_VERSION_STRING);
+    HelloResponse r;
+    getDeviceUidRaw(r.device_id);
+    r.fw = FW_VERSION_STRING;
+    r.build = FW_BUILD_DATETIME;
+    r.hash = FW_BUILD_HASH;
+    return r;
+}
 
-    platform_serial_print("\",\"build\":\"");
-    platform_serial_print(FW_BUILD_DATETIME);
+// HELLO never changes while running: encode it once per format
+bool UsbCommandHandler::buildHelloReply()
+{
+    return _helloReply.build(SCHEMA_HELLO, helloValues(), 0, _format);
+}
 
-    platform_serial_print("\",\"hash\":\"");
-    platform_serial_print(FW_BUILD_HASH);
-    platform_serial_println("\"}");
+void UsbCommandHandler::cmdHello(IStorage &storage)
+{
+    if (!_helloReply.builtFor(_format) && !buildHelloReply()) {
+        send(SCHEMA_HELLO, helloValues());   // longer than the cache
+        return;
+    }
+    platform_serial_write(_helloReply.text, _helloReply.info.len);
     platform_serial_flush();
 }
 
 void UsbCommandHandler::cmdGetState(IStorage &storage)
 {
     auto &st = storage.state();
+    StateResponse r = { st.totalTapCount, st.linkCount };
 
-    platform_serial_print("{\"event\":\"state\"");
-    platform_serial_print(",\"totalTapCount\":");
-    platform_serial_print((uint32_t)st.totalTapCount);
-    platform_serial_print(",\"linkCount\":");
-    platform_serial_print((uint32_t)st.linkCount);
-    platform_serial_println("}");
+    // Both fields are holes: only their digits are written per call
+    static constexpr uint32_t VARIABLE = (1u << 0) | (1u << 1);
+    if (!_stateReply.builtFor(_format) && !_stateReply.build(SCHEMA_STATE, r, VARIABLE, _format)) {
+        send(SCHEMA_STATE, r);
+        return;
+    }
+    uint8_t out[STATE_REPLY_MAX_LEN + 2 * 10];
+    size_t len = _stateReply.render(r, out, sizeof(out));
+    platform_serial_write(out, len);
     platform_serial_flush();
 }
 
 void UsbCommandHandler::cmdClear(IStorage &storage)
 {
     // Acknowledge immediately before performing potentially blocking NVM writes
-    platform_serial_println("{\"event\":\"ack\",\"cmd\":\"CLEAR\"}");
-    platform_serial_flush();
+    send(SCHEMA_ACK, AckResponse{ "CLEAR", 0 });
     platform_delay_ms(10);
 
     storage.clearAll();
 }
 
-void UsbCommandHandler::cmdDump(IStorage &storage, int offset, int count)
+void UsbCommandHandler::cmdSnapshot(IStorage &storage)
 {
     auto &st = storage.state();
 
+    uint16_t lc = st.linkCount;
+    if (lc > PersistPayloadV1::MAX_LINKS) lc = PersistPayloadV1::MAX_LINKS;
+
+    // Only one snapshot is held; taking a new one replaces the old
+    _snap.id = _nextSnapId++;
+    _snap.linkGeneration = storage.getLinkGeneration();
+    _snap.totalTapCount = st.totalTapCount;
+    _snap.linkCount = lc;
+
+    send(SCHEMA_SNAPSHOT, SnapshotResponse{ _snap.id, _snap.totalTapCount, _snap.linkCount });
+}
+
+bool UsbCommandHandler::resolveView(IStorage &storage, const char *snapTok,
+                                    uint32_t &tapCount, uint16_t &linkCount)
+{
+    if (!snapTok) {
+        auto &st = storage.state();
+        tapCount = st.totalTapCount;
+        linkCount = st.linkCount;
+        if (linkCount > PersistPayloadV1::MAX_LINKS) linkCount = PersistPayloadV1::MAX_LINKS;
+        return true;
+    }
+
+    uint32_t id = (uint32_t)strtoul(snapTok, nullptr, 10);
+    if (id == 0 || id != _snap.id) {
+        sendError("snapshot_unknown");
+        return false;
+    }
+    if (_snap.linkGeneration != storage.getLinkGeneration()) {
+        // Links covered by the snapshot were cleared or overwritten
+        sendError("snapshot_stale");
+        return false;
+    }
+
+    tapCount = _snap.totalTapCount;
+    linkCount = _snap.linkCount;
+    return true;
+}
+
+void UsbCommandHandler::cmdDump(IStorage &storage, int offset, int count, const char *snapTok)
+{
+    auto &st = storage.state();
+
+    uint32_t tapCount;
+    uint16_t linkCount;
+    if (!resolveView(storage, snapTok, tapCount, linkCount))
+        return;
+
     if (offset < 0)
         offset = 0;
     if (count < 0)
@@ -239,17 +339,20 @@ void UsbCommandHandler::cmdDump(IStorage &storage, int offset, int count)
         return;
     }
 
-    int maxAvailable = st.linkCount;
-    if (maxAvailable > (int)PersistPayloadV1::MAX_LINKS)
-    {
-        maxAvailable = PersistPayloadV1::MAX_LINKS;
-    }
+    int maxAvailable = linkCount;
 
     int end = offset + count;
     if (end > maxAvailable)
         end = maxAvailable;
 
-    platform_serial_print("{\"event\":\"links\",\"offset\":");
+    platform_serial_print("{\"event\":\"links\",");
+    if (snapTok)
+    {
+        platform_serial_print("\"snap\":");
+        platform_serial_print(_snap.id);
+        platform_serial_print(",");
+    }
+    platform_serial_print("\"offset\":");
     platform_serial_print(offset);
     platform_serial_print(",\"count\":");
     platform_serial_print(end - offset);
@@ -262,34 +365,44 @@ void UsbCommandHandler::cmdDump(IStorage &storage, int offset, int count)
             platform_serial_print(",");
         first = false;
 
-        platform_serial_print("{\"peer\":\"");
-        printHex(st.links[i].peerId, DEVICE_UID_LEN);
-        platform_serial_print("\"}");
+        char item[DUMP_ITEM_MAX_LEN];
+        dump_format_item(item, st.links[i].peerId);
+        platform_serial_print(item);
     }
 
     platform_serial_println("]}");
     platform_serial_flush();
 }
 
+void UsbCommandHandler::cmdDumpCompressed(IStorage &storage, const char *snapTok)
+{
+    LinksExportResponse r = {};
+    if (!resolveView(storage, snapTok, r.totalTapCount, r.linkCount))
+        return;
+    r.snap = snapTok ? _snap.id : 0;
+
+    // Same stack budget as SIGN_STATE's message buffer
+    uint8_t data[LINK_EXPORT_MAX_LEN];
+    r.len = (uint16_t)link_export_encode(storage.state().links, r.linkCount, data, sizeof(data));
+    send(SCHEMA_LINKS_Z, r, false);
+    platform_serial_write(data, r.len);
+    platform_serial_flush();
+}
+
 void UsbCommandHandler::cmdProvisionKey(IStorage& storage, int version, const char* keyHex) {
         if (version <= 0 || version > 255) {
-            platform_serial_println("{\"event\":\"error\",\"msg\":\"invalid keyVersion\"}");
-            platform_serial_flush();
+            sendError("invalid keyVersion");
             return;
         }
 
     uint8_t key[32];
-    if (!hexToBytes(keyHex, key, 32)) {
-        platform_serial_println("{\"event\":\"error\",\"msg\":\"invalid key hex\"}");
-        platform_serial_flush();
+    if (!hex_decode(keyHex, key, 32)) {
+        sendError("invalid key hex");
         return;
     }
 
     // Acknowledge the provision command before performing the EEPROM write
-    platform_serial_print("{\"event\":\"ack\",\"cmd\":\"PROVISION_KEY\",\"keyVersion\":");
-    platform_serial_print(version);
-    platform_serial_println("}");
-    platform_serial_flush();
+    send(SCHEMA_ACK, AckResponse{ "PROVISION_KEY", (uint8_t)version });
     platform_delay_ms(10);
 
     storage.setSecretKey((uint8_t)version, key);
@@ -298,42 +411,47 @@ void UsbCommandHandler::cmdProvisionKey(IStorage& storage, int version, const ch
 #ifdef ENABLE_TEST_COMMANDS
 void UsbCommandHandler::cmdGetKey(IStorage& storage) {
     if (!storage.hasSecretKey()) {
-        platform_serial_println("{\"event\":\"error\",\"msg\":\"no_key\"}");
-        platform_serial_flush();
+        sendError("no_key");
         return;
     }
-    const uint8_t* key = storage.getSecretKey();
-    char hex[65];
-    bytesToHex(key, 32, hex);
-    platform_serial_print("{\"event\":\"key\",\"keyVersion\":");
-    platform_serial_print((uint32_t)storage.getKeyVersion());
-    platform_serial_print(",\"key\":\"");
-    platform_serial_print(hex);
-    platform_serial_println("\"}");
-    platform_serial_flush();
+    KeyResponse r;
+    r.keyVersion = storage.getKeyVersion();
+    memcpy(r.key, storage.getSecretKey(), sizeof(r.key));
+    send(SCHEMA_KEY, r);
 }
 #endif
 
-void UsbCommandHandler::cmdSignState(IStorage& storage, const char* nonceHex) {
+bool UsbCommandHandler::parseNonce(const char* nonceHex, uint8_t* nonce, size_t& nonceLen) {
+    // Variable length, must be even and no more than 32 bytes
+    size_t nonceHexLen = strlen(nonceHex);
+    if (nonceHexLen == 0 || (nonceHexLen % 2) != 0 || nonceHexLen > SIGN_NONCE_MAX_LEN * 2) {
+        sendError("invalid nonce");
+        return false;
+    }
+    nonceLen = nonceHexLen / 2;
+
+    if (!hex_decode(nonceHex, nonce, nonceLen)) {
+        sendError("invalid nonce hex");
+        return false;
+    }
+    return true;
+}
+
+void UsbCommandHandler::cmdSignState(IStorage& storage, const char* nonceHex, const char* snapTok) {
     if (!storage.hasSecretKey()) {
-        platform_serial_println("{\"event\":\"error\",\"msg\":\"no_key\"}");
-        platform_serial_flush();
+        sendError("no_key");
         return;
     }
 
-    // Parse nonce (variable length, must be even and no more than 32 bytes)
-    size_t nonceHexLen = strlen(nonceHex);
-    if (nonceHexLen == 0 || (nonceHexLen % 2) != 0 || nonceHexLen > 64) {
-        platform_serial_println("{\"event\":\"error\",\"msg\":\"invalid nonce\"}");
-        platform_serial_flush();
+    uint8_t nonce[SIGN_NONCE_MAX_LEN];
+    size_t nonceLen;
+    if (!parseNonce(nonceHex, nonce, nonceLen)) {
         return;
     }
-    size_t nonceLen = nonceHexLen / 2;
 
-    uint8_t nonce[32];
-    if (!hexToBytes(nonceHex, nonce, nonceLen)) {
-        platform_serial_println("{\"event\":\"error\",\"msg\":\"invalid nonce hex\"}");
-        platform_serial_flush();
+    uint32_t tapCount;
+    uint16_t lc;
+    if (!resolveView(storage, snapTok, tapCount, lc)) {
         return;
     }
 
@@ -341,80 +459,495 @@ void UsbCommandHandler::cmdSignState(IStorage& storage, const char* nonceHex) {
     const uint8_t* key = storage.getSecretKey();
     uint8_t keyVersion = storage.getKeyVersion();
 
-    // Construct the message to be signed:
-    // msg = selfId(12) + nonce(N) + totalTapCount(4 LE) + linkCount(2 LE) + each peerId(12)
-    const size_t maxMsgLen =
-        DEVICE_UID_LEN          // selfId
-        + 32                    // max nonce
-        + 4                     // totalTapCount
-        + 2                     // linkCount
-        + (PersistPayloadV1::MAX_LINKS * DEVICE_UID_LEN); // links
-
-    uint8_t msg[maxMsgLen];
-    size_t pos = 0;
-
-    // selfId
-    memcpy(msg + pos, st.selfId, DEVICE_UID_LEN);
-    pos += DEVICE_UID_LEN;
-
-    // nonce
-    memcpy(msg + pos, nonce, nonceLen);
-    pos += nonceLen;
-
-    // totalTapCount (little-endian)
-    uint32_t t = st.totalTapCount;
-    msg[pos++] = (uint8_t)(t & 0xFF);
-    msg[pos++] = (uint8_t)((t >> 8) & 0xFF);
-    msg[pos++] = (uint8_t)((t >> 16) & 0xFF);
-    msg[pos++] = (uint8_t)((t >> 24) & 0xFF);
-
-    // linkCount (little-endian, 2 bytes)
+    // Construct the message to be signed (see sync_format.h)
+    uint8_t msg[SIGN_MSG_MAX_LEN];
+    size_t pos = sign_message_build(msg, st.selfId, nonce, nonceLen,
+                                    tapCount, st.links, lc);
+
+    SignedStateResponse r;
+    const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (!info) {
+        sendError("md_info");
+        return;
+    }
+    int ret = mbedtls_md_hmac(info, key, 32, msg, pos, r.hmac);
+    if (ret != 0) {
+        sendError("hmac_failed");
+        return;
+    }
+
+    memcpy(r.device_id, st.selfId, DEVICE_UID_LEN);
+    r.nonce = nonceHex;
+    r.totalTapCount = tapCount;
+    r.linkCount = lc;
+    r.snap = snapTok ? _snap.id : 0;
+    r.keyVersion = keyVersion;
+    send(SCHEMA_SIGNED_STATE, r);
+}
+
+void UsbCommandHandler::cmdSync(IStorage& storage, const char* nonceHex, const char* sinceTok,
+                                const char* genTok) {
+    if (!storage.hasSecretKey()) {
+        sendError("no_key");
+        return;
+    }
+
+    uint8_t nonce[SIGN_NONCE_MAX_LEN];
+    size_t nonceLen;
+    if (!parseNonce(nonceHex, nonce, nonceLen)) {
+        return;
+    }
+
+    // Counters and links are read in this one call, so nothing can
+    // change between what is streamed and what is signed
+    auto &st = storage.state();
     uint16_t lc = st.linkCount;
     if (lc > PersistPayloadV1::MAX_LINKS) lc = PersistPayloadV1::MAX_LINKS;
-    msg[pos++] = (uint8_t)(lc & 0xFF);
-    msg[pos++] = (uint8_t)((lc >> 8) & 0xFF);
 
-    // links peerId
-    for (uint16_t i = 0; i < lc; ++i) {
-        memcpy(msg + pos, st.links[i].peerId, DEVICE_UID_LEN);
-        pos += DEVICE_UID_LEN;
+    uint32_t gen = storage.getLinkGeneration();
+
+    uint32_t since = 0;
+    uint32_t hostGen = 0;
+    if (sinceTok && !parseUint(sinceTok, 10, since)) {
+        sendError("invalid since");
+        return;
+    }
+    if (genTok && !parseUint(genTok, 10, hostGen)) {
+        sendError("invalid generation");
+        return;
+    }
+    // The host's links[0..since) are only ours while the generation
+    // holds; otherwise the slots were cleared, wrapped or restored,
+    // so send everything and let the reply's since say so
+    if (!genTok || hostGen != gen) {
+        since = 0;
+    }
+    if (since > lc) {
+        sendError("invalid since");
+        return;
     }
 
-    // HMAC-SHA256
-    uint8_t hmac[32];
+    // Everything that can fail happens before the first byte goes out
     const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
     if (!info) {
-        platform_serial_println("{\"event\":\"error\",\"msg\":\"md_info\"}");
-        platform_serial_flush();
+        sendError("md_info");
         return;
     }
-    int ret = mbedtls_md_hmac(info, key, 32, msg, pos, hmac);
-    if (ret != 0) {
-        platform_serial_println("{\"event\":\"error\",\"msg\":\"hmac_failed\"}");
-        platform_serial_flush();
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    if (mbedtls_md_setup(&ctx, info, 1) != 0 ||
+        mbedtls_md_hmac_starts(&ctx, storage.getSecretKey(), 32) != 0) {
+        mbedtls_md_free(&ctx);
+        sendError("hmac_failed");
         return;
     }
 
-    // Output in hex form
-    char hmacHex[64 + 1];
-    bytesToHex(hmac, 32, hmacHex);
+    uint8_t header[SYNC_HEADER_MAX_LEN];
+    size_t headerLen = sync_header_build(header, st.selfId, nonce, nonceLen,
+                                         st.totalTapCount, lc, (uint16_t)since, gen);
+    int ret = mbedtls_md_hmac_update(&ctx, header, headerLen);
 
-    char devHex[DEVICE_UID_HEX_LEN + 1];
-    bytesToHex(st.selfId, DEVICE_UID_LEN, devHex);
+    char hexId[DEVICE_UID_HEX_LEN + 1];
+    hex_encode(st.selfId, DEVICE_UID_LEN, hexId);
 
-    platform_serial_print("{\"event\":\"SIGNED_STATE\"");
-    platform_serial_print(",\"device_id\":\"");
-    platform_serial_print(devHex);
+    platform_serial_print("{\"event\":\"sync\",\"device_id\":\"");
+    platform_serial_print(hexId);
     platform_serial_print("\",\"nonce\":\"");
     platform_serial_print(nonceHex);
     platform_serial_print("\",\"totalTapCount\":");
-    platform_serial_print((uint32_t)st.totalTapCount);
+    platform_serial_print(st.totalTapCount);
     platform_serial_print(",\"linkCount\":");
-    platform_serial_print((uint32_t)lc);
+    platform_serial_print(lc);
+    platform_serial_print(",\"since\":");
+    platform_serial_print(since);
+    platform_serial_print(",\"generation\":");
+    platform_serial_print(gen);
     platform_serial_print(",\"keyVersion\":");
-    platform_serial_print((uint32_t)keyVersion);
-    platform_serial_print(",\"hmac\":\"");
-    platform_serial_print(hmacHex);
-    platform_serial_println("\"}");
+    platform_serial_print(storage.getKeyVersion());
+    platform_serial_print(",\"items\":[");
+
+    for (uint16_t i = (uint16_t)since; i < lc; i++) {
+        if (i != since)
+            platform_serial_print(",");
+        char item[DUMP_ITEM_MAX_LEN];
+        dump_format_item(item, st.links[i].peerId);
+        platform_serial_print(item);
+        ret |= mbedtls_md_hmac_update(&ctx, st.links[i].peerId, DEVICE_UID_LEN);
+    }
+
+    uint8_t hmac[32];
+    ret |= mbedtls_md_hmac_finish(&ctx, hmac);
+    mbedtls_md_free(&ctx);
+
+    if (ret != 0) {
+        platform_serial_println("],\"error\":\"hmac_failed\"}");
+    } else {
+        char hmacHex[65];
+        hex_encode(hmac, sizeof(hmac), hmacHex);
+        platform_serial_print("],\"hmac\":\"");
+        platform_serial_print(hmacHex);
+        platform_serial_println("\"}");
+    }
+    platform_serial_flush();
+}
+
+// ========= bridge mode =========
+
+void UsbCommandHandler::cmdBridge(const char* modeTok, const char* idHex)
+{
+    if (modeTok) {
+        bool on;
+        if (strcmp(modeTok, "ON") == 0 || strcmp(modeTok, "on") == 0) {
+            on = true;
+        } else if (strcmp(modeTok, "OFF") == 0 || strcmp(modeTok, "off") == 0) {
+            on = false;
+        } else {
+            sendError("BRIDGE args");
+            return;
+        }
+
+        uint8_t id[DEVICE_UID_LEN];
+        if (on && idHex && !hex_decode(idHex, id, DEVICE_UID_LEN)) {
+            sendError("invalid station id");
+            return;
+        }
+
+        _bridgeOn = on;
+        _bridgeIdSet = on && idHex;
+        if (_bridgeIdSet) {
+            memcpy(_bridgeId, id, DEVICE_UID_LEN);
+        }
+        _bridgeChanged = true;
+    }
+
+    BridgeResponse r = {};
+    r.on = _bridgeOn;
+    if (_bridgeIdSet) {
+        memcpy(r.station, _bridgeId, DEVICE_UID_LEN);
+    }
+    r.seq = _bridgeSeq;
+    send(SCHEMA_BRIDGE, r);
+}
+
+bool UsbCommandHandler::getBridgeIdentity(uint8_t idOut[DEVICE_UID_LEN]) const
+{
+    if (!_bridgeOn || !_bridgeIdSet) {
+        return false;
+    }
+    memcpy(idOut, _bridgeId, DEVICE_UID_LEN);
+    return true;
+}
+
+bool UsbCommandHandler::takeBridgeChange()
+{
+    bool changed = _bridgeChanged;
+    _bridgeChanged = false;
+    return changed;
+}
+
+void UsbCommandHandler::publishTap(const uint8_t selfId[DEVICE_UID_LEN],
+                                   const uint8_t peerId[DEVICE_UID_LEN], bool isMaster)
+{
+    TapEventResponse r;
+    r.seq = ++_bridgeSeq;
+    r.role = isMaster ? "master" : "slave";
+    memcpy(r.self, selfId, DEVICE_UID_LEN);
+    memcpy(r.peer, peerId, DEVICE_UID_LEN);
+
+    // Not flushed: the host reads events asynchronously and the tap
+    // link must not wait on USB
+    send(SCHEMA_TAP, r, false);
+}
+
+// ========= manufacturing self-test =========
+
+bool UsbCommandHandler::takeSelfTestRequest()
+{
+    bool requested = _selfTestRequested;
+    _selfTestRequested = false;
+    return requested;
+}
+
+void UsbCommandHandler::publishSelfTest(const SelfTestReport& report)
+{
+    char hexId[DEVICE_UID_HEX_LEN + 1];
+    getDeviceUidHex(hexId);
+
+    platform_serial_print("{\"event\":\"selftest\",\"id\":\"");
+    platform_serial_print(hexId);
+    platform_serial_print("\",\"pass\":");
+    platform_serial_print(report.failMask == 0 ? "true" : "false");
+    platform_serial_print(",\"failed\":[");
+    bool first = true;
+    for (uint8_t i = 0; i < SELFTEST_ITEM_COUNT; i++) {
+        if (report.failMask & (1u << i)) {
+            platform_serial_print(first ? "\"" : ",\"");
+            platform_serial_print(self_test_item_name(i));
+            platform_serial_print("\"");
+            first = false;
+        }
+    }
+    platform_serial_print("],\"ms\":");
+    platform_serial_print(report.durationMs);
+    platform_serial_print(",\"stall_us\":[");
+    platform_serial_print(report.nvmStallFlashUs);
+    platform_serial_print(",");
+    platform_serial_print(report.nvmStallRamUs);
+    platform_serial_println("]}");
+    platform_serial_flush();
+}
+
+void UsbCommandHandler::publishSelfTestBusy()
+{
+    sendError("selftest busy");
+}
+
+// ========= power report =========
+
+bool UsbCommandHandler::takePowerRequest()
+{
+    bool requested = _powerRequested;
+    _powerRequested = false;
+    return requested;
+}
+
+static void printPeriphList(uint32_t mask)
+{
+    platform_serial_print("[");
+    bool first = true;
+    for (uint8_t i = 0; i < PLATFORM_PERIPH_COUNT; i++) {
+        if (mask & (1u << i)) {
+            platform_serial_print(first ? "\"" : ",\"");
+            platform_serial_print(platform_power_periph_name(i));
+            platform_serial_print("\"");
+            first = false;
+        }
+    }
+    platform_serial_print("]");
+}
+
+void UsbCommandHandler::publishPower(const char* const* stateNames, uint8_t stateCount)
+{
+    platform_serial_print("{\"event\":\"power\",\"usb\":\"");
+    platform_serial_print(platform_usb_state_name(platform_usb_state()));
+    platform_serial_print("\",\"supply\":\"");
+    platform_serial_print(platform_usb_supply_name(platform_usb_supply()));
+    platform_serial_print("\",\"active\":");
+    printPeriphList(platform_power_active_mask());
+    platform_serial_print(",\"states\":{");
+    for (uint8_t i = 0; i < stateCount; i++) {
+        platform_serial_print(i == 0 ? "\"" : ",\"");
+        platform_serial_print(stateNames[i]);
+        platform_serial_print("\":");
+        printPeriphList(platform_power_state_mask(i));
+    }
+    platform_serial_println("}}");
+    platform_serial_flush();
+}
+
+// ========= storage image transfer =========
+
+void UsbCommandHandler::printImageError(const char* msg)
+{
+    send(SCHEMA_IMAGE_ERROR, ImageErrorResponse{ msg, (uint32_t)_image.next() });
+}
+
+void UsbCommandHandler::cmdImageBegin(IStorage& storage)
+{
+    if (!storage.hasSecretKey()) {
+        sendError("no_key");
+        return;
+    }
+
+    uint32_t words[IMAGE_NONCE_LEN / 4];
+    if (!platform_rng_read(words, IMAGE_NONCE_LEN / 4)) {
+        sendError("rng");
+        return;
+    }
+    ImageBeginResponse r;
+    memcpy(r.nonce, words, IMAGE_NONCE_LEN);
+    _image.begin(r.nonce);
+
+    r.size = IMAGE_SIZE;
+    r.chunk = IMAGE_CHUNK_MAX;
+    r.next = _image.next();
+    send(SCHEMA_IMAGE_BEGIN, r);
+}
+
+void UsbCommandHandler::cmdImageAuth(IStorage& storage, const char* hmacHex)
+{
+    uint8_t given[32];
+    if (!_image.hasNonce() || !hmacHex || strlen(hmacHex) != 64 || !hex_decode(hmacHex, given, 32)) {
+        printImageError("image auth args");
+        return;
+    }
+
+    uint8_t msg[IMAGE_AUTH_MSG_LEN];
+    size_t msgLen = image_auth_message_build(msg, storage.state().selfId, _image.nonce());
+    _image.endChallenge();
+
+    uint8_t expected[32];
+    const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (!info || mbedtls_md_hmac(info, storage.getSecretKey(), 32, msg, msgLen, expected) != 0) {
+        printImageError("hmac_failed");
+        return;
+    }
+
+    // Constant time: do not leak how many leading bytes matched
+    uint8_t diff = 0;
+    for (size_t i = 0; i < 32; i++) {
+        diff |= given[i] ^ expected[i];
+    }
+    if (diff != 0) {
+        printImageError("image auth");
+        return;
+    }
+    _image.authorize();
+
+    send(SCHEMA_IMAGE_AUTH, ImageAuthResponse{ true, (uint32_t)_image.next() });
+}
+
+void UsbCommandHandler::cmdImageRead(IStorage& storage, const char* offTok, const char* lenTok)
+{
+    if (!_image.isAuthorized()) {
+        printImageError("image auth");
+        return;
+    }
+    uint32_t offset, len;
+    if (!parseUint(offTok, 10, offset) || !parseUint(lenTok, 10, len) ||
+        !ImageTransfer::isValidChunk(offset, len) || storage.imageSize() != IMAGE_SIZE) {
+        printImageError("image range");
+        return;
+    }
+
+    uint8_t chunk[IMAGE_CHUNK_MAX];
+    if (!storage.readImage(offset, chunk, len)) {
+        printImageError("image read");
+        return;
+    }
+
+    // Header reply, then exactly len raw bytes
+    ImageDataResponse r;
+    r.off = offset;
+    r.len = len;
+    uint32_t crc = crc32_stm32_sw(chunk, len);
+    r.crc[0] = (uint8_t)(crc >> 24);
+    r.crc[1] = (uint8_t)(crc >> 16);
+    r.crc[2] = (uint8_t)(crc >> 8);
+    r.crc[3] = (uint8_t)crc;
+    send(SCHEMA_IMAGE_DATA, r, false);
+    platform_serial_write(chunk, len);
+    platform_serial_flush();
+}
+
+void UsbCommandHandler::cmdImageWrite(const char* offTok, const char* lenTok, const char* crcTok)
+{
+    if (!_image.isAuthorized()) {
+        printImageError("image auth");
+        return;
+    }
+    uint32_t offset, len, crc;
+    if (!parseUint(offTok, 10, offset) || !parseUint(lenTok, 10, len) || !parseUint(crcTok, 16, crc) ||
+        !_image.canWrite(offset, len)) {
+        printImageError("image range");
+        return;
+    }
+
+    _imageRxOffset = offset;
+    _imageRxLen = len;
+    _imageRxPos = 0;
+    _imageRxCrc = crc;
+    _imageRxLastMs = platform_millis();
+}
+
+void UsbCommandHandler::pollImageWrite()
+{
+    if (platform_millis() - _imageRxLastMs > IMAGE_RX_TIMEOUT_MS) {
+        _imageRxLen = 0;
+        _image.dropChunk(_imageRxOffset);
+        printImageError("image timeout");
+    }
+}
+
+void UsbCommandHandler::finishImageWrite()
+{
+    size_t offset = _imageRxOffset;
+    size_t len = _imageRxLen;
+    _imageRxLen = 0;
+
+    if (!_image.finishChunk(offset, len, _imageRxCrc)) {
+        printImageError("image crc");
+        return;
+    }
+    send(SCHEMA_IMAGE_ACK, ImageAckResponse{ (uint32_t)_image.next() });
+}
+
+void UsbCommandHandler::cmdImageCommit(IStorage& storage)
+{
+    if (!_image.isAuthorized()) {
+        printImageError("image auth");
+        return;
+    }
+    if (!_image.isComplete()) {
+        printImageError("image incomplete");
+        return;
+    }
+
+    bool ok = storage.restoreImage(_image.stage(), IMAGE_SIZE);
+    _image.reset();
+    if (!ok) {
+        printImageError("image invalid");
+        return;
+    }
+
+    auto& st = storage.state();
+    send(SCHEMA_IMAGE_COMMIT, ImageCommitResponse{ true, st.totalTapCount, st.linkCount });
+}
+
+// ========= reply encoding =========
+
+void UsbCommandHandler::sendEncoded(const ResponseSchema& schema, const void* values, bool flush)
+{
+    uint8_t out[RESPONSE_MAX_LEN];
+    size_t len = response_encode(schema, values, _format, out, sizeof(out));
+    if (len == 0) {
+        // A schema outgrew RESPONSE_MAX_LEN; fail loudly rather than truncate
+        ErrorResponse err = { "reply too long" };
+        len = response_encode(SCHEMA_ERROR.schema, &err, _format, out, sizeof(out));
+    }
+    platform_serial_write(out, len);
+    if (flush) {
+        platform_serial_flush();
+    }
+}
+
+void UsbCommandHandler::sendError(const char* msg)
+{
+    send(SCHEMA_ERROR, ErrorResponse{ msg });
+}
+
+void UsbCommandHandler::cmdFormat(const char* modeTok)
+{
+    if (modeTok) {
+        if (strcmp(modeTok, "JSON") == 0 || strcmp(modeTok, "json") == 0) {
+            _format = RESPONSE_JSON;
+        } else if (strcmp(modeTok, "BIN") == 0 || strcmp(modeTok, "bin") == 0) {
+            _format = RESPONSE_BINARY;
+        } else {
+            sendError("FORMAT args");
+            return;
+        }
+    }
+    send(SCHEMA_FORMAT, FormatResponse{ _format == RESPONSE_BINARY ? "bin" : "json" });
+}
+
+void UsbCommandHandler::cmdSchema()
+{
+    // Always JSON: this is how a host learns to decode the binary frames
+    uint8_t out[RESPONSE_MAX_LEN];
+    for (size_t i = 0; i < RESPONSE_SCHEMA_COUNT; i++) {
+        size_t len = response_describe(*RESPONSE_SCHEMAS[i], out, sizeof(out));
+        platform_serial_write(out, len);
+    }
     platform_serial_flush();
 }
@@ -56,9 +56,15 @@ public:
     virtual void clearAll() = 0;
     virtual bool addLink(const uint8_t peerId[DEVICE_UID_LEN]) = 0;
     virtual bool hasLink(const uint8_t peerId[DEVICE_UID_LEN]) const = 0;
+    virtual uint32_t getLinkGeneration() const = 0;
     virtual void incrementTapCount() = 0;
     virtual void saveTapCountOnly() = 0;
     virtual void saveLinkOnly() = 0;
+    virtual void beginTransaction() = 0;
+    virtual bool commitTransaction() = 0;
+    virtual size_t imageSize() const = 0;
+    virtual bool readImage(size_t offset, uint8_t* out, size_t len) = 0;
+    virtual bool restoreImage(const uint8_t* image, size_t len) = 0;
 };
 
 // =====================================================
@@ -77,6 +83,7 @@ public:
         memset(_secretKey, 0, sizeof(_secretKey));
         _keyVersion = 0;
         _dirty = false;
+        _linkGeneration = 0;
         
         // Reset call counters
         beginCalled = false;
@@ -88,6 +95,10 @@ public:
         incrementTapCountCalled = false;
         saveTapCountOnlyCalled = false;
         saveLinkOnlyCalled = false;
+        transactionDepth = 0;
+        commitCount = 0;
+        deferredSaveCount = 0;
+        restoreCount = 0;
     }
 
     // =====================================================
@@ -145,6 +156,7 @@ public:
         memcpy(selfId, _payload.selfId, DEVICE_UID_LEN);
         memset(&_payload, 0, sizeof(_payload));
         memcpy(_payload.selfId, selfId, DEVICE_UID_LEN);
+        _linkGeneration++;
         _dirty = true;
     }
 
@@ -157,6 +169,7 @@ public:
         uint16_t idx = _payload.linkCount;
         if (idx >= PersistPayloadV1::MAX_LINKS) {
             idx = idx % PersistPayloadV1::MAX_LINKS;
+            _linkGeneration++;
         } else {
             _payload.linkCount++;
         }
@@ -180,6 +193,10 @@ public:
         return false;
     }
 
+    uint32_t getLinkGeneration() const override {
+        return _linkGeneration;
+    }
+
     void incrementTapCount() override {
         incrementTapCountCalled = true;
         _payload.totalTapCount++;
@@ -188,12 +205,58 @@ public:
 
     void saveTapCountOnly() override {
         saveTapCountOnlyCalled = true;
+        if (transactionDepth > 0) {
+            deferredSaveCount++;
+            return;
+        }
         _dirty = false;
     }
 
     void saveLinkOnly() override {
         saveLinkOnlyCalled = true;
+        if (transactionDepth > 0) {
+            deferredSaveCount++;
+            return;
+        }
+        _dirty = false;
+    }
+
+    void beginTransaction() override {
+        transactionDepth++;
+    }
+
+    bool commitTransaction() override {
+        if (transactionDepth == 0) return false;
+        if (--transactionDepth > 0) return true;
+        if (deferredSaveCount > 0) {
+            commitCount++;
+            deferredSaveCount = 0;
+            _dirty = false;
+        }
+        return true;
+    }
+
+    // The mock's image is just the payload (no header/CRC)
+    size_t imageSize() const override {
+        return sizeof(_payload);
+    }
+
+    bool readImage(size_t offset, uint8_t* out, size_t len) override {
+        if (offset > sizeof(_payload) || len > sizeof(_payload) - offset) return false;
+        memcpy(out, reinterpret_cast<const uint8_t*>(&_payload) + offset, len);
+        return true;
+    }
+
+    bool restoreImage(const uint8_t* image, size_t len) override {
+        if (len != sizeof(_payload)) return false;
+        uint8_t selfId[DEVICE_UID_LEN];
+        memcpy(selfId, _payload.selfId, DEVICE_UID_LEN);
+        memcpy(&_payload, image, sizeof(_payload));
+        memcpy(_payload.selfId, selfId, DEVICE_UID_LEN);
+        _linkGeneration++;
+        restoreCount++;
         _dirty = false;
+        return true;
     }
 
     // =====================================================
@@ -220,10 +283,15 @@ public:
     bool incrementTapCountCalled;
     bool saveTapCountOnlyCalled;
     bool saveLinkOnlyCalled;
+    int transactionDepth;
+    int commitCount;          // Outermost commits that wrote deferred saves
+    int deferredSaveCount;    // Partial saves waiting for commit
+    int restoreCount;
 
 private:
     PersistPayloadV1 _payload;
     uint8_t _secretKey[32];
     uint8_t _keyVersion;
     bool _dirty;
+    uint32_t _linkGeneration;
 };
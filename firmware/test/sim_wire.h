@@ -0,0 +1,201 @@
+#pragma once
+// =====================================================
+// Simulated Tap Wire for Unit Testing
+// =====================================================
+// Two IOneWireHal ports on one open-drain line with a
+// pull-up. Each side runs in its own thread, in simulated
+// time: only the side that is furthest behind runs, so
+// every read sees the other side's drive exactly as it was
+// at that instant. Nothing waits in real time.
+//
+// - Clocks can be skewed per port (setSkewPpm)
+// - Faults: line held low for a while (holdLow), sides
+//   stop seeing each other (cutAt)
+// - Every drive change is traced for timing checks
+//
+// Scripted sides should wait with waitLine() rather than
+// poll: it sleeps until the line actually changes.
+//
+// Usage:
+//   SimWire wire;
+//   wire.run([&](SimWire::Port& a) { ...card under test... },
+//            [&](SimWire::Port& b) { ...scripted peer... }, 5000000);
+// =====================================================
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tap_link_hal.h"
+
+class SimWire {
+public:
+    // Thrown inside a side once the run's time limit is reached
+    struct Timeout {};
+
+    struct Edge {
+        uint64_t ns;     // true time
+        uint8_t port;
+        bool low;        // port started (true) or stopped driving low
+    };
+
+    class Port : public IOneWireHal {
+    public:
+        bool readLine() override { return _wire->lineFor(*this); }
+        void driveLow(bool enableLow) override { _wire->setDrive(*this, enableLow); }
+
+        // Each read costs a microsecond, so polling loops make progress
+        uint32_t micros() override {
+            _wire->advance(*this, _t + toTrueNs(1));
+            return (uint32_t)localUs();
+        }
+        void delayMicros(uint32_t us) override { _wire->advance(*this, _t + toTrueNs(us)); }
+
+        // Sleep until the line reads high (or low). Returns false if
+        // timeoutUs of local time passes first.
+        bool waitLine(bool high, uint32_t timeoutUs) {
+            uint64_t deadline = _t + toTrueNs(timeoutUs);
+            while (readLine() != high) {
+                if (_t >= deadline) {
+                    return false;
+                }
+                uint64_t edge = _wire->nextFaultEdge(_t);
+                _waitingFor = high ? 1 : 0;
+                _wire->advance(*this, edge < deadline ? edge : deadline);
+                _waitingFor = -1;
+            }
+            return true;
+        }
+
+        // + = this clock runs slow (a local microsecond lasts longer)
+        void setSkewPpm(int32_t ppm) { _ppm = ppm; }
+
+        uint64_t nowNs() const { return _t; }
+        uint64_t localUs() const { return _t * 1000 / (uint64_t)(1000000 + _ppm); }
+        bool isDrivingLow() const { return _low; }
+
+    private:
+        friend class SimWire;
+
+        uint64_t toTrueNs(uint64_t us) const { return us * (uint64_t)(1000000 + _ppm) / 1000; }
+
+        SimWire* _wire = nullptr;
+        uint8_t _index = 0;
+        uint64_t _t = 0;           // true time; while parked, when it resumes
+        int32_t _ppm = 0;
+        bool _low = false;
+        bool _done = false;
+        int _waitingFor = -1;      // waitLine() level, -1 = not waiting
+    };
+
+    SimWire() {
+        for (uint8_t i = 0; i < 2; i++) {
+            _ports[i]._wire = this;
+            _ports[i]._index = i;
+        }
+    }
+
+    Port& port(uint8_t i) { return _ports[i]; }
+
+    // Line held low for [fromUs, toUs) of true time
+    void holdLow(uint64_t fromUs, uint64_t toUs) {
+        _holdFromNs = fromUs * 1000;
+        _holdToNs = toUs * 1000;
+    }
+
+    // From atUs on, each side only sees its own drive and the pull-up
+    void cutAt(uint64_t atUs) { _cutNs = atUs * 1000; }
+
+    const std::vector<Edge>& edges() const { return _edges; }
+
+    // Run both sides to completion, or until limitUs of true time
+    template <typename SideA, typename SideB>
+    void run(SideA sideA, SideB sideB, uint64_t limitUs) {
+        _limitNs = limitUs * 1000;
+        _current = 0;
+        std::thread a([&] { side(_ports[0], sideA); });
+        std::thread b([&] { side(_ports[1], sideB); });
+        a.join();
+        b.join();
+    }
+
+private:
+    template <typename Fn>
+    void side(Port& p, Fn& fn) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [&] { return _current == p._index; });
+        }
+        try {
+            fn(p);
+        } catch (const Timeout&) {
+        }
+        p._low = false;
+        p._done = true;
+        std::lock_guard<std::mutex> lock(_mutex);
+        _current = other(p)._index;
+        _cv.notify_all();
+    }
+
+    Port& other(const Port& p) { return _ports[p._index ^ 1]; }
+
+    bool lineFor(const Port& p) const { return lineAt(p, p._t); }
+
+    // The line as p sees it at time t
+    bool lineAt(const Port& p, uint64_t t) const {
+        const Port& o = _ports[p._index ^ 1];
+        bool low = p._low || (o._low && t < _cutNs) || (t >= _holdFromNs && t < _holdToNs);
+        return !low;
+    }
+
+    uint64_t nextFaultEdge(uint64_t t) const {
+        uint64_t next = UINT64_MAX;
+        const uint64_t edges[] = { _holdFromNs, _holdToNs, _cutNs };
+        for (uint64_t e : edges) {
+            if (e > t && e < next) next = e;
+        }
+        return next;
+    }
+
+    void setDrive(Port& p, bool low) {
+        if (p._low == low) {
+            return;
+        }
+        p._low = low;
+        _edges.push_back({ p._t, p._index, low });
+
+        // Wake the other side now if it was waiting for this level
+        Port& o = other(p);
+        if (o._waitingFor >= 0 && !o._done && p._t < o._t &&
+            lineAt(o, p._t) == (o._waitingFor == 1)) {
+            o._t = p._t;
+        }
+    }
+
+    // Move p to target, then let the other side catch up if p is ahead
+    void advance(Port& p, uint64_t target) {
+        if (target > _limitNs) {
+            p._t = _limitNs;
+            throw Timeout();
+        }
+        p._t = target;
+        Port& o = other(p);
+        while (!o._done && p._t > o._t) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _current = o._index;
+            _cv.notify_all();
+            _cv.wait(lock, [&] { return _current == p._index; });
+        }
+    }
+
+    Port _ports[2];
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    uint8_t _current = 0;
+    uint64_t _limitNs = 0;
+    uint64_t _holdFromNs = UINT64_MAX;
+    uint64_t _holdToNs = UINT64_MAX;
+    uint64_t _cutNs = UINT64_MAX;
+    std::vector<Edge> _edges;
+};
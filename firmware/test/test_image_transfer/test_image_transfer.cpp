@@ -0,0 +1,153 @@
+// =====================================================
+// Image Transfer Unit Tests
+// =====================================================
+// Chunk bounds, resume and CRC fallback of the IMAGE_*
+// staging buffer, plus the IMAGE_AUTH message layout.
+//
+// Run with: pio test -e native
+// =====================================================
+
+#include <unity.h>
+
+#include "../../src/crc32.cpp"
+#include "../../src/image_transfer.cpp"
+
+// =====================================================
+// Test Fixtures
+// =====================================================
+
+static ImageTransfer xfer;
+static uint8_t source[IMAGE_SIZE];
+
+void setUp() {
+    xfer.reset();
+    for (size_t i = 0; i < IMAGE_SIZE; ++i) {
+        source[i] = (uint8_t)(i * 7 + 3);
+    }
+}
+
+void tearDown() {
+    // Nothing to clean up
+}
+
+// Stage one chunk the way UsbCommandHandler does
+static bool sendChunk(size_t offset, size_t len, bool corrupt = false) {
+    if (!xfer.canWrite(offset, len)) {
+        return false;
+    }
+    uint32_t crc = crc32_stm32_sw(source + offset, len);
+    memcpy(xfer.chunkTarget(offset), source + offset, len);
+    if (corrupt) {
+        xfer.chunkTarget(offset)[len / 2] ^= 0x01;
+    }
+    return xfer.finishChunk(offset, len, crc);
+}
+
+// =====================================================
+// Test Cases
+// =====================================================
+
+void test_chunk_bounds() {
+    TEST_ASSERT_TRUE(ImageTransfer::isValidChunk(0, 4));
+    TEST_ASSERT_TRUE(ImageTransfer::isValidChunk(0, IMAGE_CHUNK_MAX));
+    TEST_ASSERT_TRUE(ImageTransfer::isValidChunk(IMAGE_SIZE - 4, 4));
+
+    TEST_ASSERT_FALSE(ImageTransfer::isValidChunk(0, 0));
+    TEST_ASSERT_FALSE(ImageTransfer::isValidChunk(0, 6));                  // not whole words
+    TEST_ASSERT_FALSE(ImageTransfer::isValidChunk(2, 4));                  // unaligned
+    TEST_ASSERT_FALSE(ImageTransfer::isValidChunk(0, IMAGE_CHUNK_MAX + 4));
+    TEST_ASSERT_FALSE(ImageTransfer::isValidChunk(IMAGE_SIZE - 4, 8));     // runs off the end
+    TEST_ASSERT_FALSE(ImageTransfer::isValidChunk(IMAGE_SIZE, 4));
+}
+
+void test_full_transfer_completes() {
+    size_t offset = 0;
+    while (offset < IMAGE_SIZE) {
+        size_t len = IMAGE_SIZE - offset;
+        if (len > IMAGE_CHUNK_MAX) len = IMAGE_CHUNK_MAX;
+        TEST_ASSERT_TRUE(sendChunk(offset, len));
+        offset += len;
+        TEST_ASSERT_EQUAL(offset, xfer.next());
+    }
+    TEST_ASSERT_TRUE(xfer.isComplete());
+    TEST_ASSERT_EQUAL_MEMORY(source, xfer.stage(), IMAGE_SIZE);
+}
+
+void test_write_cannot_skip_ahead() {
+    TEST_ASSERT_FALSE(xfer.canWrite(8, 4));
+    TEST_ASSERT_TRUE(sendChunk(0, 8));
+    TEST_ASSERT_TRUE(xfer.canWrite(8, 4));
+    TEST_ASSERT_FALSE(xfer.canWrite(12, 4));
+
+    // Rewriting earlier data is allowed and does not move next() back
+    TEST_ASSERT_TRUE(sendChunk(0, 4));
+    TEST_ASSERT_EQUAL(8, xfer.next());
+}
+
+void test_crc_mismatch_falls_back() {
+    TEST_ASSERT_TRUE(sendChunk(0, 64));
+    TEST_ASSERT_TRUE(sendChunk(64, 64));
+    TEST_ASSERT_FALSE(sendChunk(32, 64, true));
+    TEST_ASSERT_EQUAL(32, xfer.next());
+
+    // Host resends from next() and carries on
+    TEST_ASSERT_TRUE(sendChunk(32, 64));
+    TEST_ASSERT_EQUAL(96, xfer.next());
+}
+
+void test_dropped_chunk_resumes_at_start() {
+    TEST_ASSERT_TRUE(sendChunk(0, 128));
+    xfer.dropChunk(64);
+    TEST_ASSERT_EQUAL(64, xfer.next());
+
+    // A drop past next() changes nothing
+    xfer.dropChunk(100);
+    TEST_ASSERT_EQUAL(64, xfer.next());
+}
+
+void test_begin_keeps_staged_data() {
+    uint8_t nonce[IMAGE_NONCE_LEN] = {};
+    TEST_ASSERT_TRUE(sendChunk(0, 64));
+    xfer.authorize();
+
+    nonce[0] = 0x5A;
+    xfer.begin(nonce);
+    TEST_ASSERT_TRUE(xfer.hasNonce());
+    TEST_ASSERT_FALSE(xfer.isAuthorized());
+    TEST_ASSERT_EQUAL(64, xfer.next());
+    TEST_ASSERT_EQUAL_MEMORY(source, xfer.stage(), 64);
+
+    xfer.endChallenge();
+    TEST_ASSERT_FALSE(xfer.hasNonce());
+}
+
+void test_auth_message_layout() {
+    uint8_t selfId[DEVICE_UID_LEN];
+    uint8_t nonce[IMAGE_NONCE_LEN];
+    for (size_t i = 0; i < DEVICE_UID_LEN; ++i) selfId[i] = (uint8_t)(0x10 + i);
+    for (size_t i = 0; i < IMAGE_NONCE_LEN; ++i) nonce[i] = (uint8_t)(0xA0 + i);
+
+    uint8_t msg[IMAGE_AUTH_MSG_LEN];
+    TEST_ASSERT_EQUAL(IMAGE_AUTH_MSG_LEN, image_auth_message_build(msg, selfId, nonce));
+    TEST_ASSERT_EQUAL_MEMORY("IMG1", msg, 4);
+    TEST_ASSERT_EQUAL_MEMORY(selfId, msg + 4, DEVICE_UID_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(nonce, msg + 4 + DEVICE_UID_LEN, IMAGE_NONCE_LEN);
+}
+
+// =====================================================
+// Test Runner
+// =====================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_chunk_bounds);
+    RUN_TEST(test_full_transfer_completes);
+    RUN_TEST(test_write_cannot_skip_ahead);
+    RUN_TEST(test_crc_mismatch_falls_back);
+    RUN_TEST(test_dropped_chunk_resumes_at_start);
+    RUN_TEST(test_begin_keeps_staged_data);
+    RUN_TEST(test_auth_message_layout);
+
+    return UNITY_END();
+}
@@ -0,0 +1,307 @@
+// =====================================================
+// Portable Kernel Unit Tests
+// =====================================================
+// Hex helpers, software CRC32, link lookup, the compact
+// UID codec, the SIGN_STATE / DUMP / DUMPZ formatters and the
+// schema-driven reply encoder.
+//
+// Run with: pio test -e native
+// =====================================================
+
+#include <unity.h>
+
+// The native env builds no firmware sources; pull in the
+// portable units under test directly.
+#include "../../src/hex_util.cpp"
+#include "../../src/crc32.cpp"
+#include "../../src/link_table.cpp"
+#include "../../src/sync_format.cpp"
+#include "../../src/uid_codec.cpp"
+#include "../../src/response_schema.cpp"
+
+void setUp() {}
+
+void tearDown() {}
+
+// =====================================================
+// Test Cases
+// =====================================================
+
+void test_hex_roundtrip() {
+    const uint8_t in[] = {0x00, 0x0F, 0xA5, 0xFF};
+    char hex[9];
+    hex_encode(in, sizeof(in), hex);
+    TEST_ASSERT_EQUAL_STRING("000FA5FF", hex);
+
+    uint8_t out[4];
+    TEST_ASSERT_TRUE(hex_decode("000fa5FF", out, sizeof(out)));
+    TEST_ASSERT_EQUAL_MEMORY(in, out, sizeof(in));
+
+    TEST_ASSERT_FALSE(hex_decode("000FA5F", out, sizeof(out)));   // length
+    TEST_ASSERT_FALSE(hex_decode("000FA5FG", out, sizeof(out)));  // digit
+}
+
+void test_crc32_matches_stm32_peripheral() {
+    // Reference value of the CRC unit for the single word 0x12345678
+    const uint8_t word[] = {0x78, 0x56, 0x34, 0x12};
+    TEST_ASSERT_EQUAL_HEX32(0xDF8A8A2B, crc32_stm32_sw(word, sizeof(word)));
+    TEST_ASSERT_EQUAL_HEX32(0, crc32_stm32_sw(word, 3));
+}
+
+void test_link_table_find() {
+    LinkRecordV1 links[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        memset(links[i].peerId, i + 1, DEVICE_UID_LEN);
+    }
+    uint8_t peer[DEVICE_UID_LEN];
+    memset(peer, 3, DEVICE_UID_LEN);
+
+    TEST_ASSERT_EQUAL(2, link_table_find(links, 3, peer));
+    TEST_ASSERT_EQUAL(-1, link_table_find(links, 2, peer));
+}
+
+void test_sign_message_layout() {
+    uint8_t selfId[DEVICE_UID_LEN];
+    memset(selfId, 0xAA, DEVICE_UID_LEN);
+    const uint8_t nonce[] = {1, 2, 3};
+    LinkRecordV1 links[2];
+    memset(links[0].peerId, 0x11, DEVICE_UID_LEN);
+    memset(links[1].peerId, 0x22, DEVICE_UID_LEN);
+
+    uint8_t msg[SIGN_MSG_MAX_LEN];
+    size_t len = sign_message_build(msg, selfId, nonce, sizeof(nonce), 0x01020304, links, 2);
+
+    TEST_ASSERT_EQUAL(DEVICE_UID_LEN + 3 + 4 + 2 + 2 * DEVICE_UID_LEN, len);
+    TEST_ASSERT_EQUAL_MEMORY(selfId, msg, DEVICE_UID_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(nonce, msg + 12, 3);
+    const uint8_t counts[] = {0x04, 0x03, 0x02, 0x01, 0x02, 0x00};
+    TEST_ASSERT_EQUAL_MEMORY(counts, msg + 15, sizeof(counts));
+    TEST_ASSERT_EQUAL_MEMORY(links[1].peerId, msg + len - DEVICE_UID_LEN, DEVICE_UID_LEN);
+}
+
+void test_sync_header_layout() {
+    uint8_t selfId[DEVICE_UID_LEN];
+    memset(selfId, 0xAA, DEVICE_UID_LEN);
+    const uint8_t nonce[] = {1, 2, 3};
+
+    uint8_t msg[SYNC_HEADER_MAX_LEN];
+    size_t len = sync_header_build(msg, selfId, nonce, sizeof(nonce), 0x01020304, 5, 2, 0x0A0B0C0D);
+
+    TEST_ASSERT_EQUAL(4 + DEVICE_UID_LEN + 3 + 4 + 2 + 2 + 4, len);
+    TEST_ASSERT_EQUAL_MEMORY("SYNC", msg, 4);
+    TEST_ASSERT_EQUAL_MEMORY(selfId, msg + 4, DEVICE_UID_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(nonce, msg + 16, 3);
+    const uint8_t counts[] = {0x04, 0x03, 0x02, 0x01, 0x05, 0x00, 0x02, 0x00, 0x0D, 0x0C, 0x0B, 0x0A};
+    TEST_ASSERT_EQUAL_MEMORY(counts, msg + 19, sizeof(counts));
+}
+
+void test_dump_format_item() {
+    const uint8_t peer[DEVICE_UID_LEN] = {0x0E, 0x47, 0x31, 0x34, 0x39, 0x35,
+                                          0x35, 0x39, 0x00, 0x18, 0x00, 0x40};
+    char item[DUMP_ITEM_MAX_LEN];
+    size_t len = dump_format_item(item, peer);
+    TEST_ASSERT_EQUAL_STRING("{\"peer\":\"0E4731343935353900180040\"}", item);
+    TEST_ASSERT_EQUAL(DUMP_ITEM_MAX_LEN - 1, len);
+}
+
+void test_link_export_layout() {
+    // Arrival order C, A, B; A and B differ only in the last byte
+    LinkRecordV1 links[3];
+    const uint8_t c[DEVICE_UID_LEN] = {0x0E, 0x47, 0x31, 0x34, 0x39, 0x35,
+                                       0x35, 0x39, 0x00, 0x44, 0x00, 0x44};
+    const uint8_t a[DEVICE_UID_LEN] = {0x0E, 0x47, 0x31, 0x34, 0x39, 0x35,
+                                       0x35, 0x39, 0x00, 0x18, 0x00, 0x40};
+    memcpy(links[0].peerId, c, DEVICE_UID_LEN);
+    memcpy(links[1].peerId, a, DEVICE_UID_LEN);
+    memcpy(links[2].peerId, a, DEVICE_UID_LEN);
+    links[2].peerId[11] = 0x52;
+
+    // Same bytes as utils/link_export.py
+    const uint8_t expected[] = {
+        0x01, 0x03,
+        0x0C, 0x0E, 0x47, 0x31, 0x34, 0x39, 0x35, 0x35, 0x39, 0x00, 0x18, 0x00, 0x40,
+        0x01, 0x52,
+        0x03, 0x44, 0x00, 0x44,
+        0x01, 0x02, 0x00
+    };
+    uint8_t out[LINK_EXPORT_MAX_LEN];
+    size_t len = link_export_encode(links, 3, out, sizeof(out));
+    TEST_ASSERT_EQUAL(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, len);
+
+    TEST_ASSERT_EQUAL(0, link_export_encode(links, 3, out, len - 1));
+    TEST_ASSERT_EQUAL(2, link_export_encode(links, 0, out, sizeof(out)));
+}
+
+void test_response_json() {
+    SignedStateResponse r = {};
+    for (size_t i = 0; i < DEVICE_UID_LEN; i++) r.device_id[i] = (uint8_t)(0xA0 + i);
+    r.nonce = "0BAD";
+    r.totalTapCount = 4000000000u;
+    r.linkCount = 5;
+    r.keyVersion = 1;
+    r.hmac[31] = 0xFF;
+
+    uint8_t out[RESPONSE_MAX_LEN + 1];
+    size_t len = response_encode(SCHEMA_SIGNED_STATE, r, RESPONSE_JSON, out, RESPONSE_MAX_LEN);
+    out[len] = '\0';
+    // snap is optional and 0: left out
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"event\":\"SIGNED_STATE\",\"device_id\":\"A0A1A2A3A4A5A6A7A8A9AAAB\","
+        "\"nonce\":\"0BAD\",\"totalTapCount\":4000000000,\"linkCount\":5,\"keyVersion\":1,"
+        "\"hmac\":\"00000000000000000000000000000000000000000000000000000000000000FF\"}\r\n",
+        (const char*)out);
+
+    r.snap = 3;
+    len = response_encode(SCHEMA_SIGNED_STATE, r, RESPONSE_JSON, out, RESPONSE_MAX_LEN);
+    out[len] = '\0';
+    TEST_ASSERT_NOT_NULL(strstr((const char*)out, "\"linkCount\":5,\"snap\":3,\"keyVersion\""));
+
+    // Too small a buffer is reported, not truncated
+    TEST_ASSERT_EQUAL(0, response_encode(SCHEMA_SIGNED_STATE, r, RESPONSE_JSON, out, 64));
+}
+
+void test_response_binary() {
+    ImageCommitResponse r = { true, 0x01020304, 0x0506 };
+    uint8_t out[32];
+    size_t len = response_encode(SCHEMA_IMAGE_COMMIT, r, RESPONSE_BINARY, out, sizeof(out));
+    const uint8_t expected[] = {
+        RESPONSE_FRAME_SYNC, 16, 7, 0,   // sync, id, payload length (LE)
+        1,                               // ok
+        0x04, 0x03, 0x02, 0x01,          // totalTapCount
+        0x06, 0x05,                      // linkCount
+    };
+    TEST_ASSERT_EQUAL(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, sizeof(expected));
+
+    // Strings carry a length byte; optional fields are always present
+    AckResponse ack = { "CLEAR", 0 };
+    len = response_encode(SCHEMA_ACK, ack, RESPONSE_BINARY, out, sizeof(out));
+    const uint8_t ackExpected[] = { RESPONSE_FRAME_SYNC, 2, 7, 0, 5, 'C', 'L', 'E', 'A', 'R', 0 };
+    TEST_ASSERT_EQUAL(sizeof(ackExpected), len);
+    TEST_ASSERT_EQUAL_MEMORY(ackExpected, out, sizeof(ackExpected));
+}
+
+void test_response_schemas_fit() {
+    // Worst case of every reply must fit RESPONSE_MAX_LEN in both formats
+    static char longStr[65];
+    memset(longStr, '9', 64);
+
+    uint8_t out[RESPONSE_MAX_LEN];
+    for (size_t i = 0; i < RESPONSE_SCHEMA_COUNT; i++) {
+        const ResponseSchema& s = *RESPONSE_SCHEMAS[i];
+        uint8_t values[256];
+        memset(values, 0xFF, sizeof(values));
+        for (uint8_t f = 0; f < s.fieldCount; f++) {
+            if (s.fields[f].type == RF_STR) {
+                const char* p = longStr;
+                memcpy(values + s.fields[f].offset, &p, sizeof(p));
+            } else if (s.fields[f].type == RF_BOOL) {
+                values[s.fields[f].offset] = 1;
+            }
+        }
+        TEST_ASSERT_NOT_EQUAL(0, response_encode(s, values, RESPONSE_JSON, out, sizeof(out)));
+        TEST_ASSERT_NOT_EQUAL(0, response_encode(s, values, RESPONSE_BINARY, out, sizeof(out)));
+        TEST_ASSERT_NOT_EQUAL(0, response_describe(s, out, sizeof(out)));
+    }
+
+    char digits[10];
+    TEST_ASSERT_EQUAL(1, response_format_u32(0, digits));
+    TEST_ASSERT_EQUAL(10, response_format_u32(4294967295u, digits));
+    TEST_ASSERT_EQUAL_STRING_LEN("4294967295", digits, 10);
+}
+
+void test_response_template() {
+    // Rendering must match a full encode whatever the hole values
+    const StateResponse values[] = { { 0, 0 }, { 7, 12 }, { 4294967295u, 65535 } };
+    const ResponseFormat formats[] = { RESPONSE_JSON, RESPONSE_BINARY };
+    for (ResponseFormat format : formats) {
+        ResponseTemplate<StateResponse, 64> t;
+        TEST_ASSERT_FALSE(t.builtFor(format));
+        TEST_ASSERT_TRUE(t.build(SCHEMA_STATE, values[1], 0x3, format));
+        TEST_ASSERT_TRUE(t.builtFor(format));
+        for (const StateResponse& v : values) {
+            uint8_t expected[80], out[80];
+            size_t len = response_encode(SCHEMA_STATE, v, format, expected, sizeof(expected));
+            TEST_ASSERT_EQUAL(len, t.render(v, out, sizeof(out)));
+            TEST_ASSERT_EQUAL_MEMORY(expected, out, len);
+        }
+    }
+
+    // No holes: the cached reply as built
+    HelloResponse hello = { {0xAB}, "1.2.3", "2026-01-02T15:30:45Z", "abc1234" };
+    ResponseTemplate<HelloResponse, 128> h;
+    TEST_ASSERT_TRUE(h.build(SCHEMA_HELLO, hello, 0, RESPONSE_JSON));
+    uint8_t expected[RESPONSE_MAX_LEN];
+    size_t len = response_encode(SCHEMA_HELLO, hello, RESPONSE_JSON, expected, sizeof(expected));
+    TEST_ASSERT_EQUAL(len, h.info.len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, h.text, len);
+
+    // Strings and optional fields cannot be holes; too small does not build
+    TEST_ASSERT_FALSE(h.build(SCHEMA_HELLO, hello, 0x2, RESPONSE_JSON));
+    ResponseTemplate<AckResponse, 64> ack;
+    TEST_ASSERT_FALSE(ack.build(SCHEMA_ACK, AckResponse{ "CLEAR", 1 }, 0x2, RESPONSE_JSON));
+    ResponseTemplate<StateResponse, 16> small;
+    TEST_ASSERT_FALSE(small.build(SCHEMA_STATE, values[0], 0x3, RESPONSE_JSON));
+    TEST_ASSERT_EQUAL(0, small.render(values[0], expected, sizeof(expected)));
+}
+
+void test_uid_compact_same_batch() {
+    // Two cards from one lot (see utils/provision_keys.json)
+    const uint8_t uid[DEVICE_UID_LEN]  = {0x0E, 0x47, 0x31, 0x34, 0x39, 0x35,
+                                          0x35, 0x39, 0x00, 0x18, 0x00, 0x40};
+    const uint8_t dict[DEVICE_UID_LEN] = {0x0F, 0x47, 0x31, 0x34, 0x39, 0x35,
+                                          0x35, 0x39, 0x00, 0x44, 0x00, 0x44};
+    uint8_t frame[UID_COMPACT_MAX_LEN];
+    size_t len = uid_compact_encode(uid, dict, frame);
+
+    // Same frame as utils/uid_codec.py: lot shared, wafer + two 1-byte coords
+    const uint8_t expected[] = {0x43, 0x0E, 0x18, 0x40};
+    TEST_ASSERT_EQUAL(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, frame, len);
+
+    uint8_t out[DEVICE_UID_LEN];
+    TEST_ASSERT_TRUE(uid_compact_decode(frame, len, dict, out));
+    TEST_ASSERT_EQUAL_MEMORY(uid, out, DEVICE_UID_LEN);
+    TEST_ASSERT_FALSE(uid_compact_decode(frame, len - 1, dict, out));
+}
+
+void test_uid_compact_raw_fallback() {
+    uint8_t uid[DEVICE_UID_LEN];
+    uint8_t dict[DEVICE_UID_LEN];
+    memset(uid, 0xFF, DEVICE_UID_LEN);   // large coordinates, other lot
+    memset(dict, 0x00, DEVICE_UID_LEN);
+
+    uint8_t frame[UID_COMPACT_MAX_LEN];
+    size_t len = uid_compact_encode(uid, dict, frame);
+    TEST_ASSERT_EQUAL(UID_COMPACT_MAX_LEN, len);
+    TEST_ASSERT_EQUAL_HEX8(UID_COMPACT_RAW | DEVICE_UID_LEN, frame[0]);
+
+    uint8_t out[DEVICE_UID_LEN];
+    TEST_ASSERT_TRUE(uid_compact_decode(frame, len, dict, out));
+    TEST_ASSERT_EQUAL_MEMORY(uid, out, DEVICE_UID_LEN);
+}
+
+// =====================================================
+// Test Runner
+// =====================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_hex_roundtrip);
+    RUN_TEST(test_crc32_matches_stm32_peripheral);
+    RUN_TEST(test_link_table_find);
+    RUN_TEST(test_sign_message_layout);
+    RUN_TEST(test_sync_header_layout);
+    RUN_TEST(test_dump_format_item);
+    RUN_TEST(test_link_export_layout);
+    RUN_TEST(test_response_json);
+    RUN_TEST(test_response_binary);
+    RUN_TEST(test_response_schemas_fit);
+    RUN_TEST(test_response_template);
+    RUN_TEST(test_uid_compact_same_batch);
+    RUN_TEST(test_uid_compact_raw_fallback);
+
+    return UNITY_END();
+}
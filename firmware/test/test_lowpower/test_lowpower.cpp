@@ -0,0 +1,133 @@
+// =====================================================
+// STOP Policy Unit Tests
+// =====================================================
+// Runs the idle loop's STOP decision (lowpower_policy.h)
+// against a simulated USB attach, millisecond by millisecond.
+// The card stops for up to STOP_MAX_MS whenever the policy
+// allows it; a rising VBUS edge ends the wait when the board
+// senses VBUS, like platform_lowpower_stop(). The host waits
+// out its attach debounce, resets the bus and asks for the
+// device descriptor; the card answers only while awake.
+//
+// Run with: pio test -e native
+// =====================================================
+
+#include <unity.h>
+#include "lowpower_policy.h"
+
+static constexpr uint32_t STOP_MAX_MS = 500;      // Application::STOP_MAX_US
+static constexpr uint32_t ATTACH_DEBOUNCE_MS = 100;
+static constexpr uint32_t RESET_MS = 10;
+static constexpr uint32_t RESET_RECOVERY_MS = 10; // Then GET_DESCRIPTOR is due
+static constexpr uint32_t SIM_MS = 3000;
+
+struct Board {
+    bool senseVbus;
+    bool usbClocked;
+};
+
+struct Result {
+    bool enumerated;       // First GET_DESCRIPTOR answered in time
+    uint32_t stops;        // STOP entries before the host addressed us
+};
+
+// Mirrors platform_usb_supply(): unknown without a sense pin until addressed
+static platform_supply_t supplyFor(const Board& b, bool vbus, bool addressed) {
+    if (b.senseVbus) {
+        return vbus ? PLATFORM_SUPPLY_USB : PLATFORM_SUPPLY_BATTERY;
+    }
+    return addressed ? PLATFORM_SUPPLY_USB : PLATFORM_SUPPLY_UNKNOWN;
+}
+
+static Result simulateAttach(const Board& b, uint32_t attachMs) {
+    Result r = {};
+    bool addressed = false;
+    uint32_t stoppedUntil = 0;
+    bool inStop = false;
+    uint32_t resetStart = attachMs + ATTACH_DEBOUNCE_MS;
+    uint32_t descriptorDue = resetStart + RESET_MS + RESET_RECOVERY_MS;
+    bool missed = false;
+
+    for (uint32_t t = 0; t < SIM_MS; t++) {
+        bool vbus = b.senseVbus ? t >= attachMs : true;
+
+        if (inStop) {
+            bool vbusWake = b.senseVbus && t == attachMs;
+            if (t >= stoppedUntil || vbusWake) {
+                inStop = false;
+            }
+        }
+
+        // The host's bus reset and first request need a running core
+        if (t >= resetStart && t <= descriptorDue && inStop && b.usbClocked) {
+            missed = true;
+        }
+        if (t == descriptorDue && !missed) {
+            addressed = true;
+            r.enumerated = true;
+        }
+
+        if (!inStop) {
+            platform_usb_state_t state = addressed ? PLATFORM_USB_ACTIVE : PLATFORM_USB_NO_HOST;
+            if (lowpower_stop_allowed(b.usbClocked, state, supplyFor(b, vbus, addressed))) {
+                inStop = true;
+                stoppedUntil = t + STOP_MAX_MS;
+                if (!addressed) {
+                    r.stops++;
+                }
+            }
+        }
+    }
+    return r;
+}
+
+// =====================================================
+// Test Cases
+// =====================================================
+
+void test_attached_unaddressed_host_blocks_stop() {
+    TEST_ASSERT_FALSE(lowpower_stop_allowed(true, PLATFORM_USB_NO_HOST, PLATFORM_SUPPLY_USB));
+    TEST_ASSERT_FALSE(lowpower_stop_allowed(true, PLATFORM_USB_NO_HOST, PLATFORM_SUPPLY_UNKNOWN));
+    TEST_ASSERT_FALSE(lowpower_stop_allowed(true, PLATFORM_USB_ACTIVE, PLATFORM_SUPPLY_USB));
+    TEST_ASSERT_FALSE(lowpower_stop_allowed(true, PLATFORM_USB_SUSPENDED, PLATFORM_SUPPLY_USB));
+    TEST_ASSERT_TRUE(lowpower_stop_allowed(true, PLATFORM_USB_NO_HOST, PLATFORM_SUPPLY_BATTERY));
+    TEST_ASSERT_TRUE(lowpower_stop_allowed(false, PLATFORM_USB_NO_HOST, PLATFORM_SUPPLY_UNKNOWN));
+}
+
+void test_attach_during_stop_enumerates_with_vbus_sense() {
+    Board b = { true, true };
+    // Every phase of the STOP windows that run before the cable goes in
+    for (uint32_t attach = 1000; attach < 1000 + STOP_MAX_MS; attach++) {
+        Result r = simulateAttach(b, attach);
+        TEST_ASSERT_TRUE_MESSAGE(r.enumerated, "host reset went unanswered");
+        TEST_ASSERT_TRUE(r.stops > 0);
+    }
+}
+
+void test_attach_enumerates_without_vbus_sense() {
+    Board b = { false, true };
+    for (uint32_t attach = 0; attach < 1000; attach += 7) {
+        Result r = simulateAttach(b, attach);
+        TEST_ASSERT_TRUE(r.enumerated);
+        TEST_ASSERT_EQUAL(0, r.stops);    // Supply unknown: never stops with USB clocked
+    }
+}
+
+void test_no_usb_stack_still_stops() {
+    Board b = { false, false };
+    Result r = simulateAttach(b, SIM_MS);   // No host ever
+    TEST_ASSERT_TRUE(r.stops > 0);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_attached_unaddressed_host_blocks_stop);
+    RUN_TEST(test_attach_during_stop_enumerates_with_vbus_sense);
+    RUN_TEST(test_attach_enumerates_without_vbus_sense);
+    RUN_TEST(test_no_usb_stack_still_stops);
+    return UNITY_END();
+}
@@ -0,0 +1,184 @@
+// =====================================================
+// Self-Test Unit Tests
+// =====================================================
+// Runs self_test_run() against fake pins, EEPROM and
+// hardware probes, injecting one fault at a time.
+//
+// Run with: pio test -e native
+// =====================================================
+
+#include <unity.h>
+#include "../virtual_clock.h"
+
+#include "../../src/platform_timing.cpp"
+#include "../../src/crc32.cpp"
+#include "../../src/self_test.cpp"
+
+// =====================================================
+// Fakes
+// =====================================================
+
+static constexpr uint32_t LED_PINS[] = { 13, 12 };
+static constexpr uint32_t BUZZER_PIN = 7;
+static constexpr size_t SCRATCH = 2044;
+
+static bool g_pinLevel[64];
+static uint32_t g_stuckPin;          // Pin that always reads HIGH (0 = none)
+static uint8_t g_eeprom[2048];
+static uint8_t g_eepromStuckBits;    // OR-ed into the scratch word's first byte
+static bool g_rngStuck;
+static uint32_t g_toneCount;
+
+void platform_gpio_pin_mode(uint32_t, platform_gpio_mode_t) {}
+bool platform_gpio_read(uint32_t pin) { return pin == g_stuckPin || g_pinLevel[pin]; }
+void platform_gpio_write(uint32_t pin, platform_gpio_state_t state) {
+    g_pinLevel[pin] = (state == PLATFORM_GPIO_HIGH);
+}
+
+void platform_buzzer_init(uint32_t) {}
+void platform_buzzer_tone(uint32_t) { g_toneCount++; }
+void platform_buzzer_stop() {}
+
+uint8_t platform_storage_read(size_t address) { return g_eeprom[address]; }
+void platform_storage_write_block(size_t address, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        g_eeprom[address + i] = data[i] | (address + i == SCRATCH ? g_eepromStuckBits : 0);
+    }
+}
+
+bool platform_rng_read(uint32_t* out, size_t n) {
+    uint32_t x = 0x12345678;
+    for (size_t i = 0; i < n; i++) {
+        if (!g_rngStuck) {
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        }
+        out[i] = x;
+    }
+    return true;
+}
+
+uint32_t platform_crc32(const uint8_t* data, size_t len) {
+    return crc32_stm32_sw(data, len);
+}
+
+bool platform_selftest_nvm_stall(size_t, uint32_t* flashUs, uint32_t* ramUs) {
+    *flashUs = 3200;
+    *ramUs = 2;
+    return true;
+}
+
+struct FakeLine : IOneWireHal {
+    bool driven = false;
+    bool stuckLow = false;
+    bool readLine() override { return !driven && !stuckLow; }
+    void driveLow(bool enableLow) override { driven = enableLow; }
+    uint32_t micros() override { return platform_micros(); }
+    void delayMicros(uint32_t us) override { platform_delay_us(us); }
+};
+
+// =====================================================
+// Test Fixtures
+// =====================================================
+
+VirtualClock vclock;
+FakeLine line;
+SelfTestConfig config;
+
+void setUp() {
+    vclock.reset();
+    vclock.install();
+    memset(g_pinLevel, 0, sizeof(g_pinLevel));
+    memset(g_eeprom, 0, sizeof(g_eeprom));
+    g_stuckPin = 0;
+    g_eepromStuckBits = 0;
+    g_rngStuck = false;
+    g_toneCount = 0;
+    line = FakeLine();
+
+    config = {};
+    config.line = &line;
+    config.ledPins = LED_PINS;
+    config.ledCount = 2;
+    config.buzzerPin = BUZZER_PIN;
+    config.scratchAddress = SCRATCH;
+}
+
+void tearDown() {
+    vclock.uninstall();
+}
+
+// =====================================================
+// Test Cases
+// =====================================================
+
+void test_healthy_card_passes() {
+    g_eeprom[SCRATCH] = 0x5A;
+    SelfTestReport report;
+
+    TEST_ASSERT_TRUE(self_test_run(config, report));
+    TEST_ASSERT_EQUAL_UINT8(0, report.failMask);
+    TEST_ASSERT_EQUAL_UINT32(3200, report.nvmStallFlashUs);
+    TEST_ASSERT_EQUAL_UINT32(2, report.nvmStallRamUs);
+    TEST_ASSERT_EQUAL_UINT8(0x5A, g_eeprom[SCRATCH]);   // Scratch word restored
+    TEST_ASSERT_EQUAL_UINT32(1, g_toneCount);
+    TEST_ASSERT_FALSE(line.driven);                     // Line left released
+}
+
+void test_stuck_line_fails_line_only() {
+    line.stuckLow = true;
+    SelfTestReport report;
+
+    TEST_ASSERT_FALSE(self_test_run(config, report));
+    TEST_ASSERT_EQUAL_UINT8(1u << SELFTEST_LINE, report.failMask);
+}
+
+void test_shorted_led_and_buzzer_pins_fail() {
+    SelfTestReport report;
+
+    g_stuckPin = LED_PINS[1];
+    self_test_run(config, report);
+    TEST_ASSERT_EQUAL_UINT8(1u << SELFTEST_LED, report.failMask);
+
+    g_stuckPin = BUZZER_PIN;
+    self_test_run(config, report);
+    TEST_ASSERT_EQUAL_UINT8(1u << SELFTEST_BUZZER, report.failMask);
+}
+
+void test_stuck_eeprom_bit_fails_eeprom() {
+    g_eepromStuckBits = 0x04;
+    SelfTestReport report;
+
+    self_test_run(config, report);
+    TEST_ASSERT_EQUAL_UINT8(1u << SELFTEST_EEPROM, report.failMask);
+}
+
+void test_repeating_rng_fails_rng() {
+    g_rngStuck = true;
+    SelfTestReport report;
+
+    self_test_run(config, report);
+    TEST_ASSERT_EQUAL_UINT8(1u << SELFTEST_RNG, report.failMask);
+}
+
+void test_item_names() {
+    TEST_ASSERT_EQUAL_STRING("line", self_test_item_name(SELFTEST_LINE));
+    TEST_ASSERT_EQUAL_STRING("crc", self_test_item_name(SELFTEST_CRC));
+    TEST_ASSERT_EQUAL_STRING("?", self_test_item_name(SELFTEST_ITEM_COUNT));
+}
+
+// =====================================================
+// Test Runner
+// =====================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_healthy_card_passes);
+    RUN_TEST(test_stuck_line_fails_line_only);
+    RUN_TEST(test_shorted_led_and_buzzer_pins_fail);
+    RUN_TEST(test_stuck_eeprom_bit_fails_eeprom);
+    RUN_TEST(test_repeating_rng_fails_rng);
+    RUN_TEST(test_item_names);
+
+    return UNITY_END();
+}
@@ -85,6 +85,30 @@ void test_increment_tap_count() {
     TEST_ASSERT_EQUAL(2, storage.state().totalTapCount);
 }
 
+void test_link_generation() {
+    uint8_t peerId[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    uint32_t gen = storage.getLinkGeneration();
+    
+    // Appends keep existing slots intact
+    storage.addLink(peerId);
+    TEST_ASSERT_EQUAL(gen, storage.getLinkGeneration());
+    
+    // Clearing invalidates them
+    storage.clearAll();
+    TEST_ASSERT_NOT_EQUAL(gen, storage.getLinkGeneration());
+    gen = storage.getLinkGeneration();
+    
+    // Overwriting a slot in a full table invalidates them
+    for (int i = 0; i < (int)PersistPayloadV1::MAX_LINKS; i++) {
+        peerId[0] = (uint8_t)i;
+        storage.addLink(peerId);
+    }
+    TEST_ASSERT_EQUAL(gen, storage.getLinkGeneration());
+    peerId[0] = 0xFF;
+    storage.addLink(peerId);
+    TEST_ASSERT_NOT_EQUAL(gen, storage.getLinkGeneration());
+}
+
 void test_set_secret_key() {
     uint8_t key[32];
     for (int i = 0; i < 32; i++) key[i] = i + 1;
@@ -144,6 +168,34 @@ void test_save_tracking() {
     TEST_ASSERT_EQUAL(1, storage.saveNowCallCount);
 }
 
+void test_transaction_defers_partial_saves() {
+    uint8_t peerId[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    
+    storage.beginTransaction();
+    storage.incrementTapCount();
+    storage.saveTapCountOnly();
+    storage.addLink(peerId);
+    storage.saveLinkOnly();
+    
+    // Nothing written yet
+    TEST_ASSERT_TRUE(storage.isDirty());
+    TEST_ASSERT_EQUAL(2, storage.deferredSaveCount);
+    TEST_ASSERT_EQUAL(0, storage.commitCount);
+    
+    // Nested commit does not write
+    storage.beginTransaction();
+    TEST_ASSERT_TRUE(storage.commitTransaction());
+    TEST_ASSERT_EQUAL(0, storage.commitCount);
+    
+    // Outermost commit writes both mutations at once
+    TEST_ASSERT_TRUE(storage.commitTransaction());
+    TEST_ASSERT_EQUAL(1, storage.commitCount);
+    TEST_ASSERT_FALSE(storage.isDirty());
+    
+    // Unbalanced commit is rejected
+    TEST_ASSERT_FALSE(storage.commitTransaction());
+}
+
 void test_begin_tracking() {
     TEST_ASSERT_FALSE(storage.beginCalled);
     
@@ -181,9 +233,11 @@ int main(int argc, char **argv) {
     RUN_TEST(test_add_link_duplicate);
     RUN_TEST(test_add_multiple_links);
     RUN_TEST(test_increment_tap_count);
+    RUN_TEST(test_link_generation);
     RUN_TEST(test_set_secret_key);
     RUN_TEST(test_clear_all_resets_data);
     RUN_TEST(test_save_tracking);
+    RUN_TEST(test_transaction_defers_partial_saves);
     RUN_TEST(test_begin_tracking);
     RUN_TEST(test_loop_tracking);
     
@@ -0,0 +1,261 @@
+// =====================================================
+// Storage NVM Write Unit Tests
+// =====================================================
+// Runs the real Storage (src/storage.cpp) against a fake
+// EEPROM that records every queued block and fence, so the
+// transaction batching is checked on what would actually
+// be programmed rather than on MockStorage's model of it.
+//
+// Run with: pio test -e native
+// =====================================================
+
+#include <unity.h>
+#include <vector>
+#include "../virtual_clock.h"
+
+#include "../../src/platform_timing.cpp"
+#include "../../src/crc32.cpp"
+#include "../../src/device_id.cpp"
+#include "../../src/hex_util.cpp"
+#include "../../src/link_table.cpp"
+#include "../../src/storage.cpp"
+
+// =====================================================
+// Fakes
+// =====================================================
+
+struct QueuedWrite {
+    size_t address;
+    size_t len;
+};
+
+static uint8_t g_eeprom[STORAGE_EEPROM_SIZE];
+static std::vector<QueuedWrite> g_writes;
+static uint32_t g_fences;
+
+static const uint8_t SELF_UID[DEVICE_UID_LEN] = {
+    0x0E, 0x47, 0x31, 0x34, 0x39, 0x35, 0x35, 0x39, 0x00, 0x18, 0x00, 0x40
+};
+
+bool platform_storage_begin(size_t) { return true; }
+uint8_t platform_storage_read(size_t address) { return g_eeprom[address]; }
+bool platform_storage_commit() { return true; }
+
+void platform_storage_queue_block(size_t address, const uint8_t* data, size_t len) {
+    memcpy(&g_eeprom[address], data, len);
+    g_writes.push_back({ address, len });
+}
+
+void platform_storage_queue_fence(platform_storage_done_fn done, void* ctx) {
+    g_fences++;
+    done(ctx, true);
+}
+
+void platform_get_device_uid(uint8_t out[PLATFORM_DEVICE_UID_SIZE]) {
+    memcpy(out, SELF_UID, DEVICE_UID_LEN);
+}
+
+bool platform_rng_read(uint32_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = 0x5EED0000 + i;
+    }
+    return true;
+}
+
+uint32_t platform_crc32(const uint8_t* data, size_t len) {
+    return crc32_stm32_sw(data, len);
+}
+
+// =====================================================
+// Helpers
+// =====================================================
+
+static constexpr size_t TAP_COUNT_ADDR = STORAGE_EEPROM_BASE + offsetof(PersistImageV1, payload) +
+                                         offsetof(PersistPayloadV1, totalTapCount);
+static constexpr size_t LINK_COUNT_ADDR = STORAGE_EEPROM_BASE + offsetof(PersistImageV1, payload) +
+                                          offsetof(PersistPayloadV1, linkCount);
+static constexpr size_t LINKS_ADDR = STORAGE_EEPROM_BASE + offsetof(PersistImageV1, payload) +
+                                     offsetof(PersistPayloadV1, links);
+static constexpr size_t CRC_ADDR = STORAGE_EEPROM_BASE + offsetof(PersistImageV1, header) +
+                                   offsetof(PersistHeader, crc32);
+
+static size_t linkAddr(uint16_t slot) {
+    return LINKS_ADDR + slot * sizeof(LinkRecordV1);
+}
+
+static uint32_t writesTo(size_t address) {
+    uint32_t n = 0;
+    for (const QueuedWrite& w : g_writes) {
+        if (w.address == address) {
+            n++;
+        }
+    }
+    return n;
+}
+
+static void makePeer(uint8_t peer[DEVICE_UID_LEN], uint8_t n) {
+    memset(peer, 0, DEVICE_UID_LEN);
+    peer[0] = 0xA0;
+    peer[DEVICE_UID_LEN - 1] = n;
+}
+
+static void clearLog() {
+    g_writes.clear();
+    g_fences = 0;
+}
+
+// A freshly formatted card, with the formatting writes dropped
+static void startBlank(Storage& storage) {
+    TEST_ASSERT_TRUE(storage.begin());
+    clearLog();
+}
+
+// =====================================================
+// Test Fixtures
+// =====================================================
+
+VirtualClock vclock;
+
+void setUp() {
+    vclock.reset();
+    vclock.install();
+    memset(g_eeprom, 0xFF, sizeof(g_eeprom));
+    clearLog();
+}
+
+void tearDown() {
+    vclock.uninstall();
+}
+
+// =====================================================
+// Test Cases
+// =====================================================
+
+void test_tap_and_link_commit_writes_crc_once() {
+    Storage storage;
+    startBlank(storage);
+    uint8_t peer[DEVICE_UID_LEN];
+    makePeer(peer, 1);
+
+    storage.beginTransaction();
+    storage.incrementTapCount();
+    storage.saveTapCountOnly();
+    storage.addLink(peer);
+    storage.saveLinkOnly();
+    TEST_ASSERT_EQUAL(0, g_writes.size());      // Nothing queued while open
+    TEST_ASSERT_EQUAL_UINT32(0, g_fences);
+
+    TEST_ASSERT_TRUE(storage.commitTransaction());
+    TEST_ASSERT_EQUAL(4, g_writes.size());
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(TAP_COUNT_ADDR));
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(LINK_COUNT_ADDR));
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(linkAddr(0)));
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(CRC_ADDR));
+    TEST_ASSERT_EQUAL(CRC_ADDR, g_writes.back().address);  // Header last
+    TEST_ASSERT_EQUAL_UINT32(1, g_fences);
+
+    // What reached the EEPROM is a valid image on the next boot
+    Storage rebooted;
+    TEST_ASSERT_TRUE(rebooted.begin());
+    TEST_ASSERT_EQUAL_UINT32(1, rebooted.state().totalTapCount);
+    TEST_ASSERT_TRUE(rebooted.hasLink(peer));
+}
+
+void test_unbalanced_commit_is_rejected() {
+    Storage storage;
+    startBlank(storage);
+
+    TEST_ASSERT_FALSE(storage.commitTransaction());
+
+    storage.beginTransaction();
+    TEST_ASSERT_TRUE(storage.commitTransaction());
+    TEST_ASSERT_FALSE(storage.commitTransaction());
+    TEST_ASSERT_EQUAL(0, g_writes.size());
+    TEST_ASSERT_EQUAL_UINT32(0, g_fences);
+}
+
+void test_nested_commit_defers_to_outermost() {
+    Storage storage;
+    startBlank(storage);
+
+    storage.beginTransaction();
+    storage.beginTransaction();
+    storage.incrementTapCount();
+    storage.saveTapCountOnly();
+
+    TEST_ASSERT_TRUE(storage.commitTransaction());     // Inner
+    TEST_ASSERT_EQUAL(0, g_writes.size());
+
+    TEST_ASSERT_TRUE(storage.commitTransaction());     // Outer
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(TAP_COUNT_ADDR));
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(CRC_ADDR));
+    TEST_ASSERT_EQUAL_UINT32(1, g_fences);
+}
+
+void test_pending_links_cover_first_and_last_slot() {
+    Storage storage;
+    startBlank(storage);
+    uint8_t peer[DEVICE_UID_LEN];
+    const uint16_t last = PersistPayloadV1::MAX_LINKS - 1;
+
+    for (uint16_t i = 0; i < last; i++) {
+        makePeer(peer, (uint8_t)i);
+        storage.addLink(peer);
+    }
+    storage.saveNow();
+    clearLog();
+
+    // Slot 63 fills the table; the next link wraps onto slot 0
+    storage.beginTransaction();
+    makePeer(peer, 0xF0);
+    storage.addLink(peer);
+    storage.saveLinkOnly();
+    makePeer(peer, 0xF1);
+    storage.addLink(peer);
+    storage.saveLinkOnly();
+    TEST_ASSERT_TRUE(storage.commitTransaction());
+
+    TEST_ASSERT_EQUAL(4, g_writes.size());
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(linkAddr(last)));
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(linkAddr(0)));
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(LINK_COUNT_ADDR));
+    TEST_ASSERT_EQUAL_UINT32(1, writesTo(CRC_ADDR));
+
+    Storage rebooted;
+    TEST_ASSERT_TRUE(rebooted.begin());
+    TEST_ASSERT_EQUAL_UINT16(PersistPayloadV1::MAX_LINKS, rebooted.state().linkCount);
+    TEST_ASSERT_TRUE(rebooted.hasLink(peer));
+}
+
+void test_loop_skips_save_while_transaction_open() {
+    Storage storage;
+    startBlank(storage);
+
+    storage.beginTransaction();
+    storage.incrementTapCount();
+    vclock.advanceMs(STORAGE_DELAYED_WRITE_MS * 2);
+    storage.loop();
+    TEST_ASSERT_EQUAL(0, g_writes.size());
+
+    // Nothing was staged for the commit, so the delayed save picks it up
+    TEST_ASSERT_TRUE(storage.commitTransaction());
+    TEST_ASSERT_EQUAL(0, g_writes.size());
+    storage.loop();
+    TEST_ASSERT_EQUAL(1, g_writes.size());
+    TEST_ASSERT_EQUAL(STORAGE_EEPROM_BASE, g_writes[0].address);
+    TEST_ASSERT_EQUAL(sizeof(PersistImageV1), g_writes[0].len);
+}
+
+// =====================================================
+// Test Runner
+// =====================================================
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_tap_and_link_commit_writes_crc_once);
+    RUN_TEST(test_unbalanced_commit_is_rejected);
+    RUN_TEST(test_nested_commit_defers_to_outermost);
+    RUN_TEST(test_pending_links_cover_first_and_last_slot);
+    RUN_TEST(test_loop_skips_save_while_transaction_open);
+    return UNITY_END();
+}
@@ -0,0 +1,710 @@
+// =====================================================
+// Tap Link Conformance Tests
+// =====================================================
+// Runs a TapLink (the card under test) against a scripted
+// peer on a simulated wire (../sim_wire.h). The peer is an
+// executable spec of the V1 link as cards in the field run
+// it, written out from the V1 tap_link.cpp and application
+// loop independently of tap_link.h: 32-bit arbitration with
+// '0' dominant, the tie-breaker bit and UID sum parity,
+// REQUEST_ID then SEND_ID, 2ms turnarounds, a slave that
+// answers through its main loop and stores the link after
+// SEND_ID. Any change to the link must keep this suite passing.
+//
+// Covers role election and the ID exchange in both roles,
+// a 32-bit tie, cards that stop between presence pulses,
+// late sync, clock skew, a stuck-low line and a disconnect
+// mid-byte, checks the slave's response envelope, and prints
+// exchange latency percentiles over randomized taps.
+//
+// Run with: pio test -e native
+// =====================================================
+
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "../sim_wire.h"
+
+// The native env builds no firmware sources; pull in the
+// portable units under test directly.
+#include "../../src/tap_link.cpp"
+#include "../../src/uid_codec.cpp"
+
+// TapLink reads its hardware UID once; cards here use setIdentity()
+void getDeviceUidRaw(uint8_t out[DEVICE_UID_LEN]) {
+    memset(out, 0, DEVICE_UID_LEN);
+}
+
+// =====================================================
+// V1 Link Spec (scripted peer)
+// =====================================================
+
+namespace v1 {
+
+constexpr uint32_t PRESENCE_PULSE_US = 2000;
+constexpr uint32_t PULSE_INTERVAL_US = 50000;
+constexpr uint32_t DEBOUNCE_US = 5000;
+constexpr uint32_t SYNC_PULSE_US = 10000;
+constexpr uint32_t SYNC_WAIT_US = 5000;
+constexpr uint32_t PEER_SYNC_WINDOW_US = 50000;
+constexpr uint32_t BIT_DRIVE_US = 5000;
+constexpr uint32_t BIT_SAMPLE_US = 2500;
+constexpr uint32_t BIT_RECOVERY_US = 2000;
+constexpr uint32_t NEGOTIATION_BITS = 32;
+constexpr uint32_t START_PULSE_US = 5000;
+constexpr uint32_t START_PULSE_MIN_US = 3000;   // shorter lows are presence pulses
+constexpr uint32_t TURNAROUND_US = 2000;
+constexpr uint32_t COMMAND_INTERVAL_US = 500000;
+constexpr uint32_t SLAVE_IDLE_TIMEOUT_US = 2000000;
+constexpr uint8_t MAX_COMMAND_FAILURES = 3;
+constexpr uint32_t SAVE_LINK_US = 70000;        // saveLinkOnly(): 18 EEPROM bytes
+
+constexpr uint8_t CHECK_READY = 0x01;
+constexpr uint8_t REQUEST_ID = 0x02;
+constexpr uint8_t SEND_ID = 0x03;
+constexpr uint8_t ACK = 0x06;
+constexpr uint8_t NAK = 0x15;
+
+struct Config {
+    uint8_t uid[DEVICE_UID_LEN];
+    uint32_t firstPulseUs = 20000;    // phase of its first presence pulse
+    uint32_t syncDelayUs = 0;         // extra delay before its first sync pulse
+    uint32_t turnaroundUs = TURNAROUND_US;
+    uint32_t replyLatencyUs = 0;      // slave: main loop delay before answering
+    uint32_t bootUs = 0;              // micros() at begin(), seeds the tie-breaker
+};
+
+struct Log {
+    bool negotiated = false;
+    bool master = false;
+    bool linked = false;
+    uint8_t peer[DEVICE_UID_LEN] = {};
+    std::vector<uint64_t> commandEndNs;   // master: end of each command byte
+};
+
+// Command bytes: '0' drives low, '1' releases; MSB first
+void sendByte(SimWire::Port& p, uint8_t b) {
+    for (int i = 7; i >= 0; i--) {
+        p.driveLow(!((b >> i) & 1));
+        p.delayMicros(BIT_DRIVE_US);
+        p.driveLow(false);
+        p.delayMicros(BIT_RECOVERY_US);
+    }
+}
+
+// Majority of three reads at the sample point
+bool sampleHigh(SimWire::Port& p) {
+    int high = p.readLine();
+    p.delayMicros(100);
+    high += p.readLine();
+    p.delayMicros(100);
+    high += p.readLine();
+    return high >= 2;
+}
+
+uint8_t receiveByte(SimWire::Port& p) {
+    uint8_t b = 0;
+    for (int i = 7; i >= 0; i--) {
+        p.delayMicros(BIT_SAMPLE_US);
+        b |= (sampleHigh(p) ? 1 : 0) << i;
+        p.delayMicros(BIT_DRIVE_US - BIT_SAMPLE_US - 200 + BIT_RECOVERY_US);
+    }
+    return b;
+}
+
+// Presence pulses until the other side pulls the line low
+void detect(SimWire::Port& p, const Config& c) {
+    uint64_t nextPulseUs = p.localUs() + c.firstPulseUs;
+    while (true) {
+        uint64_t now = p.localUs();
+        if (now >= nextPulseUs) {
+            p.driveLow(true);
+            p.delayMicros(PRESENCE_PULSE_US);
+            p.driveLow(false);
+            nextPulseUs += PULSE_INTERVAL_US;
+            continue;
+        }
+        if (p.waitLine(false, (uint32_t)(nextPulseUs - now))) {
+            p.waitLine(true, DEBOUNCE_US);   // pulse over, or held past debounce
+            return;
+        }
+    }
+}
+
+// Two sync pulses, then wired-AND arbitration over the first 32
+// UID bits: '0' drives low; a '1' that reads low wins and stops
+void negotiate(SimWire::Port& p, const Config& c, uint32_t& seed, Log& log) {
+    p.driveLow(false);
+    p.waitLine(true, 100000);
+    p.delayMicros(1000 + c.syncDelayUs);
+
+    p.driveLow(true);
+    p.delayMicros(SYNC_PULSE_US);
+    p.driveLow(false);
+    p.waitLine(true, 20000);
+    if (p.waitLine(false, PEER_SYNC_WINDOW_US)) {
+        p.waitLine(true, 20000);
+    }
+
+    p.delayMicros(SYNC_WAIT_US);
+    p.driveLow(true);
+    p.delayMicros(SYNC_PULSE_US);
+    p.driveLow(false);
+    p.waitLine(true, 20000);
+    p.delayMicros(SYNC_WAIT_US);
+
+    log.negotiated = true;
+    for (uint32_t i = 0; i < NEGOTIATION_BITS; i++) {
+        bool myBit = c.uid[i / 8] & (1 << (7 - i % 8));
+        p.driveLow(!myBit);
+        p.delayMicros(BIT_SAMPLE_US);
+        bool low = !sampleHigh(p);
+        p.delayMicros(BIT_DRIVE_US - BIT_SAMPLE_US - 200);
+        p.driveLow(false);
+        p.delayMicros(BIT_RECOVERY_US);
+        if (myBit && low) {
+            log.master = true;
+            return;
+        }
+    }
+
+    // The loser gets here too: the winner stopped at the bit it won.
+    // Tie-breaker bit, then UID sum parity (odd = master)
+    seed = seed * 1103515245u + 12345u;
+    bool myBit = (seed >> 16) & 1;
+    p.driveLow(!myBit);
+    p.delayMicros(BIT_SAMPLE_US);
+    bool peerBit = p.readLine();
+    p.delayMicros(BIT_DRIVE_US - BIT_SAMPLE_US);
+    p.driveLow(false);
+    if (myBit != peerBit) {
+        log.master = myBit;
+    } else {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < DEVICE_UID_LEN; i++) sum += c.uid[i];
+        log.master = sum & 1;
+    }
+}
+
+// Slave: answer commands until the master goes quiet
+void serve(SimWire::Port& p, const Config& c, Log& log) {
+    uint64_t lastCommandUs = p.localUs();
+    while (true) {
+        uint64_t idle = p.localUs() - lastCommandUs;
+        if (idle >= SLAVE_IDLE_TIMEOUT_US || !p.waitLine(false, (uint32_t)(SLAVE_IDLE_TIMEOUT_US - idle))) {
+            return;
+        }
+        uint64_t lowUs = p.localUs();
+        p.waitLine(true, 100000);
+        if (p.localUs() - lowUs < START_PULSE_MIN_US) {
+            continue;
+        }
+        p.delayMicros(c.turnaroundUs);
+        uint8_t cmd = receiveByte(p);
+        lastCommandUs = p.localUs();
+
+        if (cmd == SEND_ID) {
+            // The UID follows the command byte directly
+            uint8_t uid[DEVICE_UID_LEN];
+            for (size_t i = 0; i < DEVICE_UID_LEN; i++) uid[i] = receiveByte(p);
+            p.delayMicros(c.turnaroundUs);
+            sendByte(p, ACK);
+            if (!log.linked) {
+                // addLink() + saveLinkOnly(), blind to the line meanwhile
+                log.linked = true;
+                memcpy(log.peer, uid, DEVICE_UID_LEN);
+                p.delayMicros(SAVE_LINK_US);
+            }
+            lastCommandUs = p.localUs();
+            continue;
+        }
+
+        p.delayMicros(c.replyLatencyUs + c.turnaroundUs);
+        if (cmd == CHECK_READY) {
+            sendByte(p, ACK);
+        } else if (cmd == REQUEST_ID) {
+            sendByte(p, ACK);
+            for (size_t i = 0; i < DEVICE_UID_LEN; i++) {
+                sendByte(p, c.uid[i]);
+            }
+        } else {
+            sendByte(p, NAK);
+        }
+        lastCommandUs = p.localUs();
+    }
+}
+
+// Master: one command per interval, like the V1 main loop; the ID
+// exchange is REQUEST_ID and then SEND_ID straight after
+void command(SimWire::Port& p, const Config& c, Log& log) {
+    bool ready = false;
+    uint8_t failures = 0;
+
+    auto start = [&](uint8_t cmd) {
+        p.driveLow(true);
+        p.delayMicros(START_PULSE_US);
+        p.driveLow(false);
+        p.delayMicros(c.turnaroundUs);
+        sendByte(p, cmd);
+    };
+
+    while (failures < MAX_COMMAND_FAILURES) {
+        p.delayMicros(COMMAND_INTERVAL_US);
+        uint8_t cmd = ready && !log.linked ? REQUEST_ID : CHECK_READY;
+        start(cmd);
+        log.commandEndNs.push_back(p.nowNs());
+        p.delayMicros(c.turnaroundUs);
+
+        uint8_t resp = receiveByte(p);
+        if (cmd == CHECK_READY) {
+            if (resp != ACK && resp != NAK) {
+                failures++;
+                continue;
+            }
+            failures = 0;
+            ready = (resp == ACK);
+            continue;
+        }
+        if (resp != ACK) {
+            failures++;
+            continue;
+        }
+        uint8_t uid[DEVICE_UID_LEN];
+        for (size_t i = 0; i < DEVICE_UID_LEN; i++) uid[i] = receiveByte(p);
+
+        start(SEND_ID);
+        for (size_t i = 0; i < DEVICE_UID_LEN; i++) sendByte(p, c.uid[i]);
+        p.delayMicros(c.turnaroundUs);
+        if (receiveByte(p) != ACK) {
+            failures++;
+            continue;
+        }
+        failures = 0;
+        log.linked = true;
+        memcpy(log.peer, uid, DEVICE_UID_LEN);
+    }
+}
+
+// Back to detection after a disconnect, until linked
+void run(SimWire::Port& p, const Config& c, Log& log) {
+    uint32_t seed = c.bootUs;
+    for (size_t i = 0; i < DEVICE_UID_LEN; i++) {
+        seed ^= (uint32_t)c.uid[i] << (i % 4) * 8;
+    }
+    do {
+        detect(p, c);
+        negotiate(p, c, seed, log);
+        if (log.master) {
+            command(p, c, log);
+        } else {
+            serve(p, c, log);
+        }
+    } while (!log.linked);
+}
+
+}  // namespace v1
+
+// =====================================================
+// Card Under Test
+// =====================================================
+// Drives TapLink the way Application does: poll every
+// millisecond, master commands every 500ms.
+
+struct CardLog {
+    bool negotiated = false;
+    bool master = false;
+    bool linked = false;
+    uint8_t peer[DEVICE_UID_LEN] = {};
+    uint64_t linkedNs = 0;
+    bool idleAtEnd = false;
+    bool drivingAtEnd = false;
+};
+
+static constexpr uint32_t COMMAND_INTERVAL_MS = 500;
+
+// STOP between presence pulses, as Application::idleLowPower() does
+// without a timer beacon: a falling edge wakes the card, which then
+// needs a while to get its clocks back
+static constexpr uint32_t STOP_MIN_US = 3000;
+static constexpr uint32_t STOP_WAKE_US = 2500;   // longer than a presence pulse
+
+static void runCard(SimWire::Port& p, const uint8_t uid[DEVICE_UID_LEN], uint32_t durationMs,
+                    CardLog& log, bool stopWhenLinked = true, bool stopWhenIdle = false) {
+    TapLink link(&p);
+    link.setIdentity(uid);
+    uint64_t endNs = p.nowNs() + (uint64_t)durationMs * 1000000;
+    uint32_t lastCommandMs = 0;
+
+    auto record = [&](const uint8_t peer[DEVICE_UID_LEN]) {
+        if (!log.linked) {
+            log.linked = true;
+            log.linkedNs = p.nowNs();
+            memcpy(log.peer, peer, DEVICE_UID_LEN);
+        }
+    };
+
+    while (p.nowNs() < endNs && !(stopWhenLinked && log.linked)) {
+        uint32_t nowMs = p.micros() / 1000;
+        link.poll();
+        if (link.isNegotiationComplete()) {
+            log.negotiated = true;
+            log.master = link.isMaster();
+            lastCommandMs = nowMs;
+        }
+        if (link.isConnected() && link.hasRole()) {
+            uint8_t peer[DEVICE_UID_LEN];
+            if (link.isMaster()) {
+                if (nowMs - lastCommandMs >= COMMAND_INTERVAL_MS) {
+                    if (!link.isPeerReady() || link.isIdExchangeComplete()) {
+                        link.masterSendCommand(TapCommand::CHECK_READY);
+                    } else if (link.masterRequestId(peer)) {
+                        record(peer);
+                    }
+                    lastCommandMs = nowMs;
+                }
+            } else if (link.slaveHasCommand()) {
+                bool pending = !link.isIdExchangeComplete();
+                link.slaveServeCommand();
+                if (pending && link.isIdExchangeComplete() && link.getPeerId(peer)) {
+                    record(peer);
+                }
+            }
+        }
+        if (stopWhenIdle) {
+            link.setLowPower(link.isIdle());
+            uint32_t budgetUs = link.idleBudgetUs();
+            if (budgetUs >= STOP_MIN_US) {
+                if (p.waitLine(false, budgetUs)) {
+                    p.delayMicros(STOP_WAKE_US);
+                    link.notePeerEdge();
+                }
+                continue;
+            }
+        }
+        p.delayMicros(1000);
+    }
+    link.poll();
+    log.idleAtEnd = link.isIdle();
+    log.drivingAtEnd = p.isDrivingLow();
+}
+
+// =====================================================
+// Fixtures
+// =====================================================
+
+// Two cards from one lot (see utils/provision_keys.json): HIGH wins
+static const uint8_t UID_HIGH[DEVICE_UID_LEN] = {0x0F, 0x47, 0x31, 0x34, 0x39, 0x35,
+                                                 0x35, 0x39, 0x00, 0x44, 0x00, 0x44};
+static const uint8_t UID_LOW[DEVICE_UID_LEN]  = {0x0E, 0x47, 0x31, 0x34, 0x39, 0x35,
+                                                 0x35, 0x39, 0x00, 0x18, 0x00, 0x40};
+
+// Same wafer and lot as UID_HIGH: the first 32 bits tie
+static const uint8_t UID_TIE[DEVICE_UID_LEN]  = {0x0F, 0x47, 0x31, 0x34, 0x39, 0x35,
+                                                 0x35, 0x39, 0x00, 0x52, 0x00, 0x3B};
+// Loses to UID_HIGH with an odd byte sum: V1 takes master on it anyway
+static const uint8_t UID_LOW_ODD[DEVICE_UID_LEN] = {0x0E, 0x47, 0x31, 0x34, 0x39, 0x35,
+                                                    0x35, 0x39, 0x00, 0x18, 0x00, 0x41};
+
+static constexpr uint64_t RUN_LIMIT_US = 8000000;
+
+static v1::Config peerConfig(const uint8_t uid[DEVICE_UID_LEN]) {
+    v1::Config c;
+    memcpy(c.uid, uid, DEVICE_UID_LEN);
+    return c;
+}
+
+// Card under test on port 0, V1 peer on port 1
+static void runAgainstV1(SimWire& wire, const uint8_t cardUid[DEVICE_UID_LEN], const v1::Config& c,
+                         CardLog& card, v1::Log& peer, uint32_t cardMs = 5000) {
+    wire.run([&](SimWire::Port& p) { runCard(p, cardUid, cardMs, card); },
+             [&](SimWire::Port& p) { v1::run(p, c, peer); }, RUN_LIMIT_US);
+}
+
+static void assertLinked(const CardLog& card, const v1::Log& peer,
+                         const uint8_t cardUid[DEVICE_UID_LEN], const uint8_t peerUid[DEVICE_UID_LEN]) {
+    TEST_ASSERT_TRUE(card.negotiated);
+    TEST_ASSERT_TRUE(peer.negotiated);
+    TEST_ASSERT_NOT_EQUAL(card.master, peer.master);
+    TEST_ASSERT_TRUE(card.linked);
+    TEST_ASSERT_TRUE(peer.linked);
+    TEST_ASSERT_EQUAL_MEMORY(peerUid, card.peer, DEVICE_UID_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(cardUid, peer.peer, DEVICE_UID_LEN);
+}
+
+// Start of the card's first response bit after each command the V1
+// master sent (ACK and NAK both start with a '0' bit: line low)
+static std::vector<uint64_t> responseDelaysNs(const SimWire& wire, const v1::Log& peer) {
+    std::vector<uint64_t> delays;
+    for (uint64_t end : peer.commandEndNs) {
+        for (const SimWire::Edge& e : wire.edges()) {
+            if (e.port == 0 && e.low && e.ns >= end) {
+                delays.push_back(e.ns - end);
+                break;
+            }
+        }
+    }
+    return delays;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// =====================================================
+// V1 Compatibility
+// =====================================================
+
+void test_v1_peer_as_slave() {
+    SimWire wire;
+    CardLog card;
+    v1::Log peer;
+    runAgainstV1(wire, UID_HIGH, peerConfig(UID_LOW), card, peer);
+    assertLinked(card, peer, UID_HIGH, UID_LOW);
+    TEST_ASSERT_TRUE(card.master);
+}
+
+void test_v1_peer_as_master() {
+    SimWire wire;
+    CardLog card;
+    v1::Log peer;
+    runAgainstV1(wire, UID_LOW, peerConfig(UID_HIGH), card, peer);
+    assertLinked(card, peer, UID_LOW, UID_HIGH);
+    TEST_ASSERT_FALSE(card.master);
+}
+
+void test_v1_slave_main_loop_latency() {
+    // A V1 slave answers from its main loop, up to ~1ms late
+    v1::Config c = peerConfig(UID_LOW);
+    c.replyLatencyUs = 1000;
+    SimWire wire;
+    CardLog card;
+    v1::Log peer;
+    runAgainstV1(wire, UID_HIGH, c, card, peer);
+    assertLinked(card, peer, UID_HIGH, UID_LOW);
+}
+
+void test_v1_tie_on_first_32_bits() {
+    // Role falls to the tie-breaker bit. An inconclusive one leaves the
+    // card slave and the V1 peer on its UID sum; if that makes two slaves,
+    // both time out and negotiate again with fresh random bits.
+    for (uint32_t boot = 0; boot < 4; boot++) {
+        v1::Config c = peerConfig(UID_TIE);
+        c.bootUs = boot * 7919;
+        SimWire wire;
+        CardLog card;
+        v1::Log peer;
+        wire.run([&](SimWire::Port& p) { runCard(p, UID_HIGH, 25000, card); },
+                 [&](SimWire::Port& p) { v1::run(p, c, peer); }, 30000000);
+        assertLinked(card, peer, UID_HIGH, UID_TIE);
+    }
+}
+
+void test_v1_loser_takes_master() {
+    // A V1 loser still runs the tie-breaker against the silent winner
+    // and always falls through to UID sum parity. Odd, it starts sending
+    // commands too; the card sees the line low between its own and yields.
+    for (uint32_t boot = 0; boot < 2; boot++) {
+        v1::Config c = peerConfig(UID_LOW_ODD);
+        c.bootUs = boot * 7919;
+        SimWire wire;
+        CardLog card;
+        v1::Log peer;
+        runAgainstV1(wire, UID_HIGH, c, card, peer);
+        TEST_ASSERT_TRUE(peer.master);
+        TEST_ASSERT_TRUE(card.linked);
+        TEST_ASSERT_TRUE(peer.linked);
+        TEST_ASSERT_EQUAL_MEMORY(UID_LOW_ODD, card.peer, DEVICE_UID_LEN);
+        TEST_ASSERT_EQUAL_MEMORY(UID_HIGH, peer.peer, DEVICE_UID_LEN);
+    }
+}
+
+void test_card_vs_card() {
+    SimWire wire;
+    CardLog a, b;
+    // Started together, both cards pulse in lockstep; offset the second
+    wire.run([&](SimWire::Port& p) { runCard(p, UID_HIGH, 5000, a); },
+             [&](SimWire::Port& p) {
+                 p.delayMicros(20000);
+                 runCard(p, UID_LOW, 5000, b);
+             }, RUN_LIMIT_US);
+    TEST_ASSERT_TRUE(a.master);
+    TEST_ASSERT_FALSE(b.master);
+    TEST_ASSERT_TRUE(a.linked);
+    TEST_ASSERT_TRUE(b.linked);
+    TEST_ASSERT_EQUAL_MEMORY(UID_LOW, a.peer, DEVICE_UID_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(UID_HIGH, b.peer, DEVICE_UID_LEN);
+}
+
+void test_stopped_cards_link() {
+    // Both cards stop between their 500ms presence pulses and only
+    // wake on each other's edges, too late to still see the pulse
+    SimWire wire;
+    CardLog a, b;
+    wire.run([&](SimWire::Port& p) { runCard(p, UID_HIGH, 6000, a, true, true); },
+             [&](SimWire::Port& p) {
+                 p.delayMicros(120000);
+                 runCard(p, UID_LOW, 6000, b, true, true);
+             }, RUN_LIMIT_US);
+    TEST_ASSERT_TRUE(a.master);
+    TEST_ASSERT_FALSE(b.master);
+    TEST_ASSERT_TRUE(a.linked);
+    TEST_ASSERT_TRUE(b.linked);
+    TEST_ASSERT_EQUAL_MEMORY(UID_LOW, a.peer, DEVICE_UID_LEN);
+    TEST_ASSERT_EQUAL_MEMORY(UID_HIGH, b.peer, DEVICE_UID_LEN);
+}
+
+// =====================================================
+// Timing Envelopes
+// =====================================================
+
+void test_slave_response_envelope() {
+    // A V1 master samples each bit TURNAROUND + BIT_SAMPLE after its
+    // command byte; the card's 5ms drive must cover that with margin
+    // on both sides for any master turnaround from 1ms to 2ms
+    SimWire wire;
+    CardLog card;
+    v1::Log peer;
+    runAgainstV1(wire, UID_LOW, peerConfig(UID_HIGH), card, peer);
+    TEST_ASSERT_TRUE(card.linked);
+
+    std::vector<uint64_t> delays = responseDelaysNs(wire, peer);
+    TEST_ASSERT_TRUE(delays.size() >= 2);
+    for (uint64_t ns : delays) {
+        TEST_ASSERT_UINT32_WITHIN(500, 1000, (uint32_t)(ns / 1000));   // 0.5..1.5ms after the command
+    }
+}
+
+void test_clock_skew() {
+    // The card corrects by the skew it measures; the scripted peer not at all
+    const int32_t skews[] = { -3000, 3000 };
+    for (int32_t ppm : skews) {
+        SimWire wire;
+        wire.port(1).setSkewPpm(ppm);
+        CardLog card;
+        v1::Log peer;
+        runAgainstV1(wire, UID_HIGH, peerConfig(UID_LOW), card, peer);
+        assertLinked(card, peer, UID_HIGH, UID_LOW);
+    }
+}
+
+// =====================================================
+// Edge Cases
+// =====================================================
+
+void test_late_sync() {
+    // Peer's first sync pulse late, but inside the 50ms window
+    v1::Config c = peerConfig(UID_LOW);
+    c.syncDelayUs = 30000;
+    SimWire wire;
+    CardLog card;
+    v1::Log peer;
+    runAgainstV1(wire, UID_HIGH, c, card, peer);
+    assertLinked(card, peer, UID_HIGH, UID_LOW);
+}
+
+void test_stuck_low_line() {
+    // Line held low for 3s with nobody there: no link, and the card
+    // is back to idle (line released) once the line recovers
+    SimWire wire;
+    wire.holdLow(10000, 3000000);
+    CardLog card;
+    wire.run([&](SimWire::Port& p) { runCard(p, UID_HIGH, 6000, card, false); },
+             [&](SimWire::Port&) {}, RUN_LIMIT_US);
+    TEST_ASSERT_FALSE(card.linked);
+    TEST_ASSERT_TRUE(card.idleAtEnd);
+    TEST_ASSERT_FALSE(card.drivingAtEnd);
+}
+
+void test_disconnect_mid_byte() {
+    // Find when the slave's compact ID frame ends in a clean card to
+    // card run, then cut the wire in the middle of its header byte. The
+    // link has no frame check yet, so a cut inside the body could still
+    // pass as a wrong UID; the header's length field catches this case.
+    static constexpr uint64_t BIT_NS = 7000000;
+    static constexpr uint64_t BYTE_NS = 8 * BIT_NS;
+    auto runPair = [](SimWire& wire, CardLog& a, CardLog& b) {
+        wire.run([&](SimWire::Port& p) { runCard(p, UID_HIGH, 6000, a, false); },
+                 [&](SimWire::Port& p) {
+                     p.delayMicros(20000);
+                     runCard(p, UID_LOW, 6000, b, false);
+                 }, RUN_LIMIT_US);
+    };
+    uint64_t headerNs;
+    {
+        SimWire wire;
+        CardLog a, b;
+        runPair(wire, a, b);
+        TEST_ASSERT_TRUE(a.linked);
+        uint8_t frame[UID_COMPACT_MAX_LEN];
+        headerNs = a.linkedNs - uid_compact_encode(UID_LOW, UID_HIGH, frame) * BYTE_NS;
+    }
+
+    SimWire wire;
+    wire.cutAt((headerNs + 4 * BIT_NS + BIT_NS / 2) / 1000);
+    CardLog a, b;
+    runPair(wire, a, b);
+    TEST_ASSERT_FALSE(a.linked);
+    TEST_ASSERT_TRUE(a.idleAtEnd);
+    TEST_ASSERT_FALSE(a.drivingAtEnd);
+}
+
+// =====================================================
+// Exchange Latency
+// =====================================================
+
+void test_exchange_latency_percentiles() {
+    // Randomized taps: pulse phase, clock skew, role. Latency runs from
+    // the first low on the wire to the card holding the peer's UID.
+    static constexpr int RUNS = 40;
+    uint32_t seed = 12345;
+    auto next = [&](uint32_t mod) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 8) % mod;
+    };
+
+    std::vector<uint32_t> latencyMs;
+    for (int i = 0; i < RUNS; i++) {
+        bool cardHigh = next(2);
+        v1::Config c = peerConfig(cardHigh ? UID_LOW : UID_HIGH);
+        c.firstPulseUs = 5000 + next(90000);
+        c.replyLatencyUs = next(1000);
+        SimWire wire;
+        wire.port(1).setSkewPpm((int32_t)next(4001) - 2000);
+        CardLog card;
+        v1::Log peer;
+        runAgainstV1(wire, cardHigh ? UID_HIGH : UID_LOW, c, card, peer);
+        TEST_ASSERT_TRUE(card.linked);
+        TEST_ASSERT_FALSE(wire.edges().empty());
+        latencyMs.push_back((uint32_t)((card.linkedNs - wire.edges().front().ns) / 1000000));
+    }
+
+    std::sort(latencyMs.begin(), latencyMs.end());
+    auto pct = [&](int p) { return latencyMs[(latencyMs.size() - 1) * p / 100]; };
+    char msg[96];
+    snprintf(msg, sizeof(msg), "exchange latency ms: p50=%u p90=%u p99=%u max=%u (n=%d)",
+             (unsigned)pct(50), (unsigned)pct(90), (unsigned)pct(99), (unsigned)latencyMs.back(), RUNS);
+    TEST_MESSAGE(msg);
+
+    // Envelope: negotiation + two command intervals + SEND_ID and the
+    // ID reply, both 13 bytes on the wire
+    TEST_ASSERT_LESS_THAN_UINT32(3000, pct(99));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_v1_peer_as_slave);
+    RUN_TEST(test_v1_peer_as_master);
+    RUN_TEST(test_v1_slave_main_loop_latency);
+    RUN_TEST(test_v1_tie_on_first_32_bits);
+    RUN_TEST(test_v1_loser_takes_master);
+    RUN_TEST(test_card_vs_card);
+    RUN_TEST(test_stopped_cards_link);
+    RUN_TEST(test_slave_response_envelope);
+    RUN_TEST(test_clock_skew);
+    RUN_TEST(test_late_sync);
+    RUN_TEST(test_stuck_low_line);
+    RUN_TEST(test_disconnect_mid_byte);
+    RUN_TEST(test_exchange_latency_percentiles);
+    return UNITY_END();
+}
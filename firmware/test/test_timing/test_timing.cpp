@@ -0,0 +1,161 @@
+// =====================================================
+// Timing Unit Tests
+// =====================================================
+// Runs the timer-driven components (StatusDisplay, Buzzer)
+// against VirtualClock, so multi-second LED patterns and
+// melodies complete without real waiting.
+//
+// Run with: pio test -e native
+// =====================================================
+
+#include <unity.h>
+#include "../virtual_clock.h"
+
+// The native env builds no firmware sources; pull in the
+// portable units under test directly.
+#include "../../src/platform_timing.cpp"
+#include "../../src/status_display.cpp"
+#include "../../src/buzzer.cpp"
+
+// =====================================================
+// Fake GPIO / Buzzer HAL
+// =====================================================
+
+static constexpr uint32_t LED0 = 13;
+static constexpr uint32_t LED1 = 12;
+
+static bool g_led0Level;
+static uint32_t g_led0Edges;
+static uint32_t g_toneCount;
+static bool g_tonePlaying;
+
+void platform_gpio_pin_mode(uint32_t, platform_gpio_mode_t) {}
+
+bool platform_gpio_read(uint32_t) { return true; }
+
+void platform_gpio_write(uint32_t pin, platform_gpio_state_t state) {
+    if (pin != LED0) {
+        return;
+    }
+    bool level = (state == PLATFORM_GPIO_HIGH);
+    if (level != g_led0Level) {
+        g_led0Edges++;
+    }
+    g_led0Level = level;
+}
+
+void platform_buzzer_init(uint32_t) {}
+void platform_buzzer_tone(uint32_t) { g_tonePlaying = true; }
+void platform_buzzer_tone_duration(uint32_t, uint32_t) { g_toneCount++; g_tonePlaying = true; }
+void platform_buzzer_stop() { g_tonePlaying = false; }
+bool platform_buzzer_is_playing() { return g_tonePlaying; }
+void platform_buzzer_loop() {}
+
+// =====================================================
+// Test Fixtures
+// =====================================================
+
+VirtualClock vclock;
+
+void setUp() {
+    vclock.reset();
+    vclock.install();
+    g_led0Level = false;
+    g_led0Edges = 0;
+    g_toneCount = 0;
+    g_tonePlaying = false;
+}
+
+void tearDown() {
+    vclock.uninstall();
+}
+
+// =====================================================
+// Test Cases
+// =====================================================
+
+void test_delays_advance_virtual_time() {
+    platform_delay_ms(5000);
+    TEST_ASSERT_EQUAL_UINT32(5000, platform_millis());
+
+    platform_delay_us(250);
+    TEST_ASSERT_EQUAL_UINT32(5000250, platform_micros());
+    TEST_ASSERT_EQUAL_UINT32(2, vclock.delayCount());
+}
+
+void test_deadline_hint_keeps_earliest() {
+    platform_timing_hint_deadline_ms(20);
+    platform_timing_hint_deadline_us(7000);
+    platform_timing_hint_deadline_ms(50);
+    TEST_ASSERT_TRUE(vclock.hasDeadline());
+    TEST_ASSERT_EQUAL_UINT64(7000, vclock.deadlineUs());
+
+    uint32_t steps = 0;
+    TEST_ASSERT_TRUE(vclock.runUntilNextDeadline([&] { steps++; }));
+    TEST_ASSERT_EQUAL_UINT32(1, steps);
+    TEST_ASSERT_EQUAL_UINT32(7000, platform_micros());
+    TEST_ASSERT_FALSE(vclock.runUntilNextDeadline([&] { steps++; }));
+}
+
+void test_status_display_blinks_at_deadlines() {
+    const uint32_t pins[] = {LED0, LED1};
+    StatusDisplay display;
+    display.begin(pins, 2);
+    display.setReadyPattern(StatusDisplay::ReadyPattern::Idle);  // 120 on / 880 off
+    TEST_ASSERT_TRUE(g_led0Level);
+
+    uint32_t steps = vclock.runForMs(10000, [&] { display.loop(); });
+
+    // Ten full cycles; the loop only ran at pattern boundaries
+    TEST_ASSERT_EQUAL_UINT32(1 + 20, g_led0Edges);
+    TEST_ASSERT_TRUE(g_led0Level);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(2 + 20, steps);
+}
+
+void test_buzzer_melody_completes_in_virtual_time() {
+    Buzzer buzzer;
+    buzzer.begin(7);
+    buzzer.playSuccessTone();
+    TEST_ASSERT_TRUE(buzzer.isPlaying());
+
+    // 50 + 30 + 50 + 30 + 100 ms
+    while (buzzer.isPlaying() && vclock.nowMs() < 1000) {
+        buzzer.loop();
+        if (!vclock.runUntilNextDeadline([] {})) {
+            break;
+        }
+    }
+
+    TEST_ASSERT_FALSE(buzzer.isPlaying());
+    TEST_ASSERT_EQUAL_UINT32(3, g_toneCount);
+    TEST_ASSERT_EQUAL_UINT32(260, vclock.nowMs());
+}
+
+void test_buzzer_scheduled_tone_fires_after_delay() {
+    Buzzer buzzer;
+    buzzer.begin(7);
+    buzzer.scheduleSuccessTone(1500);
+
+    buzzer.loop();
+    TEST_ASSERT_EQUAL_UINT32(0, g_toneCount);
+    TEST_ASSERT_TRUE(vclock.runUntilNextDeadline([&] { buzzer.loop(); }));
+
+    TEST_ASSERT_EQUAL_UINT32(1500, vclock.nowMs());
+    TEST_ASSERT_EQUAL_UINT32(1, g_toneCount);
+}
+
+// =====================================================
+// Test Runner
+// =====================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_delays_advance_virtual_time);
+    RUN_TEST(test_deadline_hint_keeps_earliest);
+    RUN_TEST(test_status_display_blinks_at_deadlines);
+    RUN_TEST(test_buzzer_melody_completes_in_virtual_time);
+    RUN_TEST(test_buzzer_scheduled_tone_fires_after_delay);
+
+    return UNITY_END();
+}
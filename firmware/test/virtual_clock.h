@@ -0,0 +1,146 @@
+#pragma once
+// =====================================================
+// Virtual Clock for Unit Testing
+// =====================================================
+// platform_timing backend driven by simulated time.
+// Delays advance the clock instantly, and components that
+// report their next deadline via platform_timing_hint_deadline_*()
+// can be stepped straight from one deadline to the next, so
+// seconds of firmware behaviour run in microseconds.
+//
+// Usage:
+//   VirtualClock clock;
+//   clock.install();
+//   clock.runForMs(1000, [&] { display.loop(); });
+//   clock.uninstall();
+// =====================================================
+
+#include <stdint.h>
+#include "platform_timing.h"
+
+class VirtualClock {
+public:
+    VirtualClock() { reset(); }
+
+    void reset() {
+        _nowUs = 0;
+        _autoAdvanceUs = 0;
+        _hasDeadline = false;
+        _deadlineUs = 0;
+        _delayCount = 0;
+    }
+
+    void install() {
+        _backend.millis = &VirtualClock::onMillis;
+        _backend.micros = &VirtualClock::onMicros;
+        _backend.delay_ms = &VirtualClock::onDelayMs;
+        _backend.delay_us = &VirtualClock::onDelayUs;
+        _backend.deadline_hint = &VirtualClock::onDeadlineHint;
+        _backend.ctx = this;
+        platform_timing_set_backend(&_backend);
+    }
+
+    void uninstall() {
+        platform_timing_set_backend(nullptr);
+    }
+
+    // Simulated time
+    uint64_t nowUs() const { return _nowUs; }
+    uint32_t nowMs() const { return static_cast<uint32_t>(_nowUs / 1000); }
+    void advanceUs(uint64_t us) { _nowUs += us; }
+    void advanceMs(uint32_t ms) { _nowUs += static_cast<uint64_t>(ms) * 1000; }
+
+    // Advance by this much on every clock read, so busy-wait loops
+    // that poll micros() without delaying still make progress.
+    void setAutoAdvanceUs(uint32_t us) { _autoAdvanceUs = us; }
+
+    // Number of platform_delay_*() calls seen
+    uint32_t delayCount() const { return _delayCount; }
+
+    // Earliest deadline hinted since the last step
+    bool hasDeadline() const { return _hasDeadline; }
+    uint64_t deadlineUs() const { return _deadlineUs; }
+
+    // Jump to the earliest hinted deadline and call step() once.
+    // Returns false (without stepping) if nothing is pending.
+    template <typename Step>
+    bool runUntilNextDeadline(Step step) {
+        if (!_hasDeadline) {
+            return false;
+        }
+        jumpTo(_deadlineUs);
+        _hasDeadline = false;
+        step();
+        return true;
+    }
+
+    // Call step() now, then at every hinted deadline until durationMs
+    // of simulated time has passed. Returns the number of steps run.
+    template <typename Step>
+    uint32_t runForMs(uint32_t durationMs, Step step) {
+        uint64_t endUs = _nowUs + static_cast<uint64_t>(durationMs) * 1000;
+        uint32_t steps = 0;
+
+        _hasDeadline = false;
+        step();
+        steps++;
+
+        while (_nowUs < endUs) {
+            if (_hasDeadline && _deadlineUs < endUs) {
+                jumpTo(_deadlineUs);
+            } else {
+                _nowUs = endUs;
+            }
+            _hasDeadline = false;
+            step();
+            steps++;
+        }
+        return steps;
+    }
+
+private:
+    // Always move forward so a deadline hinted as "due now" cannot stall
+    void jumpTo(uint64_t targetUs) {
+        _nowUs = (targetUs > _nowUs) ? targetUs : _nowUs + 1;
+    }
+
+    static uint32_t onMillis(void* ctx) {
+        VirtualClock* self = static_cast<VirtualClock*>(ctx);
+        self->_nowUs += self->_autoAdvanceUs;
+        return static_cast<uint32_t>(self->_nowUs / 1000);
+    }
+
+    static uint32_t onMicros(void* ctx) {
+        VirtualClock* self = static_cast<VirtualClock*>(ctx);
+        self->_nowUs += self->_autoAdvanceUs;
+        return static_cast<uint32_t>(self->_nowUs);
+    }
+
+    static void onDelayMs(void* ctx, uint32_t ms) {
+        VirtualClock* self = static_cast<VirtualClock*>(ctx);
+        self->_nowUs += static_cast<uint64_t>(ms) * 1000;
+        self->_delayCount++;
+    }
+
+    static void onDelayUs(void* ctx, uint32_t us) {
+        VirtualClock* self = static_cast<VirtualClock*>(ctx);
+        self->_nowUs += us;
+        self->_delayCount++;
+    }
+
+    static void onDeadlineHint(void* ctx, uint32_t inUs) {
+        VirtualClock* self = static_cast<VirtualClock*>(ctx);
+        uint64_t at = self->_nowUs + inUs;
+        if (!self->_hasDeadline || at < self->_deadlineUs) {
+            self->_deadlineUs = at;
+            self->_hasDeadline = true;
+        }
+    }
+
+    platform_timing_backend_t _backend;
+    uint64_t _nowUs;
+    uint32_t _autoAdvanceUs;
+    bool _hasDeadline;
+    uint64_t _deadlineUs;
+    uint32_t _delayCount;
+};
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+r"""Compare two firmware benchmark result files.
+
+Usage examples (PowerShell):
+  .\.pio\build\bench\program.exe --out base.json
+  # ... make a change, rebuild ...
+  .\.pio\build\bench\program.exe --out new.json
+  python .\utils\bench_compare.py base.json new.json
+  python .\utils\bench_compare.py base.json new.json --threshold 10
+
+Compares median ns/op per benchmark. Exits with status 1 if any benchmark
+got slower than --threshold percent (default 5), so it can gate CI.
+"""
+from __future__ import annotations
+import argparse
+import json
+import sys
+from typing import Dict
+
+
+def load_results(path: str) -> Dict[str, dict]:
+    with open(path, 'r', encoding='utf-8') as fh:
+        data = json.load(fh)
+    return {r['name']: r for r in data.get('results', [])}
+
+
+def main() -> int:
+    ap = argparse.ArgumentParser(description='Compare firmware benchmark JSON results')
+    ap.add_argument('base', help='Baseline results (JSON from the bench env)')
+    ap.add_argument('new', help='New results')
+    ap.add_argument('--threshold', type=float, default=5.0,
+                    help='Regression threshold in percent (default 5)')
+    args = ap.parse_args()
+
+    base = load_results(args.base)
+    new = load_results(args.new)
+
+    regressed = False
+    print(f"{'benchmark':<28}{'base':>12}{'new':>12}{'delta':>10}")
+    for name in sorted(set(base) | set(new)):
+        if name not in base or name not in new:
+            print(f"{name:<28}{'(only in ' + ('base' if name in base else 'new') + ')':>34}")
+            continue
+        b = base[name]['median']
+        n = new[name]['median']
+        delta = (n - b) / b * 100.0 if b else 0.0
+        mark = ''
+        if delta > args.threshold:
+            mark = '  SLOWER'
+            regressed = True
+        elif delta < -args.threshold:
+            mark = '  faster'
+        print(f"{name:<28}{b:>12.2f}{n:>12.2f}{delta:>9.1f}%{mark}")
+
+    return 1 if regressed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+r"""Back up, restore and migrate a Bokaka card's storage image.
+
+Usage examples (PowerShell):
+  python .\utils\image_transfer.py backup  --port COM3 card.bin
+  python .\utils\image_transfer.py restore --port COM4 card.bin
+  python .\utils\image_transfer.py migrate --from COM3 --to COM4
+
+Talks the IMAGE_* commands (see docs/USB_SERIAL_DESIGN.md):
+IMAGE_BEGIN hands out a nonce, IMAGE_AUTH answers it with
+HMAC-SHA256(card key, b"IMG1" + uid + nonce) using the key stored
+by provision.py, then the image moves in CRC-checked binary chunks.
+
+A write that fails (bad CRC, lost bytes, unplugged cable) resumes at
+the offset the card reports as "next"; restore re-runs IMAGE_BEGIN and
+IMAGE_AUTH after reconnecting and carries on from there.
+
+The image contains the source card's secret key, so treat backup files
+like provision_keys.json. On restore the target card keeps its own UID
+and key; only taps and links are taken from the image.
+
+Dependencies: `pyserial` (install with `pip install pyserial`)
+"""
+from __future__ import annotations
+import argparse
+import hashlib
+import hmac
+import json
+import struct
+import sys
+import time
+from pathlib import Path
+from typing import Optional
+
+import serial
+
+KEYSTORE_PATH = Path(__file__).resolve().parent / "provision_keys.json"
+
+STORAGE_MAGIC = 0x424F4B41  # "BOKA"
+HEADER_FMT = '<IHHI'        # magic, version, length, crc32
+HEADER_LEN = struct.calcsize(HEADER_FMT)
+PAYLOAD_FMT = '<12sIHBB'    # selfId, totalTapCount, linkCount, keyVersion, reserved8
+
+RESUME_ATTEMPTS = 5
+
+
+class ImageError(Exception):
+    pass
+
+
+def crc32_stm32(data: bytes) -> int:
+    """Same as crc32_stm32_sw(): poly 0x04C11DB7, init 0xFFFFFFFF,
+    little-endian words fed MSB first, no reflection, no final XOR."""
+    if len(data) % 4:
+        raise ValueError("length must be a multiple of 4")
+    crc = 0xFFFFFFFF
+    for (word,) in struct.iter_unpack('<I', data):
+        crc ^= word
+        for _ in range(32):
+            crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else (crc << 1)
+            crc &= 0xFFFFFFFF
+    return crc
+
+
+def describe_image(image: bytes) -> dict:
+    """Check header and payload CRC; return a short summary."""
+    magic, version, length, crc = struct.unpack_from(HEADER_FMT, image)
+    if magic != STORAGE_MAGIC or version != 1:
+        raise ImageError(f"bad header (magic {magic:08X}, version {version})")
+    payload = image[HEADER_LEN:HEADER_LEN + length]
+    if len(payload) != length or crc32_stm32(payload) != crc:
+        raise ImageError("payload CRC mismatch")
+    uid, taps, links, key_version, _ = struct.unpack_from(PAYLOAD_FMT, payload)
+    return {'uid': uid.hex().upper(), 'totalTapCount': taps,
+            'linkCount': links, 'keyVersion': key_version}
+
+
+def load_key(device_id: str, store_path: Path) -> bytes:
+    try:
+        store = json.loads(store_path.read_text())
+    except (OSError, ValueError) as e:
+        raise ImageError(f"cannot read key store {store_path}: {e}")
+    entry = store.get(device_id.upper())
+    if not entry:
+        raise ImageError(f"no key for {device_id} in {store_path}")
+    return bytes.fromhex(entry['secret_key'])
+
+
+class Card:
+    """One card on a serial port, speaking the IMAGE_* commands."""
+
+    def __init__(self, port: str, baud: int, store_path: Path):
+        self.port = port
+        self.baud = baud
+        self.store_path = store_path
+        self.ser: Optional[serial.Serial] = None
+        self.device_id = ""
+        self.size = 0
+        self.chunk = 0
+        self.next = 0
+
+    def open(self) -> None:
+        self.ser = serial.Serial(self.port, baudrate=self.baud, timeout=0.2)
+        time.sleep(0.1)
+        self.ser.reset_input_buffer()
+
+    def close(self) -> None:
+        if self.ser:
+            self.ser.close()
+            self.ser = None
+
+    def command(self, line: str, payload: bytes = b"") -> None:
+        self.ser.write(line.encode() + b"\n" + payload)
+        self.ser.flush()
+
+    def read_event(self, timeout: float = 3.0) -> dict:
+        """Next JSON line (logs and other events are skipped by the caller)."""
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            raw = self.ser.readline()
+            if not raw:
+                continue
+            text = raw.decode(errors='ignore').strip()
+            if text.startswith('{'):
+                try:
+                    return json.loads(text)
+                except ValueError:
+                    continue
+        raise ImageError(f"{self.port}: no response")
+
+    def expect(self, event: str, timeout: float = 3.0) -> dict:
+        while True:
+            data = self.read_event(timeout)
+            if data.get('event') == 'error':
+                self.next = data.get('next', self.next)
+                raise ImageError(f"{self.port}: {data.get('msg')}")
+            if data.get('event') == event:
+                return data
+
+    def authenticate(self) -> None:
+        self.command("HELLO")
+        self.device_id = self.expect('hello')['device_id'].upper()
+        key = load_key(self.device_id, self.store_path)
+
+        self.command("IMAGE_BEGIN")
+        begin = self.expect('image_begin')
+        self.size, self.chunk = begin['size'], begin['chunk']
+        nonce = bytes.fromhex(begin['nonce'])
+        msg = b"IMG1" + bytes.fromhex(self.device_id) + nonce
+        mac = hmac.new(key, msg, hashlib.sha256).hexdigest().upper()
+
+        self.command(f"IMAGE_AUTH {mac}")
+        self.next = self.expect('image_auth')['next']
+
+    def read_image(self) -> bytes:
+        image = bytearray()
+        while len(image) < self.size:
+            off = len(image)
+            n = min(self.chunk, self.size - off)
+            self.command(f"IMAGE_READ {off} {n}")
+            head = self.expect('image_data')
+            data = self.ser.read(head['len'])
+            if len(data) != head['len'] or crc32_stm32(data) != int(head['crc'], 16):
+                self.ser.reset_input_buffer()
+                continue  # ask for the same chunk again
+            image += data
+        return bytes(image)
+
+    def write_image(self, image: bytes) -> dict:
+        while self.next < self.size:
+            off = self.next
+            chunk = image[off:off + self.chunk]
+            self.command(f"IMAGE_WRITE {off} {len(chunk)} {crc32_stm32(chunk):08X}", chunk)
+            self.next = self.expect('image_ack')['next']
+        self.command("IMAGE_COMMIT")
+        return self.expect('image_commit')
+
+
+def with_resume(card: Card, action):
+    """Run action(card) after authenticating; reconnect and retry on failure."""
+    for attempt in range(1, RESUME_ATTEMPTS + 1):
+        try:
+            card.open()
+            card.authenticate()
+            return action(card)
+        except (ImageError, serial.SerialException, OSError) as e:
+            if attempt == RESUME_ATTEMPTS:
+                raise ImageError(str(e))
+            print(f"{card.port}: {e}; resuming at {card.next} ({attempt}/{RESUME_ATTEMPTS})")
+            time.sleep(1.0)
+        finally:
+            card.close()
+
+
+def backup(card: Card) -> bytes:
+    # A tap between chunks leaves a torn image; the CRC check catches it
+    for _ in range(RESUME_ATTEMPTS):
+        image = with_resume(card, Card.read_image)
+        try:
+            info = describe_image(image)
+            print(f"{card.port}: read {len(image)} bytes, uid {info['uid']}, "
+                  f"{info['totalTapCount']} taps, {info['linkCount']} links")
+            return image
+        except ImageError as e:
+            print(f"{card.port}: {e}; reading again")
+    raise ImageError("image kept changing during backup")
+
+
+def restore(card: Card, image: bytes) -> None:
+    info = describe_image(image)
+    print(f"restoring image from {info['uid']} "
+          f"({info['totalTapCount']} taps, {info['linkCount']} links)")
+    result = with_resume(card, lambda c: c.write_image(image))
+    print(f"{card.port}: committed, {result['totalTapCount']} taps, "
+          f"{result['linkCount']} links")
+
+
+def main(argv: Optional[list] = None) -> int:
+    p = argparse.ArgumentParser(description="Bokaka storage image backup / restore")
+    p.add_argument('--baud', type=int, default=115200)
+    p.add_argument('--store', type=Path, default=KEYSTORE_PATH,
+                   help="key store written by provision.py")
+    sub = p.add_subparsers(dest='action', required=True)
+
+    b = sub.add_parser('backup', help="read a card's image into a file")
+    b.add_argument('--port', required=True)
+    b.add_argument('file', type=Path)
+
+    r = sub.add_parser('restore', help="write an image file onto a card")
+    r.add_argument('--port', required=True)
+    r.add_argument('file', type=Path)
+
+    m = sub.add_parser('migrate', help="copy taps and links from one card to another")
+    m.add_argument('--from', dest='src', required=True)
+    m.add_argument('--to', dest='dst', required=True)
+
+    args = p.parse_args(argv)
+    try:
+        if args.action == 'backup':
+            image = backup(Card(args.port, args.baud, args.store))
+            args.file.write_bytes(image)
+        elif args.action == 'restore':
+            restore(Card(args.port, args.baud, args.store), args.file.read_bytes())
+        else:
+            image = backup(Card(args.src, args.baud, args.store))
+            restore(Card(args.dst, args.baud, args.store), image)
+    except (ImageError, OSError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+r"""Compressed link export (mirror of link_export_encode() in src/sync_format.cpp).
+
+Usage examples (PowerShell):
+  python .\utils\link_export.py                       # round-trip the key store UIDs
+  python .\utils\link_export.py --port COM3           # fetch DUMPZ, compare with DUMP
+  python .\utils\link_export.py --port COM3 --snap 2  # from a SNAPSHOT
+
+DUMPZ answers with a `links_z` reply and then `len` raw bytes:
+
+  version (1)  count (varint)
+  count entries sorted by UID: suffix length (varint) + suffix bytes,
+      the prefix repeats the previous UID (the first is against zeros)
+  count varints: arrival index of each sorted entry
+
+decode() returns the links in arrival order, i.e. the order DUMP lists
+them and SIGN_STATE signs them.
+
+Dependencies: `pyserial` only for --port (install with `pip install pyserial`)
+"""
+from __future__ import annotations
+import argparse
+import json
+import os
+import sys
+import time
+from typing import List, Tuple
+
+UID_LEN = 12
+VERSION = 1
+
+
+def _put_varint(v: int) -> bytes:
+    out = bytearray()
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+    return bytes(out)
+
+
+def _get_varint(buf: bytes, pos: int) -> Tuple[int, int]:
+    result = 0
+    shift = 0
+    while pos < len(buf):
+        b = buf[pos]
+        pos += 1
+        result |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return result, pos
+        shift += 7
+        if shift > 28:
+            break
+    raise ValueError('bad varint')
+
+
+def encode(links: List[bytes]) -> bytes:
+    order = sorted(range(len(links)), key=lambda i: links[i])
+    out = bytearray([VERSION])
+    out += _put_varint(len(links))
+    prev = bytes(UID_LEN)
+    for i in order:
+        uid = links[i]
+        shared = 0
+        while shared < UID_LEN and uid[shared] == prev[shared]:
+            shared += 1
+        out += _put_varint(UID_LEN - shared)
+        out += uid[shared:]
+        prev = uid
+    for i in order:
+        out += _put_varint(i)
+    return bytes(out)
+
+
+def decode(data: bytes) -> List[bytes]:
+    if not data or data[0] != VERSION:
+        raise ValueError(f'unsupported export version {data[0] if data else None}')
+    count, pos = _get_varint(data, 1)
+    sorted_uids = []
+    prev = bytes(UID_LEN)
+    for _ in range(count):
+        suffix, pos = _get_varint(data, pos)
+        if suffix > UID_LEN or pos + suffix > len(data):
+            raise ValueError('bad entry')
+        uid = prev[:UID_LEN - suffix] + data[pos:pos + suffix]
+        pos += suffix
+        sorted_uids.append(uid)
+        prev = uid
+    links: List[bytes] = [b''] * count
+    for uid in sorted_uids:
+        index, pos = _get_varint(data, pos)
+        if index >= count or links[index]:
+            raise ValueError('bad arrival index')
+        links[index] = uid
+    if pos != len(data):
+        raise ValueError('trailing bytes')
+    return links
+
+
+def dump_json_len(links: List[bytes]) -> int:
+    """Bytes a DUMP reply for the same links takes on the wire."""
+    items = [{'peer': uid.hex().upper()} for uid in links]
+    line = json.dumps({'event': 'links', 'offset': 0, 'count': len(links), 'items': items},
+                      separators=(',', ':'))
+    return len(line) + 2
+
+
+def report(links: List[bytes], data: bytes) -> None:
+    dump = dump_json_len(links)
+    raw = len(links) * UID_LEN
+    ratio = dump / len(data) if data else 0
+    print(f'links: {len(links)}  DUMPZ: {len(data)} bytes  raw UIDs: {raw}  '
+          f'DUMP JSON: {dump}  ({ratio:.1f}x smaller)')
+
+
+def load_uids(path: str) -> List[bytes]:
+    with open(path, 'r', encoding='utf-8') as fh:
+        data = json.load(fh)
+    uids = []
+    for dev_id in data.keys():
+        try:
+            raw = bytes.fromhex(dev_id)
+        except ValueError:
+            continue
+        if len(raw) == UID_LEN:
+            uids.append(raw)
+    return uids
+
+
+def validate(uids: List[bytes]) -> int:
+    data = encode(uids)
+    if decode(data) != uids:
+        print('ROUNDTRIP FAIL', file=sys.stderr)
+        return 1
+    report(uids, data)
+    return 0
+
+
+def read_json(ser, event: str, timeout: float = 3.0) -> dict:
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        text = ser.readline().decode(errors='ignore').strip()
+        if not text.startswith('{'):
+            continue
+        try:
+            msg = json.loads(text)
+        except ValueError:
+            continue
+        if msg.get('event') == 'error':
+            raise RuntimeError(msg.get('msg'))
+        if msg.get('event') == event:
+            return msg
+    raise RuntimeError(f'no {event} reply')
+
+
+def fetch(port: str, baud: int, snap: str) -> int:
+    import serial
+    with serial.Serial(port, baudrate=baud, timeout=0.2) as ser:
+        time.sleep(0.1)
+        ser.reset_input_buffer()
+        suffix = f' {snap}' if snap else ''
+
+        ser.write(f'DUMPZ{suffix}\n'.encode())
+        head = read_json(ser, 'links_z')
+        data = ser.read(head['len'])
+        if len(data) != head['len']:
+            raise RuntimeError(f"short read: {len(data)} of {head['len']} bytes")
+        links = decode(data)
+        if len(links) != head['linkCount']:
+            raise RuntimeError(f"decoded {len(links)} links, card reports {head['linkCount']}")
+
+        # DUMP must list the same links in the same order
+        ser.write(f"DUMP 0 {head['linkCount']}{suffix}\n".encode())
+        dumped = [bytes.fromhex(it['peer']) for it in read_json(ser, 'links')['items']]
+        if dumped != links:
+            raise RuntimeError('DUMPZ does not match DUMP')
+
+    for uid in links:
+        print(uid.hex().upper())
+    report(links, data)
+    return 0
+
+
+def main() -> int:
+    default_keys = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'provision_keys.json')
+    ap = argparse.ArgumentParser(description='Compressed link export codec')
+    ap.add_argument('--keys', default=default_keys, help='Key store JSON (device IDs as keys)')
+    ap.add_argument('--port', help='Fetch DUMPZ from a card on this serial port')
+    ap.add_argument('--baud', type=int, default=115200)
+    ap.add_argument('--snap', help='Snapshot id from SNAPSHOT')
+    args = ap.parse_args()
+
+    if args.port:
+        try:
+            return fetch(args.port, args.baud, args.snap)
+        except (RuntimeError, ValueError, OSError) as e:
+            print(f'error: {e}', file=sys.stderr)
+            return 1
+    return validate(load_uids(args.keys))
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -6,7 +6,9 @@ Behavior:
 - Waits for a new serial port to appear (or uses `--port` if provided).
 - Sends `HELLO` to read device info (device_id, fw, ...).
 - Generates a 32-byte random secret key, sends `PROVISION_KEY <ver> <hex>`.
-- Calls `GET_STATE` and `DUMP` to collect state, then `SIGN_STATE <nonce>`.
+- Calls `SYNC <nonce>`, which returns state, links and signature in one reply.
+  Firmware without SYNC falls back to `SNAPSHOT`, `DUMP ... <snap>` and
+  `SIGN_STATE <nonce> <snap>`, so a tap in between cannot invalidate the sync.
 - Verifies returned HMAC locally using the generated key.
 - Stores mapping in a JSON file (`utils/provision_keys.json` by default).
 
@@ -390,6 +392,75 @@ def list_serial_ports() -> List[str]:
     return [p.device for p in list_ports.comports()]
 
 
+def _uid_from_serial_number(sn: Optional[str]) -> Optional[str]:
+    if not sn or len(sn) != 24:
+        return None
+    try:
+        bytes.fromhex(sn)
+    except ValueError:
+        return None
+    return sn.upper()
+
+
+def port_serial_number(port: str) -> Optional[str]:
+    """Return the port's USB iSerialNumber as reported by list_ports, or None."""
+    for p in list_ports.comports():
+        if p.device == port:
+            return p.serial_number or None
+    return None
+
+
+def learned_device_ids(store_path: Path) -> Dict[str, str]:
+    """Map USB serial numbers recorded in the key store to device IDs."""
+    if not store_path.exists():
+        return {}
+    try:
+        data = json.loads(store_path.read_text())
+    except Exception:
+        return {}
+    learned = {}
+    for dev_id, entry in data.items():
+        sn = entry.get("usb_serial") if isinstance(entry, dict) else None
+        if sn:
+            learned[sn] = dev_id
+    return learned
+
+
+def remember_usb_serial(store_path: Path, dev_id: Optional[str], sn: Optional[str]) -> None:
+    """Record the USB serial a provisioned card enumerated with, for later runs."""
+    if not dev_id or not sn or _uid_from_serial_number(sn) or not store_path.exists():
+        return
+    try:
+        data = json.loads(store_path.read_text())
+        entry = data.get(dev_id)
+        if not isinstance(entry, dict) or entry.get("usb_serial") == sn:
+            return
+        # A serial belongs to one card; drop it from any stale entry
+        for other in data.values():
+            if isinstance(other, dict) and other.get("usb_serial") == sn:
+                del other["usb_serial"]
+        entry["usb_serial"] = sn
+        store_path.write_text(json.dumps(data, indent=2))
+    except Exception:
+        pass
+
+
+def port_device_id(port: str, store_path: Path = KEYSTORE_PATH) -> Optional[str]:
+    """Return the device ID for a port without opening it, or None.
+
+    Firmware that derives iSerialNumber from the 96-bit UID (the CubeIDE
+    build) reports it as 24 hex chars, identical to HELLO's device_id. The
+    STM32duino core reports a 12-char serial that mixes in a word outside
+    the UID, so it cannot be computed from device_id; it is looked up in
+    the serials the key store learned from earlier HELLOs instead. Unknown
+    serials return None; callers fall back to HELLO.
+    """
+    sn = port_serial_number(port)
+    if not sn:
+        return None
+    return _uid_from_serial_number(sn) or learned_device_ids(store_path).get(sn)
+
+
 def wait_for_port(existing: List[str], timeout: Optional[float]) -> Optional[str]:
     """Wait for a new serial port not present in `existing`.
 
@@ -596,7 +667,65 @@ def handle_provision_confirmation(port: str, dev_id: Optional[str], already_prov
     return True
 
 
-def provision_device(ser: serial.Serial, key_version: int = 1, validate: bool = True, store_path: Path = KEYSTORE_PATH, master_key: Optional[bytes] = None, master_signing_key: Optional[Any] = None) -> Dict[str, Any]:
+def sign_state_message(selfid: bytes, nonce: bytes, total_tap_count: int, peers: List[bytes]) -> bytes:
+    # As the device builds it: selfId(12) + nonce + totalTapCount(4 LE) + linkCount(2 LE) + each peer(12)
+    msg = bytearray()
+    msg += selfid
+    msg += nonce
+    msg += int(total_tap_count).to_bytes(4, 'little')
+    msg += int(len(peers)).to_bytes(2, 'little')
+    for p in peers:
+        if len(p) != 12:
+            raise RuntimeError("peer id length unexpected")
+        msg += p
+    return bytes(msg)
+
+
+def sync_message(selfid: bytes, nonce: bytes, total_tap_count: int, since: int, generation: int,
+                 peers: List[bytes]) -> bytes:
+    # "SYNC" + selfId(12) + nonce + totalTapCount(4 LE) + linkCount(2 LE) + since(2 LE)
+    #   + linkGeneration(4 LE) + peers[since:]
+    msg = bytearray(b"SYNC")
+    msg += selfid
+    msg += nonce
+    msg += int(total_tap_count).to_bytes(4, 'little')
+    msg += int(since + len(peers)).to_bytes(2, 'little')
+    msg += int(since).to_bytes(2, 'little')
+    msg += int(generation).to_bytes(4, 'little')
+    for p in peers:
+        if len(p) != 12:
+            raise RuntimeError("peer id length unexpected")
+        msg += p
+    return bytes(msg)
+
+
+def sign_state_legacy(ser: serial.Serial, nonce_hex: str) -> tuple[int, List[bytes], Dict[str, Any]]:
+    # Firmware before SYNC: freeze state so DUMP and SIGN_STATE agree even if a tap lands in between
+    set_status("Validating: SNAPSHOT")
+    send_cmd(ser, "SNAPSHOT")
+    st = read_json_line(ser, timeout=5.0)
+    if not st or st.get("event") != "snapshot":
+        raise RuntimeError(f"SNAPSHOT failed: {st}")
+    snap = int(st.get("snap", 0))
+    totalTapCount = int(st.get("totalTapCount", 0))
+    linkCount = int(st.get("linkCount", 0))
+
+    set_status("Validating: DUMP")
+    send_cmd(ser, f"DUMP 0 {linkCount} {snap}")
+    linksmsg = read_json_line(ser, timeout=5.0)
+    if not linksmsg or linksmsg.get("event") != "links":
+        raise RuntimeError(f"DUMP failed: {linksmsg}")
+    peers = [hex_to_bytes(it.get("peer")) for it in linksmsg.get("items", [])]
+
+    set_status("Validating: SIGN_STATE")
+    send_cmd(ser, f"SIGN_STATE {nonce_hex} {snap}")
+    signed = read_json_line(ser, timeout=2.0)
+    if not signed or signed.get("event") != "SIGNED_STATE":
+        raise RuntimeError(f"SIGN_STATE failed: {signed}")
+    return totalTapCount, peers, signed
+
+
+def provision_device(ser: serial.Serial, key_version: int = 1, validate: bool = True, store_path: Path = KEYSTORE_PATH, master_key: Optional[bytes] = None, master_signing_key: Optional[Any] = None, usb_serial: Optional[str] = None) -> Dict[str, Any]:
     # 1) HELLO
     set_status("Step: HELLO")
     send_cmd(ser, "HELLO")
@@ -672,53 +801,31 @@ def provision_device(ser: serial.Serial, key_version: int = 1, validate: bool =
     time.sleep(10)  # Wait 10 seconds to ensure EEPROM write completes
     cprint("[i] EEPROM write should be complete, proceeding with validation")
 
-    # 4) Optional validation: call GET_STATE, DUMP, then SIGN_STATE with nonce
+    # 4) Optional validation: one SYNC, or SNAPSHOT + DUMP + SIGN_STATE on older firmware
     validation = None
     if validate:
-        # request state
-        set_status("Validating: GET_STATE")
-        send_cmd(ser, "GET_STATE")
-        st = read_json_line(ser, timeout=5.0)  # Increased timeout for safety
-        if not st or st.get("event") != "state":
-            raise RuntimeError(f"GET_STATE failed: {st}")
-        totalTapCount = int(st.get("totalTapCount", 0))
-        linkCount = int(st.get("linkCount", 0))
-
-        # request links
-        set_status("Validating: DUMP")
-        send_cmd(ser, f"DUMP 0 {linkCount}")
-        linksmsg = read_json_line(ser, timeout=5.0)  # Increased timeout for safety
-        if not linksmsg or linksmsg.get("event") != "links":
-            raise RuntimeError(f"DUMP failed: {linksmsg}")
-        items = linksmsg.get("items", [])
-        peers = [hex_to_bytes(it.get("peer")) for it in items]
-
-        # create nonce
         nonce = secrets.token_bytes(16)
         nonce_hex = hex_bytes(nonce)
-
-        set_status("Validating: SIGN_STATE")
-        send_cmd(ser, f"SIGN_STATE {nonce_hex}")
-        signed = read_json_line(ser, timeout=2.0)
-        if not signed or signed.get("event") != "SIGNED_STATE":
-            raise RuntimeError(f"SIGN_STATE failed: {signed}")
-
-        # Build message as device does: selfId(12) + nonce + totalTapCount(4 LE) + linkCount(2 LE) + each peer(12)
         selfid = hex_to_bytes(device_id_hex)
         if len(selfid) != 12:
             raise RuntimeError(f"unexpected device id length: {len(selfid)}")
 
-        msg = bytearray()
-        msg += selfid
-        msg += nonce
-        # totalTapCount 4 bytes little endian
-        msg += int(totalTapCount).to_bytes(4, 'little')
-        # linkCount 2 bytes little endian
-        msg += int(len(peers)).to_bytes(2, 'little')
-        for p in peers:
-            if len(p) != 12:
-                raise RuntimeError("peer id length unexpected")
-            msg += p
+        set_status("Validating: SYNC")
+        send_cmd(ser, f"SYNC {nonce_hex}")
+        signed = read_json_line(ser, timeout=5.0)
+        if signed and signed.get("event") == "sync":
+            totalTapCount = int(signed.get("totalTapCount", 0))
+            since = int(signed.get("since", 0))
+            peers = [hex_to_bytes(it.get("peer")) for it in signed.get("items", [])]
+            if since + len(peers) != int(signed.get("linkCount", 0)):
+                raise RuntimeError(f"SYNC items do not match linkCount: {signed}")
+            generation = int(signed.get("generation", 0))
+            msg = sync_message(selfid, nonce, totalTapCount, since, generation, peers)
+        elif signed and signed.get("event") == "error" and "unknown command" in signed.get("msg", ""):
+            totalTapCount, peers, signed = sign_state_legacy(ser, nonce_hex)
+            msg = sign_state_message(selfid, nonce, totalTapCount, peers)
+        else:
+            raise RuntimeError(f"SYNC failed: {signed}")
 
         # compute HMAC-SHA256
         hm = hmac.new(secret, msg, hashlib.sha256).digest()
@@ -745,6 +852,8 @@ def provision_device(ser: serial.Serial, key_version: int = 1, validate: bool =
         "provisioned_at": int(time.time()),
         "validation": validation,
     }
+    if usb_serial and not _uid_from_serial_number(usb_serial):
+        entry["usb_serial"] = usb_serial
     if signature_hex is not None:
         entry["master_signature"] = signature_hex
         entry["master_public_key"] = master_pub_hex
@@ -788,6 +897,7 @@ def main(argv: Optional[List[str]] = None) -> int:
     p.add_argument("--master-key-pem", help="Path to PEM file containing an Ed25519 private key to sign provisioned secrets.")
     p.add_argument("--no-confirm", dest="no_confirm", action="store_true", help="Skip interactive confirmation prompts and accept provisioning automatically")
     p.add_argument("--once", action="store_true", help="Provision a single device then exit")
+    p.add_argument("--skip-provisioned", action="store_true", help="Skip devices already in the key store, identified from the USB serial number (UID or one learned from an earlier HELLO) without opening the port")
     args = p.parse_args(argv)
 
     # Initialize UI manager early so subsequent output is routed into the
@@ -853,17 +963,23 @@ def main(argv: Optional[List[str]] = None) -> int:
             # If user passed a specific port, provision once (or repeatedly if not --once)
             if args.once:
                 cprint(f"Provisioning {args.port} once...")
+                usb_serial = port_serial_number(args.port)
+                desc_id = port_device_id(args.port, store_path)
+                if args.skip_provisioned and check_already_provisioned(desc_id, store_path):
+                    cprint(f"[i] {args.port}: device {desc_id} already provisioned, skipping")
+                    return 0
                 ser = open_serial(args.port, args.baud, timeout=0.2)
                 try:
                     hello, dev_id = get_device_info(ser)
                     # check if device is already provisioned
                     already_provisioned = check_already_provisioned(dev_id, store_path)
                     if already_provisioned:
+                        remember_usb_serial(store_path, dev_id, usb_serial)
                         cprint(f"[⚠️] Device {dev_id} is already provisioned.")
                         return 0
                     if not handle_provision_confirmation(args.port, dev_id, already_provisioned, args.no_confirm):
                         return 0
-                    entry = provision_device(ser, key_version=args.key_version, validate=not args.no_validate, store_path=store_path, master_key=master_key_bytes, master_signing_key=master_signing_key)
+                    entry = provision_device(ser, key_version=args.key_version, validate=not args.no_validate, store_path=store_path, master_key=master_key_bytes, master_signing_key=master_signing_key, usb_serial=usb_serial)
                     cprint("Provisioning succeeded:")
                     cprint(json.dumps(entry, indent=2))
                 finally:
@@ -875,6 +991,12 @@ def main(argv: Optional[List[str]] = None) -> int:
             while True:
                 cur = list_serial_ports()
                 if args.port in cur:
+                    usb_serial = port_serial_number(args.port)
+                    desc_id = port_device_id(args.port, store_path)
+                    if args.skip_provisioned and check_already_provisioned(desc_id, store_path):
+                        cprint(f"[i] {args.port}: device {desc_id} already provisioned, skipping")
+                        wait_for_removal(args.port)
+                        continue
                     cprint(f"Detected {args.port}, opening...")
                     try:
                         ser = open_serial(args.port, args.baud, timeout=0.2)
@@ -883,6 +1005,7 @@ def main(argv: Optional[List[str]] = None) -> int:
                         already_provisioned = check_already_provisioned(dev_id, store_path)
                         if already_provisioned:
                             cprint(f"[⚠️] Device {dev_id} is already provisioned.")
+                            remember_usb_serial(store_path, dev_id, usb_serial)
                         
                         if not handle_provision_confirmation(args.port, dev_id, already_provisioned, args.no_confirm):
                             try:
@@ -892,7 +1015,7 @@ def main(argv: Optional[List[str]] = None) -> int:
                             time.sleep(0.2)
                             continue
 
-                        entry = provision_device(ser, key_version=args.key_version, validate=not args.no_validate, store_path=store_path, master_key=master_key_bytes, master_signing_key=master_signing_key)
+                        entry = provision_device(ser, key_version=args.key_version, validate=not args.no_validate, store_path=store_path, master_key=master_key_bytes, master_signing_key=master_signing_key, usb_serial=usb_serial)
                         cprint("Provisioning succeeded:")
                         cprint(json.dumps(entry, indent=2))
                     except Exception as e:
@@ -915,6 +1038,11 @@ def main(argv: Optional[List[str]] = None) -> int:
             # Initialize seen set - start empty so existing ports can be detected
             # We'll add ports to seen only after we've attempted to provision them or user skips them
             seen = set()
+            # Device IDs handled this session (from USB serial number or HELLO)
+            handled_ids = set()
+            # USB serial -> device ID learned from HELLO this session, for cards
+            # that are not in the key store (e.g. declined at the prompt)
+            session_ids: Dict[str, str] = {}
             
             while True:
                 # Get current list of ports
@@ -937,17 +1065,37 @@ def main(argv: Optional[List[str]] = None) -> int:
                     # No new port, wait a bit before checking again
                     time.sleep(0.5)
                     continue
-                cprint(f"Detected new port {port}, attempting to provision...")
                 # Add port to seen immediately so we don't try to provision it again in this cycle
                 seen.add(port)
-                
+
+                # Route on the USB serial number first - no round trip needed
+                usb_serial = port_serial_number(port)
+                desc_id = port_device_id(port, store_path) or session_ids.get(usb_serial or "")
+                if desc_id:
+                    if desc_id in handled_ids:
+                        cprint(f"[i] {port}: device {desc_id} already handled this session, skipping")
+                        continue
+                    if args.skip_provisioned and check_already_provisioned(desc_id, store_path):
+                        cprint(f"[i] {port}: device {desc_id} already provisioned, skipping")
+                        handled_ids.add(desc_id)
+                        continue
+
+                cprint(f"Detected new port {port}, attempting to provision...")
+                ser = None
                 try:
                     ser = open_serial(port, args.baud, timeout=0.2)
                     hello, dev_id = get_device_info(ser)
+                    if desc_id and dev_id and desc_id != dev_id.upper():
+                        cprint(f"[⚠️] {port}: USB serial {desc_id} does not match HELLO device_id {dev_id}")
+                    if dev_id:
+                        handled_ids.add(dev_id.upper())
+                        if usb_serial:
+                            session_ids[usb_serial] = dev_id.upper()
                     
                     already_provisioned = check_already_provisioned(dev_id, store_path)
                     if already_provisioned:
                         cprint(f"[⚠️] Device {dev_id} is already provisioned.")
+                        remember_usb_serial(store_path, dev_id, usb_serial)
                     
                     if not handle_provision_confirmation(port, dev_id, already_provisioned, args.no_confirm):
                         try:
@@ -957,7 +1105,7 @@ def main(argv: Optional[List[str]] = None) -> int:
                         # Keep port in seen so it won't be detected again until removed and replugged
                         continue
 
-                    entry = provision_device(ser, key_version=args.key_version, validate=not args.no_validate, store_path=store_path, master_key=master_key_bytes, master_signing_key=master_signing_key)
+                    entry = provision_device(ser, key_version=args.key_version, validate=not args.no_validate, store_path=store_path, master_key=master_key_bytes, master_signing_key=master_signing_key, usb_serial=usb_serial)
                     cprint("Provisioning succeeded:")
                     cprint(json.dumps(entry, indent=2))
                 except Exception as e:
@@ -965,7 +1113,8 @@ def main(argv: Optional[List[str]] = None) -> int:
                     # On error, keep port in seen so we don't immediately retry
                 finally:
                     try:
-                        ser.close()
+                        if ser is not None:
+                            ser.close()
                     except Exception:
                         pass
 
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+r"""Parallel manufacturing self-test runner for Bokaka cards.
+
+Usage examples (PowerShell):
+  python .\utils\selftest_runner.py
+  python .\utils\selftest_runner.py --ports COM3,COM4,COM5
+  python .\utils\selftest_runner.py --watch --log line1.jsonl
+
+Sends SELFTEST to every card on the USB hub at once (one thread per port)
+and prints a pass/fail line per card. Each result is appended to a JSONL
+log together with the port and host time.
+
+By default only ports whose USB serial number is a 24-hex device UID are
+tested (see serial_test.py --list); pass --ports to pick ports explicitly.
+With --watch the runner keeps going and tests each card as it is plugged
+in, so a fixture operator only swaps cards.
+
+Exit status (without --watch): 0 when every card passed, 1 otherwise.
+"""
+from __future__ import annotations
+import argparse
+import json
+import sys
+import threading
+import time
+from typing import Dict, List, Optional
+
+import serial
+from serial.tools import list_ports
+
+from serial_test import port_device_id, read_json_line
+
+BUSY_RETRIES = 3
+BUSY_RETRY_DELAY = 0.5
+
+_print_lock = threading.Lock()
+_log_lock = threading.Lock()
+
+
+def say(msg: str) -> None:
+    with _print_lock:
+        print(msg, flush=True)
+
+
+def card_ports() -> Dict[str, Optional[str]]:
+    """Ports that look like cards, mapped to their device ID."""
+    return {info.device: port_device_id(info)
+            for info in list_ports.comports() if port_device_id(info)}
+
+
+def run_selftest(port: str, baud: int, timeout: float) -> dict:
+    """Run SELFTEST on one port. Always returns a result dict."""
+    result = {'port': port, 'pass': False}
+    try:
+        with serial.Serial(port, baudrate=baud, timeout=0.1) as ser:
+            time.sleep(0.1)
+            ser.reset_input_buffer()
+            for _ in range(BUSY_RETRIES):
+                ser.write(b'SELFTEST\n')
+                ser.flush()
+                deadline = time.time() + timeout
+                data = None
+                while time.time() < deadline:
+                    data = read_json_line(ser, timeout=deadline - time.time())
+                    if data is None or data.get('event') in ('selftest', 'error'):
+                        break
+                if data is None:
+                    result['error'] = 'timeout'
+                    return result
+                if data.get('event') == 'selftest':
+                    result.update(data)
+                    return result
+                result['error'] = data.get('msg', 'error')
+                if data.get('msg') != 'selftest busy':
+                    return result
+                time.sleep(BUSY_RETRY_DELAY)
+    except (serial.SerialException, OSError) as e:
+        result['error'] = str(e)
+    return result
+
+
+def report(result: dict) -> None:
+    port = result['port']
+    card = result.get('id', '-')
+    if 'error' in result and 'failed' not in result:
+        say(f"{port:<10} {card:<24} ERROR  {result['error']}")
+        return
+    verdict = 'PASS ' if result.get('pass') else 'FAIL '
+    failed = ','.join(result.get('failed', [])) or '-'
+    stall = result.get('stall_us', [0, 0])
+    say(f"{port:<10} {card:<24} {verdict} failed={failed}  "
+        f"{result.get('ms', 0)}ms  nvm stall flash/ram={stall[0]}/{stall[1]}us")
+
+
+def log_result(path: Optional[str], result: dict) -> None:
+    if not path:
+        return
+    entry = dict(result, host_time=time.time())
+    with _log_lock, open(path, 'a', encoding='utf-8') as f:
+        f.write(json.dumps(entry) + '\n')
+
+
+def test_ports(ports: List[str], args) -> List[dict]:
+    results: List[dict] = []
+
+    def worker(port: str) -> None:
+        result = run_selftest(port, args.baud, args.timeout)
+        report(result)
+        log_result(args.log, result)
+        results.append(result)
+
+    threads = [threading.Thread(target=worker, args=(p,), daemon=True) for p in ports]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return results
+
+
+def watch(args) -> None:
+    """Test each card once per plug-in until Ctrl-C."""
+    tested: Dict[str, threading.Thread] = {}
+    say('Watching for cards (Ctrl-C to stop).')
+    try:
+        while True:
+            present = card_ports()
+            for port in list(tested):
+                if port not in present and not tested[port].is_alive():
+                    del tested[port]   # unplugged: test again on the next insert
+            for port in present:
+                if port not in tested:
+                    t = threading.Thread(target=test_ports, args=([port], args), daemon=True)
+                    tested[port] = t
+                    t.start()
+            time.sleep(0.5)
+    except KeyboardInterrupt:
+        print()
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    p = argparse.ArgumentParser(description='Run SELFTEST on every connected card in parallel')
+    p.add_argument('--ports', help='Comma-separated ports (default: every port with a device-ID serial number)')
+    p.add_argument('--baud', type=int, default=115200)
+    p.add_argument('--timeout', type=float, default=5.0, help='Per-card response timeout (s)')
+    p.add_argument('--log', default='selftest_log.jsonl', help='Append results to this JSONL file ("" to disable)')
+    p.add_argument('--watch', action='store_true', help='Keep running and test cards as they are plugged in')
+    args = p.parse_args(argv)
+
+    if args.watch:
+        watch(args)
+        return 0
+
+    ports = [s.strip() for s in args.ports.split(',') if s.strip()] if args.ports else sorted(card_ports())
+    if not ports:
+        print('No cards found.')
+        return 1
+
+    start = time.time()
+    results = test_ports(ports, args)
+    passed = sum(1 for r in results if r.get('pass'))
+    print(f'{passed}/{len(results)} passed in {time.time() - start:.1f}s')
+    return 0 if passed == len(results) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -4,20 +4,50 @@ r"""Serial test helper for Bokaka-Eval device.
 Usage examples (PowerShell):
   python .\utils\serial_test.py --port COM3 --cmds HELLO,GET_STATE
   python .\utils\serial_test.py --interactive
+  python .\utils\serial_test.py --list
+  python .\utils\serial_test.py --device-id 0E4731343935353900180040 --cmds GET_STATE
+  python .\utils\serial_test.py --bridge --bridge-log booth.jsonl
+  python .\utils\serial_test.py --bridge 0E4731343935353900180040
+  python .\utils\serial_test.py --binary --cmds HELLO,GET_STATE
+  python .\utils\serial_test.py --port COM3 --bench --iterations 500
+  python .\utils\serial_test.py --bench --mix HELLO:2,DUMP,SIGN_STATE --dump-count 32
+  python .\utils\serial_test.py --emulate --bench --bench-out emu.json
+  python .\utils\serial_test.py --port socket://localhost:7000 --bench
 
 Features:
 - Auto-detects a single serial port if none provided (prompts when multiple).
 - Sends commands (newline-terminated) and prints any JSON objects received.
 - Interactive mode: type commands, or 'exit' to quit.
+- Reads the device ID from the USB serial number (the full UID, or a serial
+  provision.py recorded in provision_keys.json) so a card can be picked
+  without sending HELLO.
+- Bridge mode: puts the card in BRIDGE mode (optionally with a station
+  identity) and prints/logs each tap event until Ctrl-C.
+- Binary mode: reads the reply layouts with SCHEMA, switches the card to
+  FORMAT BIN and decodes the binary frames back into the same dicts.
+- Benchmark mode: runs a command mix (HELLO, GET_STATE, DUMP of N links,
+  SIGN_STATE) for many iterations and prints host-observed round-trip
+  percentiles, bytes/s and error counts as JSON. The result files have a
+  "median" per command, so utils/bench_compare.py can compare two runs.
+- Emulated card (--emulate): answers HELLO, GET_STATE, DUMP and SIGN_STATE
+  in-process like the firmware, so --cmds and --bench run without hardware.
+  --port also takes pyserial URLs (socket://, rfc2217://) for an emulator
+  behind a socket.
 """
 from __future__ import annotations
 import argparse
+import contextlib
+import hashlib
+import hmac
 import json
+import math
+import os
+import struct
 import sys
 import time
 import serial
 from serial.tools import list_ports
-from typing import List, Optional
+from typing import Callable, Dict, List, Optional, Tuple
 
 
 def balanced_json_objects(s: str) -> List[str]:
@@ -42,6 +72,53 @@ def list_serial_ports() -> List[str]:
     return [p.device for p in list_ports.comports()]
 
 
+KEYSTORE_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'provision_keys.json')
+
+
+def learned_device_ids(store_path: str = KEYSTORE_PATH) -> Dict[str, str]:
+    """USB serial -> device ID, as recorded by provision.py after HELLO."""
+    try:
+        with open(store_path) as f:
+            data = json.load(f)
+    except (OSError, ValueError):
+        return {}
+    return {entry['usb_serial']: dev_id for dev_id, entry in data.items()
+            if isinstance(entry, dict) and entry.get('usb_serial')}
+
+
+def port_device_id(info, learned: Optional[Dict[str, str]] = None) -> Optional[str]:
+    """Device ID from a port's USB serial number, else None.
+
+    A 24-hex serial is the UID itself. Other serials (the STM32duino core's
+    12-char one) are looked up in the key store's learned serials.
+    """
+    sn = getattr(info, 'serial_number', None)
+    if not sn:
+        return None
+    if len(sn) == 24:
+        try:
+            bytes.fromhex(sn)
+            return sn.upper()
+        except ValueError:
+            pass
+    return (learned or {}).get(sn)
+
+
+def list_devices() -> None:
+    learned = learned_device_ids()
+    for info in list_ports.comports():
+        dev_id = port_device_id(info, learned)
+        print(f"{info.device}\t{dev_id or '-'}\t{info.description}")
+
+
+def find_port_by_device_id(device_id: str) -> Optional[str]:
+    learned = learned_device_ids()
+    for info in list_ports.comports():
+        if port_device_id(info, learned) == device_id.upper():
+            return info.device
+    return None
+
+
 def choose_port(interactive: bool) -> Optional[str]:
     ports = list_serial_ports()
     if not ports:
@@ -86,6 +163,71 @@ def read_json_line(ser: serial.Serial, timeout: float = 2.0) -> Optional[dict]:
     return None
 
 
+# Binary reply frames (FORMAT BIN, see firmware include/response_schema.h):
+# 0xB5 | schema id | payload length (u16 LE) | fields
+FRAME_SYNC = 0xB5
+_NUMBER_FORMATS = {'u8': '<B', 'u16': '<H', 'u32': '<I'}
+
+
+def load_schemas(ser: serial.Serial, timeout: float = 1.0) -> Dict[int, dict]:
+    """Ask the card for its reply layouts (SCHEMA, always JSON)."""
+    send_cmd(ser, 'SCHEMA')
+    schemas = {}
+    while True:
+        data = read_json_line(ser, timeout=timeout)
+        if data is None:
+            return schemas
+        if data.get('event') == 'schema':
+            schemas[data['id']] = data
+
+
+def decode_frame(schemas: Dict[int, dict], frame_id: int, payload: bytes) -> dict:
+    schema = schemas.get(frame_id)
+    if schema is None:
+        return {'event': 'unknown_frame', 'id': frame_id, 'raw': payload.hex().upper()}
+    out = {'event': schema['name']}
+    pos = 0
+    for name, kind, width in schema['fields']:
+        if kind == 'str':
+            n = payload[pos]
+            out[name] = payload[pos + 1:pos + 1 + n].decode(errors='replace')
+            pos += 1 + n
+        elif kind == 'hex':
+            out[name] = payload[pos:pos + width].hex().upper()
+            pos += width
+        elif kind == 'bool':
+            out[name] = bool(payload[pos])
+            pos += 1
+        else:
+            out[name] = struct.unpack_from(_NUMBER_FORMATS[kind], payload, pos)[0]
+            pos += width
+    return out
+
+
+def make_frame_reader(schemas: Dict[int, dict]) -> Callable[[serial.Serial, float], Optional[dict]]:
+    """Reader for FORMAT BIN: binary frames, plus the JSON lines that list
+    replies (DUMP, SELFTEST, POWER) still use."""
+    def read_reply(ser: serial.Serial, timeout: float = 2.0) -> Optional[dict]:
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            first = ser.read(1)
+            if not first or first in b'\r\n':
+                continue
+            if first[0] == FRAME_SYNC:
+                header = ser.read(3)
+                if len(header) < 3:
+                    return None
+                frame_id, length = header[0], struct.unpack('<H', header[1:])[0]
+                return decode_frame(schemas, frame_id, ser.read(length))
+            line = (first + ser.readline()).decode(errors='ignore').strip()
+            try:
+                return json.loads(line)
+            except ValueError:
+                continue
+        return None
+    return read_reply
+
+
 def send_cmd(ser: serial.Serial, cmd: str) -> None:
     if not cmd.endswith('\n'):
         cmd = cmd + '\n'
@@ -101,13 +243,14 @@ def pretty_print(data: dict) -> None:
         print(str(data))
 
 
-def run_once(ser: serial.Serial, cmds: List[str], timeout: float) -> None:
+def run_once(ser: serial.Serial, cmds: List[str], timeout: float,
+             reader: Callable[[serial.Serial, float], Optional[dict]] = read_json_line) -> None:
     for cmd in cmds:
         send_cmd(ser, cmd)
         # try to read multiple JSON responses until timeout
         start = time.time()
         while True:
-            data = read_json_line(ser, timeout=timeout)
+            data = reader(ser, timeout)
             if data is None:
                 break
             pretty_print(data)
@@ -143,6 +286,314 @@ def interactive_loop(ser: serial.Serial) -> None:
         pass
 
 
+def bridge_loop(ser: serial.Serial, station_id: Optional[str], log_path: Optional[str]) -> None:
+    cmd = 'BRIDGE ON' + (f' {station_id}' if station_id else '')
+    send_cmd(ser, cmd)
+    log = open(log_path, 'a', encoding='utf-8') if log_path else None
+    print('Bridge mode on. Waiting for taps (Ctrl-C to stop).')
+    try:
+        while True:
+            data = read_json_line(ser, timeout=1.0)
+            if data is None:
+                continue
+            if data.get('event') == 'tap':
+                print(f"tap #{data.get('seq')}  peer {data.get('peer')}  ({data.get('role')})")
+                if log:
+                    data['host_time'] = time.time()
+                    log.write(json.dumps(data) + '\n')
+                    log.flush()
+            else:
+                pretty_print(data)
+    except KeyboardInterrupt:
+        print()
+    finally:
+        send_cmd(ser, 'BRIDGE OFF')
+        if log:
+            log.close()
+
+
+# =====================================================
+# Emulated card (--emulate)
+# =====================================================
+
+class EmulatedCard:
+    """Stands in for a card's serial port. Answers HELLO, GET_STATE, DUMP and
+    SIGN_STATE the way the firmware formats them, after `delay` seconds per
+    reply. Anything else gets the firmware's unknown-command error."""
+
+    def __init__(self, links: int = 64, delay: float = 0.0, timeout: float = 0.1):
+        rnd = struct.pack('<I', 0x5EED)
+        self.self_id = hashlib.sha256(b'self' + rnd).digest()[:12]
+        self.peers = [hashlib.sha256(b'peer%d' % i + rnd).digest()[:12] for i in range(links)]
+        self.key = hashlib.sha256(b'key' + rnd).digest()
+        self.key_version = 1
+        self.taps = len(self.peers)
+        self.delay = delay
+        self.timeout = timeout
+        self._in = b''
+        self._out = bytearray()
+        self._ready_at = 0.0
+
+    # --- pyserial subset used by this script ---
+    def write(self, data: bytes) -> int:
+        self._in += data
+        while b'\n' in self._in:
+            line, self._in = self._in.split(b'\n', 1)
+            reply = self._reply(line.decode(errors='ignore').strip())
+            if reply is not None:
+                self._out += (json.dumps(reply, separators=(',', ':')) + '\r\n').encode()
+                self._ready_at = time.perf_counter() + self.delay
+        return len(data)
+
+    def _wait(self) -> bool:
+        deadline = time.perf_counter() + (self.timeout or 0)
+        while True:
+            now = time.perf_counter()
+            if self._out and now >= self._ready_at:
+                return True
+            if now >= deadline:
+                return False
+            time.sleep(min(0.001, deadline - now))
+
+    def read(self, size: int = 1) -> bytes:
+        if not self._wait():
+            return b''
+        data = bytes(self._out[:size])
+        del self._out[:size]
+        return data
+
+    def readline(self) -> bytes:
+        if not self._wait():
+            return b''
+        end = self._out.find(b'\n')
+        end = len(self._out) if end < 0 else end + 1
+        data = bytes(self._out[:end])
+        del self._out[:end]
+        return data
+
+    def flush(self) -> None:
+        pass
+
+    def reset_input_buffer(self) -> None:
+        self._out.clear()
+
+    def reset_output_buffer(self) -> None:
+        self._in = b''
+
+    def close(self) -> None:
+        pass
+
+    # --- command handling ---
+    def _reply(self, line: str) -> Optional[dict]:
+        if not line:
+            return None
+        parts = line.split()
+        cmd, args = parts[0], parts[1:]
+        dev_id = self.self_id.hex().upper()
+        if cmd == 'HELLO':
+            return {'event': 'hello', 'device_id': dev_id, 'fw': 'emulator', 'build': '-', 'hash': '-'}
+        if cmd == 'GET_STATE':
+            return {'event': 'state', 'totalTapCount': self.taps, 'linkCount': len(self.peers)}
+        if cmd == 'DUMP':
+            try:
+                offset = max(0, int(args[0])) if args else 0
+                count = max(0, int(args[1])) if len(args) > 1 else 10
+            except ValueError:
+                offset, count = 0, 0
+            items = [{'peer': p.hex().upper()} for p in self.peers[offset:offset + count]]
+            return {'event': 'links', 'offset': offset, 'count': len(items), 'items': items}
+        if cmd == 'SIGN_STATE':
+            if not args:
+                return {'event': 'error', 'msg': 'SIGN_STATE args'}
+            nonce_hex = args[0]
+            if not nonce_hex or len(nonce_hex) % 2 or len(nonce_hex) > 64:
+                return {'event': 'error', 'msg': 'invalid nonce'}
+            try:
+                nonce = bytes.fromhex(nonce_hex)
+            except ValueError:
+                return {'event': 'error', 'msg': 'invalid nonce hex'}
+            # selfId + nonce + totalTapCount (4 LE) + linkCount (2 LE) + peers
+            msg = (self.self_id + nonce + self.taps.to_bytes(4, 'little')
+                   + len(self.peers).to_bytes(2, 'little') + b''.join(self.peers))
+            mac = hmac.new(self.key, msg, hashlib.sha256).hexdigest().upper()
+            return {'event': 'SIGNED_STATE', 'device_id': dev_id, 'nonce': nonce_hex,
+                    'totalTapCount': self.taps, 'linkCount': len(self.peers),
+                    'keyVersion': self.key_version, 'hmac': mac}
+        return {'event': 'error', 'msg': f'unknown command: {cmd}'}
+
+
+# =====================================================
+# Benchmark mode (--bench)
+# =====================================================
+
+# Command -> reply event that completes it
+BENCH_OPS = {
+    'HELLO': 'hello',
+    'GET_STATE': 'state',
+    'DUMP': 'links',
+    'SIGN_STATE': 'SIGNED_STATE',
+}
+
+
+def parse_mix(text: str) -> List[str]:
+    """'HELLO:2,DUMP' -> ['HELLO', 'HELLO', 'DUMP'] (the order commands cycle in)."""
+    mix = []
+    for part in text.split(','):
+        name, _, weight = part.strip().upper().partition(':')
+        if name not in BENCH_OPS:
+            raise ValueError(f'unknown benchmark command {name!r} (use {", ".join(BENCH_OPS)})')
+        mix += [name] * (int(weight) if weight else 1)
+    if not mix:
+        raise ValueError('empty --mix')
+    return mix
+
+
+def bench_command_line(op: str, dump_count: int) -> str:
+    if op == 'DUMP':
+        return f'DUMP 0 {dump_count}'
+    if op == 'SIGN_STATE':
+        return f'SIGN_STATE {os.urandom(16).hex().upper()}'   # fresh nonce, like a server
+    return op
+
+
+class _CountingPort:
+    """Counts the bytes a reply reader pulls off the port."""
+
+    def __init__(self, ser):
+        self.ser = ser
+        self.bytes_in = 0
+
+    def read(self, size: int = 1) -> bytes:
+        data = self.ser.read(size)
+        self.bytes_in += len(data)
+        return data
+
+    def readline(self) -> bytes:
+        data = self.ser.readline()
+        self.bytes_in += len(data)
+        return data
+
+
+def read_reply_line(ser, timeout: float = 2.0) -> Optional[dict]:
+    """Next JSON line, returned as soon as its newline arrives (read_json_line
+    polls in 50 ms steps, too coarse for latency numbers)."""
+    deadline = time.perf_counter() + timeout
+    buf = b''
+    while time.perf_counter() < deadline:
+        buf += ser.readline()
+        if not buf.endswith(b'\n'):
+            continue
+        text = buf.decode(errors='ignore').strip()
+        buf = b''
+        if not text.startswith('{'):
+            continue
+        try:
+            return json.loads(text)
+        except ValueError:
+            continue
+    return None
+
+
+def bench_exchange(ser, cmd: str, expect: str, timeout: float,
+                   reader: Callable) -> Tuple[str, float, int, int]:
+    """Send one command and wait for its reply.
+    Returns (outcome 'ok' / 'error' / 'timeout', seconds, bytes out, bytes in)."""
+    data = (cmd + '\n').encode()
+    port = _CountingPort(ser)
+    t0 = time.perf_counter()
+    ser.write(data)
+    ser.flush()
+    deadline = t0 + timeout
+    while True:
+        remaining = deadline - time.perf_counter()
+        if remaining <= 0:
+            return 'timeout', time.perf_counter() - t0, len(data), port.bytes_in
+        msg = reader(port, remaining)
+        if msg is None:
+            continue
+        event = msg.get('event')
+        if event == expect:
+            return 'ok', time.perf_counter() - t0, len(data), port.bytes_in
+        if event == 'error':
+            return 'error', time.perf_counter() - t0, len(data), port.bytes_in
+
+
+def percentile(sorted_values: List[float], pct: float) -> float:
+    """Nearest-rank percentile of an ascending list."""
+    if not sorted_values:
+        return 0.0
+    k = max(0, math.ceil(pct / 100.0 * len(sorted_values)) - 1)
+    return sorted_values[k]
+
+
+class BenchStats:
+    def __init__(self, name: str):
+        self.name = name
+        self.times: List[float] = []    # successful round trips (s)
+        self.errors = 0
+        self.timeouts = 0
+        self.bytes_out = 0
+        self.bytes_in = 0
+        self.busy = 0.0                  # time spent in exchanges (s)
+
+    def add(self, outcome: str, seconds: float, bytes_out: int, bytes_in: int) -> None:
+        if outcome == 'ok':
+            self.times.append(seconds)
+        elif outcome == 'error':
+            self.errors += 1
+        else:
+            self.timeouts += 1
+        self.bytes_out += bytes_out
+        self.bytes_in += bytes_in
+        self.busy += seconds
+
+    def result(self) -> dict:
+        ms = sorted(t * 1000.0 for t in self.times)
+        r = {'name': self.name,
+             'iterations': len(self.times) + self.errors + self.timeouts,
+             'ok': len(ms), 'errors': self.errors, 'timeouts': self.timeouts}
+        for key, value in (('min', ms[0] if ms else 0.0),
+                           ('median', percentile(ms, 50)),
+                           ('mean', sum(ms) / len(ms) if ms else 0.0),
+                           ('p50', percentile(ms, 50)),
+                           ('p95', percentile(ms, 95)),
+                           ('p99', percentile(ms, 99)),
+                           ('max', ms[-1] if ms else 0.0)):
+            r[key] = round(value, 3)
+        r['bytes_out'] = self.bytes_out
+        r['bytes_in'] = self.bytes_in
+        r['bytes_per_s'] = round((self.bytes_out + self.bytes_in) / self.busy, 1) if self.busy else 0.0
+        return r
+
+
+def run_bench(ser, mix: List[str], iterations: int, warmup: int, dump_count: int,
+              timeout: float, reader: Callable = read_reply_line) -> dict:
+    """Cycle through mix for warmup + iterations commands, one in flight at a time."""
+    stats = {op: BenchStats(op) for op in dict.fromkeys(mix)}
+    total = BenchStats('total')
+    ser.reset_input_buffer()
+    start = time.perf_counter()
+    for i in range(warmup + iterations):
+        op = mix[i % len(mix)]
+        sample = bench_exchange(ser, bench_command_line(op, dump_count), BENCH_OPS[op], timeout, reader)
+        if sample[0] == 'timeout':
+            time.sleep(0.05)            # let a late reply land, then drop it
+            ser.reset_input_buffer()
+        if i < warmup:
+            continue
+        if i == warmup:
+            start = time.perf_counter()
+        stats[op].add(*sample)
+        total.add(*sample)
+    elapsed = time.perf_counter() - start
+
+    summary = total.result()
+    summary['elapsed_s'] = round(elapsed, 3)
+    summary['commands_per_s'] = round(iterations / elapsed, 1) if elapsed else 0.0
+    return {'suite': 'serial-commands', 'unit': 'ms', 'dump_count': dump_count,
+            'results': [s.result() for s in stats.values()], 'total': summary}
+
+
 def main(argv: Optional[List[str]] = None) -> int:
     p = argparse.ArgumentParser(description='Serial test helper for Bokaka-Eval')
     p.add_argument('--port', help='Serial port (e.g. COM3)')
@@ -150,9 +601,44 @@ def main(argv: Optional[List[str]] = None) -> int:
     p.add_argument('--timeout', type=float, default=2.0, help='Read timeout (s)')
     p.add_argument('--cmds', help='Comma-separated commands to send (e.g. HELLO,GET_STATE)')
     p.add_argument('--interactive', action='store_true', help='Interactive mode')
+    p.add_argument('--device-id', help='Select the port whose USB serial number maps to this device ID')
+    p.add_argument('--list', action='store_true', help='List ports with device IDs from USB serial numbers (UID or learned) and exit')
+    p.add_argument('--bridge', nargs='?', const='', metavar='STATION_ID',
+                   help='Run as a bridge station (optional 24-hex station identity) and stream tap events')
+    p.add_argument('--bridge-log', help='Append bridge tap events to this JSONL file')
+    p.add_argument('--binary', action='store_true',
+                   help='Switch the card to binary replies (FORMAT BIN) and decode them (with --cmds or --bench)')
+    p.add_argument('--bench', action='store_true',
+                   help='Benchmark round-trip latency and throughput of a command mix; prints JSON')
+    p.add_argument('--mix', default='HELLO,GET_STATE,DUMP,SIGN_STATE',
+                   help='Benchmark commands, optionally weighted (e.g. HELLO:2,DUMP)')
+    p.add_argument('--iterations', type=int, default=200, help='Benchmark commands to time')
+    p.add_argument('--warmup', type=int, default=5, help='Untimed commands before the benchmark')
+    p.add_argument('--dump-count', type=int, default=64, help='Links per benchmark DUMP')
+    p.add_argument('--bench-out', help='Also write the benchmark JSON to this file')
+    p.add_argument('--emulate', action='store_true', help='Talk to an in-process emulated card instead of a port')
+    p.add_argument('--emulate-links', type=int, default=64, help='Links the emulated card holds')
+    p.add_argument('--emulate-delay', type=float, default=0.0, help='Emulated reply delay (s)')
     args = p.parse_args(argv)
 
-    port = args.port
+    mix = []
+    if args.bench:
+        try:
+            mix = parse_mix(args.mix)
+        except ValueError as e:
+            print(e)
+            return 1
+
+    if args.list:
+        list_devices()
+        return 0
+
+    port = 'emulator' if args.emulate else args.port
+    if not port and args.device_id:
+        port = find_port_by_device_id(args.device_id)
+        if not port:
+            print(f'No port with device ID {args.device_id}.')
+            return 1
     if not port:
         port = choose_port(interactive=args.interactive)
     if not port:
@@ -160,7 +646,11 @@ def main(argv: Optional[List[str]] = None) -> int:
         return 1
 
     try:
-        ser = serial.Serial(port, baudrate=args.baud, timeout=0.1)
+        if args.emulate:
+            ser = EmulatedCard(args.emulate_links, args.emulate_delay)
+        else:
+            # Plain port names and pyserial URLs (socket://host:port, ...)
+            ser = serial.serial_for_url(port, baudrate=args.baud, timeout=0.1)
         # Small delay to allow serial port and device to stabilize after connection
         time.sleep(0.1)
         # Flush any stale data from the port
@@ -170,12 +660,41 @@ def main(argv: Optional[List[str]] = None) -> int:
         print(f'Failed to open {port}: {e}')
         return 2
 
-    print(f'Opened {port} @ {args.baud}')
+    # Keep stdout clean for the benchmark JSON
+    print(f'Opened {port} @ {args.baud}', file=sys.stderr if args.bench else sys.stdout)
 
     try:
-        if args.cmds:
+        if args.bench:
+            reader = read_reply_line
+            if args.binary:
+                with contextlib.redirect_stdout(sys.stderr):
+                    schemas = load_schemas(ser)
+                ser.write(b'FORMAT BIN\n')
+                time.sleep(0.1)
+                reader = make_frame_reader(schemas)
+            try:
+                result = run_bench(ser, mix, args.iterations, args.warmup, args.dump_count,
+                                   args.timeout, reader)
+            finally:
+                if args.binary:
+                    ser.write(b'FORMAT JSON\n')
+            result['port'] = port
+            result['format'] = 'bin' if args.binary else 'json'
+            text = json.dumps(result, indent=2)
+            print(text)
+            if args.bench_out:
+                with open(args.bench_out, 'w', encoding='utf-8') as fh:
+                    fh.write(text + '\n')
+            return 1 if result['total']['errors'] or result['total']['timeouts'] else 0
+        elif args.bridge is not None:
+            bridge_loop(ser, args.bridge or None, args.bridge_log)
+        elif args.cmds:
             cmds = [c.strip() for c in args.cmds.split(',') if c.strip()]
-            run_once(ser, cmds, timeout=args.timeout)
+            if args.binary:
+                reader = make_frame_reader(load_schemas(ser))
+                run_once(ser, ['FORMAT BIN'] + cmds + ['FORMAT JSON'], timeout=args.timeout, reader=reader)
+            else:
+                run_once(ser, cmds, timeout=args.timeout)
         elif args.interactive:
             interactive_loop(ser)
         else:
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+r"""Compact UID codec (mirror of firmware src/uid_codec.cpp) and validator.
+
+Usage examples (PowerShell):
+  python .\utils\uid_codec.py                      # validate against provision_keys.json
+  python .\utils\uid_codec.py --keys path\to\keys.json
+  python .\utils\uid_codec.py --encode 0E4731343935353900180040 --dict 0F4731343935353900440044
+
+Validation encodes every device UID in the key store against every other one
+(the peer UID each side learns during arbitration), checks that it decodes
+back, and reports frame sizes and tap-link airtime against the raw 12 bytes.
+"""
+from __future__ import annotations
+import argparse
+import itertools
+import json
+import os
+import sys
+from typing import List, Tuple
+
+UID_LEN = 12
+RAW = 0x80
+LOT_SAME = 0x40
+WAF_SAME = 0x20
+LEN_MASK = 0x0F
+
+# Tap link command byte: 8 bits x (5 ms drive + 2 ms recovery)
+BYTE_AIRTIME_MS = 8 * 7
+
+
+def _put_varint(v: int) -> bytes:
+    out = bytearray()
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+    return bytes(out)
+
+
+def _get_varint(buf: bytes, pos: int) -> Tuple[int, int]:
+    result = 0
+    for n in range(3):
+        if pos + n >= len(buf):
+            break
+        b = buf[pos + n]
+        result |= (b & 0x7F) << (7 * n)
+        if not b & 0x80:
+            if result > 0xFFFF:
+                break
+            return result, pos + n + 1
+    raise ValueError('bad varint')
+
+
+def encode(uid: bytes, dictionary: bytes) -> bytes:
+    body = bytearray()
+    header = 0
+    if uid[1:8] == dictionary[1:8]:
+        header |= LOT_SAME
+    else:
+        body += uid[1:8]
+    if uid[0] == dictionary[0]:
+        header |= WAF_SAME
+    else:
+        body.append(uid[0])
+    body += _put_varint(int.from_bytes(uid[8:10], 'big'))
+    body += _put_varint(int.from_bytes(uid[10:12], 'big'))
+    if len(body) >= UID_LEN:
+        return bytes([RAW | UID_LEN]) + bytes(uid)
+    return bytes([header | len(body)]) + bytes(body)
+
+
+def decode(frame: bytes, dictionary: bytes) -> bytes:
+    if not frame:
+        raise ValueError('empty frame')
+    header = frame[0]
+    body = frame[1:]
+    if len(body) != header & LEN_MASK:
+        raise ValueError('length mismatch')
+    if header & RAW:
+        if len(body) != UID_LEN:
+            raise ValueError('bad raw frame')
+        return bytes(body)
+    uid = bytearray(UID_LEN)
+    pos = 0
+    if header & LOT_SAME:
+        uid[1:8] = dictionary[1:8]
+    else:
+        uid[1:8] = body[pos:pos + 7]
+        pos += 7
+    if header & WAF_SAME:
+        uid[0] = dictionary[0]
+    else:
+        uid[0] = body[pos]
+        pos += 1
+    x, pos = _get_varint(body, pos)
+    y, pos = _get_varint(body, pos)
+    if pos != len(body):
+        raise ValueError('trailing bytes')
+    uid[8:10] = x.to_bytes(2, 'big')
+    uid[10:12] = y.to_bytes(2, 'big')
+    return bytes(uid)
+
+
+def load_uids(path: str) -> List[bytes]:
+    with open(path, 'r', encoding='utf-8') as fh:
+        data = json.load(fh)
+    uids = []
+    for dev_id in data.keys():
+        try:
+            raw = bytes.fromhex(dev_id)
+        except ValueError:
+            continue
+        if len(raw) == UID_LEN:
+            uids.append(raw)
+    return uids
+
+
+def validate(uids: List[bytes]) -> int:
+    if len(uids) < 2:
+        print('need at least two UIDs to validate', file=sys.stderr)
+        return 1
+
+    sizes = []
+    failures = 0
+    for uid, peer in itertools.permutations(uids, 2):
+        frame = encode(uid, peer)
+        if decode(frame, peer) != uid:
+            failures += 1
+            print(f'ROUNDTRIP FAIL {uid.hex().upper()} vs {peer.hex().upper()}')
+        sizes.append(len(frame))
+
+    raw_len = 1 + UID_LEN  # ACK + 12 bytes
+    avg = sum(sizes) / len(sizes)
+    print(f'UIDs: {len(uids)}  pairs: {len(sizes)}  failures: {failures}')
+    print(f'frame bytes: min {min(sizes)}  avg {avg:.2f}  max {max(sizes)}  (raw {UID_LEN})')
+    print(f'ID response airtime: raw {raw_len * BYTE_AIRTIME_MS} ms, '
+          f'compact avg {(1 + avg) * BYTE_AIRTIME_MS:.0f} ms')
+    return 1 if failures else 0
+
+
+def main() -> int:
+    default_keys = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'provision_keys.json')
+    ap = argparse.ArgumentParser(description='Compact UID codec validator')
+    ap.add_argument('--keys', default=default_keys, help='Key store JSON (device IDs as keys)')
+    ap.add_argument('--encode', help='UID hex to encode')
+    ap.add_argument('--dict', help='Peer UID hex used as dictionary (with --encode)')
+    args = ap.parse_args()
+
+    if args.encode:
+        uid = bytes.fromhex(args.encode)
+        peer = bytes.fromhex(args.dict) if args.dict else bytes(UID_LEN)
+        frame = encode(uid, peer)
+        print(frame.hex().upper())
+        return 0
+
+    return validate(load_uids(args.keys))
+
+
+if __name__ == '__main__':
+    sys.exit(main())